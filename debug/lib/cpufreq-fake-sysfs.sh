@@ -0,0 +1,164 @@
+#!/bin/sh
+#
+# Creates a synthetic /sys tree with many CPUs and cpufreq policies, so
+# that libcpufreq and the cpufrequtils can be run against large machine
+# shapes on any box:
+#
+#   ./cpufreq-fake-sysfs.sh -o /tmp/fakesys -c 4096 -p 8 -f 40
+#   CPUFREQ_SYSFS_ROOT=/tmp/fakesys ../../cpufreq-info -c 4095
+#
+# The layout follows recent kernels: cpuN/cpufreq is a symlink into
+# cpu/cpufreq/policyM, where M is the first CPU of the policy. Each
+# package of -k CPUs has cores of -t threads, and is a NUMA node of its
+# own.
+#
+# (C) 2026 cpufrequtils contributors
+#
+# Licensed under the terms of the GNU GPL License version 2.
+
+CPUS=4096
+PER_POLICY=8
+PER_PACKAGE=64
+PER_CORE=2
+FREQS=40
+MAX_FREQ=3900000
+STEP=50000
+DRIVER=fake-cpufreq
+GOVERNORS="performance powersave userspace ondemand conservative schedutil"
+ROOT=
+
+usage() {
+	echo "Usage: $0 -o DIR [-c CPUS] [-p CPUS_PER_POLICY] [-k CPUS_PER_PACKAGE]"
+	echo "       [-t CPUS_PER_CORE] [-f FREQUENCIES]"
+	exit 1
+}
+
+while getopts "o:c:p:k:t:f:h" opt; do
+	case $opt in
+	o) ROOT=$OPTARG ;;
+	c) CPUS=$OPTARG ;;
+	p) PER_POLICY=$OPTARG ;;
+	k) PER_PACKAGE=$OPTARG ;;
+	t) PER_CORE=$OPTARG ;;
+	f) FREQS=$OPTARG ;;
+	*) usage ;;
+	esac
+done
+
+[ -n "$ROOT" ] || usage
+[ "$CPUS" -gt 0 ] && [ "$PER_POLICY" -gt 0 ] && [ "$FREQS" -gt 0 ] || usage
+[ "$PER_PACKAGE" -gt 0 ] && [ "$PER_CORE" -gt 0 ] || usage
+
+CPUDIR=$ROOT/devices/system/cpu
+NODEDIR=$ROOT/devices/system/node
+rm -rf "$CPUDIR" "$NODEDIR"
+mkdir -p "$CPUDIR/cpufreq" || exit 1
+
+# directories first, so that awk only has to write files
+cpu=0
+while [ $cpu -lt $CPUS ]; do
+	if [ $((cpu % PER_POLICY)) -eq 0 ]; then
+		mkdir -p "$CPUDIR/cpufreq/policy$cpu/stats"
+		policy=$cpu
+	fi
+	if [ $((cpu % PER_PACKAGE)) -eq 0 ]; then
+		mkdir -p "$NODEDIR/node$((cpu / PER_PACKAGE))"
+	fi
+	mkdir -p "$CPUDIR/cpu$cpu/topology"
+	ln -s "../cpufreq/policy$policy" "$CPUDIR/cpu$cpu/cpufreq"
+	cpu=$((cpu + 1))
+done
+
+awk -v dir="$CPUDIR" -v nodedir="$NODEDIR" -v cpus=$CPUS -v per=$PER_POLICY \
+    -v perpkg=$PER_PACKAGE -v percore=$PER_CORE -v nfreq=$FREQS \
+    -v fmax=$MAX_FREQ -v step=$STEP -v driver=$DRIVER -v govs="$GOVERNORS" '
+function put(file, str) {
+	printf "%s\n", str > file
+	close(file)
+}
+BEGIN {
+	srand(1);
+	range = "0-" (cpus - 1);
+	put(dir "/present", range);
+	put(dir "/online", range);
+	put(dir "/possible", range);
+
+	for (first = 0; first < cpus; first += perpkg) {
+		last = first + perpkg - 1;
+		if (last >= cpus)
+			last = cpus - 1;
+		put(nodedir "/node" int(first / perpkg) "/cpulist", first "-" last);
+	}
+	for (c = 0; c < cpus; c++) {
+		t = dir "/cpu" c "/topology";
+		pkg = int(c / perpkg);
+		first = pkg * perpkg;
+		last = first + perpkg - 1;
+		if (last >= cpus)
+			last = cpus - 1;
+		put(t "/physical_package_id", pkg);
+		put(t "/package_cpus_list", first "-" last);
+		core = int((c - first) / percore);
+		first += core * percore;
+		last2 = first + percore - 1;
+		if (last2 > last)
+			last2 = last;
+		put(t "/core_id", core);
+		put(t "/core_cpus_list", first "-" last2);
+	}
+
+	fmin = fmax - (nfreq - 1) * step;
+	avail = "";
+	for (i = 0; i < nfreq; i++) {
+		freq[i] = fmax - i * step;
+		avail = avail freq[i] " ";
+	}
+	header = "   From  :    To\n         : ";
+	for (i = 0; i < nfreq; i++)
+		header = header sprintf("%9u ", freq[i]);
+
+	for (first = 0; first < cpus; first += per) {
+		p = dir "/cpufreq/policy" first;
+		last = first + per - 1;
+		if (last >= cpus)
+			last = cpus - 1;
+		list = "";
+		for (c = first; c <= last; c++)
+			list = list c (c < last ? " " : "");
+		cur = freq[int(rand() * nfreq)];
+
+		put(p "/affected_cpus", list);
+		put(p "/related_cpus", list);
+		put(p "/cpuinfo_min_freq", fmin);
+		put(p "/cpuinfo_max_freq", fmax);
+		put(p "/cpuinfo_cur_freq", cur);
+		put(p "/cpuinfo_transition_latency", 10000);
+		put(p "/scaling_available_frequencies", avail);
+		put(p "/scaling_available_governors", govs);
+		put(p "/scaling_cur_freq", cur);
+		put(p "/scaling_driver", driver);
+		put(p "/scaling_governor", "schedutil");
+		put(p "/scaling_min_freq", fmin);
+		put(p "/scaling_max_freq", fmax);
+		put(p "/scaling_setspeed", "<unsupported>");
+
+		tis = "";
+		for (i = 0; i < nfreq; i++)
+			tis = tis sprintf("%u %u%s", freq[i], int(rand() * 10000000),
+					  i < nfreq - 1 ? "\n" : "");
+		put(p "/stats/time_in_state", tis);
+
+		total = 0;
+		table = header;
+		for (i = 0; i < nfreq; i++) {
+			table = table sprintf("\n%9u: ", freq[i]);
+			for (j = 0; j < nfreq; j++) {
+				n = (i == j) ? 0 : int(rand() * 1000);
+				total += n;
+				table = table sprintf("%9u ", n);
+			}
+		}
+		put(p "/stats/trans_table", table);
+		put(p "/stats/total_trans", total);
+	}
+}'
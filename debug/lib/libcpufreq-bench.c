@@ -0,0 +1,694 @@
+/*
+ * microbenchmarks for libcpufreq
+ *
+ * (C) 2026 cpufrequtils contributors
+ *
+ * Licensed under the terms of the GNU GPL License version 2.
+ *
+ * Build libcpufreq first, then run "make" in this directory. Run with
+ *   LD_LIBRARY_PATH=../.. ./libcpufreq-bench <test> [-c CPU] [-n LOOPS] [-d DIR]
+ *
+ * Available tests:
+ *   freq     cpufreq_get_freq_kernel() calls per second, with and without
+ *            the file descriptor cache, and cached with lib stats counting
+ *   alloc    malloc() calls and time per snapshot cycle of driver, policy,
+ *            governors, frequencies, CPUs and stats, using the list API
+ *            and the arena API
+ *   parse    throughput of the sysfs parsers on a synthetic time_in_state
+ *            and trans_table with LOOPS P-states, compared to the old
+ *            sscanf() based parsing
+ *   stats    time in state sampling and deltas of the first CPU of every
+ *            policy, with samples and deltas against reading and diffing
+ *            cpufreq_get_stats() lists; LOOPS / 100 deltas are timed. Run
+ *            against a tree from cpufreq-fake-sysfs.sh for 512 policies
+ *            of 40 states
+ *   session  cpufreq_set_frequency() calls per second against a
+ *            pinned-frequency session, alternating between the highest
+ *            and lowest available frequency; this writes sysfs, so run
+ *            it against a copy of a fake tree or as root
+ *   replay   runs the sysfs parsers over every file in the corpus
+ *            directory given by -d (default: corpus), and over each of
+ *            its prefixes, checking that they stay within their bounds.
+ *            The name of a file up to the first '.' picks the parser:
+ *            time_in_state, trans_table or cpulist. NAME.expect holds
+ *            the result expected for NAME: the number of values parsed,
+ *            -EINVAL if the input is to be rejected, or -EOVERFLOW for
+ *            a CPU list naming CPUs beyond CPUFREQ_MAX_CPUS. Run it under
+ *            valgrind to catch reads beyond the end of the input
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <dirent.h>
+
+#include "cpufreq.h"
+#include "parse.h"
+
+/* count allocations made by libcpufreq by interposing malloc */
+
+extern void *__libc_malloc(size_t size);
+
+static unsigned long nr_mallocs;
+
+void *malloc(size_t size)
+{
+	nr_mallocs++;
+	return __libc_malloc(size);
+}
+
+struct bench_opts {
+	unsigned int cpu;
+	unsigned long loops;
+	const char *dir;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double time_freq_kernel(const struct bench_opts *opts)
+{
+	unsigned long i;
+	double start;
+
+	start = now();
+	for (i = 0; i < opts->loops; i++) {
+		if (!cpufreq_get_freq_kernel(opts->cpu)) {
+			fprintf(stderr, "couldn't read frequency of CPU %u\n",
+				opts->cpu);
+			return 0;
+		}
+	}
+	return now() - start;
+}
+
+static int bench_freq(const struct bench_opts *opts)
+{
+	double uncached, cached, counted;
+
+	uncached = time_freq_kernel(opts);
+	if (!uncached)
+		return 1;
+
+	if (cpufreq_fd_cache_enable(64)) {
+		fprintf(stderr, "couldn't enable fd cache\n");
+		return 1;
+	}
+	cached = time_freq_kernel(opts);
+	cpufreq_set_lib_stats(1);
+	counted = time_freq_kernel(opts);
+	cpufreq_set_lib_stats(0);
+	cpufreq_fd_cache_disable();
+	if (!cached || !counted)
+		return 1;
+
+	printf("cpufreq_get_freq_kernel(%u), %lu calls:\n", opts->cpu, opts->loops);
+	printf("  open/read/close: %12.0f calls/s\n", opts->loops / uncached);
+	printf("  cached pread:    %12.0f calls/s (%.2fx)\n",
+	       opts->loops / cached, uncached / cached);
+	printf("  with lib stats:  %12.0f calls/s (%.2fx)\n",
+	       opts->loops / counted, uncached / counted);
+	return 0;
+}
+
+static void cycle_lists(unsigned int cpu)
+{
+	unsigned long long total_time;
+
+	cpufreq_put_driver(cpufreq_get_driver(cpu));
+	cpufreq_put_policy(cpufreq_get_policy(cpu));
+	cpufreq_put_available_governors(cpufreq_get_available_governors(cpu));
+	cpufreq_put_available_frequencies(cpufreq_get_available_frequencies(cpu));
+	cpufreq_put_affected_cpus(cpufreq_get_affected_cpus(cpu));
+	cpufreq_put_related_cpus(cpufreq_get_related_cpus(cpu));
+	cpufreq_put_stats(cpufreq_get_stats(cpu, &total_time));
+}
+
+static void cycle_arena(unsigned int cpu, struct cpufreq_arena *arena)
+{
+	cpufreq_get_driver_arena(cpu, arena);
+	cpufreq_get_policy_arena(cpu, arena);
+	cpufreq_get_governor_vector_arena(cpu, arena);
+	cpufreq_get_frequency_vector_arena(cpu, arena);
+	cpufreq_get_affected_cpu_vector_arena(cpu, arena);
+	cpufreq_get_related_cpu_vector_arena(cpu, arena);
+	cpufreq_get_stats_table_arena(cpu, arena);
+	cpufreq_arena_reset(arena);
+}
+
+static int bench_alloc(const struct bench_opts *opts)
+{
+	static char buf[64 * 1024];
+	struct cpufreq_arena arena;
+	unsigned long i, lists_mallocs, arena_mallocs;
+	double start, lists_time, arena_time;
+
+	nr_mallocs = 0;
+	start = now();
+	for (i = 0; i < opts->loops; i++)
+		cycle_lists(opts->cpu);
+	lists_time = now() - start;
+	lists_mallocs = nr_mallocs;
+
+	cpufreq_arena_init(&arena, buf, sizeof(buf));
+	nr_mallocs = 0;
+	start = now();
+	for (i = 0; i < opts->loops; i++)
+		cycle_arena(opts->cpu, &arena);
+	arena_time = now() - start;
+	arena_mallocs = nr_mallocs;
+
+	printf("snapshot cycle of CPU %u, %lu cycles:\n", opts->cpu, opts->loops);
+	printf("  lists: %8.1f mallocs/cycle, %8.2f us/cycle\n",
+	       (double) lists_mallocs / opts->loops, lists_time * 1e6 / opts->loops);
+	printf("  arena: %8.1f mallocs/cycle, %8.2f us/cycle\n",
+	       (double) arena_mallocs / opts->loops, arena_time * 1e6 / opts->loops);
+	return 0;
+}
+
+static char * make_time_in_state(unsigned int states, size_t *len)
+{
+	char *buf = malloc(states * 32 + 1);
+	size_t pos = 0;
+	unsigned int i;
+
+	if (!buf)
+		return NULL;
+	for (i = 0; i < states; i++)
+		pos += sprintf(buf + pos, "%u %u\n", 4000000 - i * 1000,
+			       (unsigned int) rand());
+	*len = pos;
+	return buf;
+}
+
+static char * make_trans_table_body(unsigned int states, size_t *len)
+{
+	char *buf = malloc((size_t) states * (states + 1) * 10 + states + 1);
+	size_t pos = 0;
+	unsigned int i, j;
+
+	if (!buf)
+		return NULL;
+	for (i = 0; i < states; i++) {
+		pos += sprintf(buf + pos, "%9u: ", 4000000 - i * 1000);
+		for (j = 0; j < states; j++)
+			pos += sprintf(buf + pos, "%9u ", (unsigned int) rand() % 100000);
+		buf[pos++] = '\n';
+	}
+	*len = pos;
+	return buf;
+}
+
+/* the way sysfs_get_stats() used to parse time_in_state */
+static unsigned int sscanf_pairs(const char *buf, size_t len,
+				 unsigned long *freq, unsigned long long *time,
+				 unsigned int max)
+{
+	char one_value[256];
+	unsigned int count = 0;
+	size_t i, pos = 0;
+
+	for (i = 0; i < len && count < max; i++) {
+		if (buf[i] != '\n')
+			continue;
+		memcpy(one_value, buf + pos, i - pos);
+		one_value[i - pos] = '\0';
+		if (sscanf(one_value, "%lu %llu", &freq[count], &time[count]) != 2)
+			break;
+		count++;
+		pos = i + 1;
+	}
+	return count;
+}
+
+#define PARSE_ROUNDS 200
+
+static int bench_parse(const struct bench_opts *opts)
+{
+	unsigned int states = opts->loops > 100000 ? 100000 : opts->loops;
+	unsigned long *freq, *table;
+	unsigned long long *time;
+	char *tis, *trans;
+	size_t tis_len = 0, trans_len = 0;
+	unsigned int i, n = 0;
+	double start, t_new, t_old, t_trans;
+
+	tis = make_time_in_state(states, &tis_len);
+	trans = make_trans_table_body(states > 1000 ? 1000 : states, &trans_len);
+	freq = malloc(states * sizeof(*freq));
+	time = malloc(states * sizeof(*time));
+	table = malloc(trans_len / 2 * sizeof(*table));
+	if (!tis || !trans || !freq || !time || !table) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	start = now();
+	for (i = 0; i < PARSE_ROUNDS; i++)
+		n += sysfs_parse_pairs(tis, tis_len, freq, time, states);
+	t_new = now() - start;
+
+	start = now();
+	for (i = 0; i < PARSE_ROUNDS; i++)
+		n += sscanf_pairs(tis, tis_len, freq, time, states);
+	t_old = now() - start;
+
+	/* the row labels "freq:" stop sysfs_parse_ulongs(), so parse
+	 * line by line as a trans_table parser has to */
+	start = now();
+	for (i = 0; i < PARSE_ROUNDS; i++) {
+		const char *pos = trans, *end = trans + trans_len;
+		unsigned long long label;
+
+		while (!sysfs_parse_number(&pos, end, &label) && *pos == ':') {
+			const char *eol = memchr(pos, '\n', end - pos);
+			if (!eol)
+				eol = end;
+			n += sysfs_parse_ulongs(pos + 1, eol - pos - 1, table, trans_len / 2);
+			pos = eol;
+		}
+	}
+	t_trans = now() - start;
+
+	printf("time_in_state, %u states (%zu bytes):\n", states, tis_len);
+	printf("  sysfs_parse_pairs: %8.1f MB/s\n", tis_len * PARSE_ROUNDS / t_new / 1e6);
+	printf("  token + sscanf:    %8.1f MB/s\n", tis_len * PARSE_ROUNDS / t_old / 1e6);
+	printf("trans_table body (%zu bytes):\n", trans_len);
+	printf("  sysfs_parse_ulongs: %7.1f MB/s\n", trans_len * PARSE_ROUNDS / t_trans / 1e6);
+	printf("(%u numbers)\n", n);
+
+	free(tis);
+	free(trans);
+	free(freq);
+	free(time);
+	free(table);
+	return 0;
+}
+
+
+/* each parser returns the number of values it found, -EINVAL or
+ * -EOVERFLOW if it rejected the input, or REPLAY_BROKEN if it broke one
+ * of its promises */
+
+#define REPLAY_BROKEN	INT_MIN
+
+static int replay_time_in_state(const char *buf, size_t len)
+{
+	unsigned long freq[CPUFREQ_MAX_STATES + 1];
+	unsigned long long time[CPUFREQ_MAX_STATES + 1];
+	unsigned int n;
+
+	freq[CPUFREQ_MAX_STATES] = 0;
+	time[CPUFREQ_MAX_STATES] = 0;
+	n = sysfs_parse_pairs(buf, len, freq, time, CPUFREQ_MAX_STATES);
+	if (n > CPUFREQ_MAX_STATES || freq[CPUFREQ_MAX_STATES] || time[CPUFREQ_MAX_STATES])
+		return REPLAY_BROKEN;
+	return n;
+}
+
+static int replay_trans_table(const char *buf, size_t len)
+{
+	static unsigned long freqs[CPUFREQ_MAX_STATES];
+	static unsigned int counts[CPUFREQ_MAX_STATES * CPUFREQ_MAX_STATES];
+	struct sysfs_trans_parse tp = {
+		.freqs = freqs,
+		.counts = counts,
+		.max = CPUFREQ_MAX_STATES,
+	};
+	const char *line = buf, *end = buf + len, *eol;
+	int ret = 0;
+
+	/* line by line without the newline, as sysfs_get_trans_matrix() */
+	while (!ret && line < end) {
+		eol = memchr(line, '\n', end - line);
+		if (!eol)
+			eol = end;
+		ret = sysfs_parse_trans_line(&tp, line, eol - line);
+		line = eol + 1;
+	}
+	if (tp.n > tp.max || tp.lines > tp.n + 2)
+		return REPLAY_BROKEN;
+	if (ret || !tp.n || tp.lines != tp.n + 2)
+		return -EINVAL;
+	return tp.n * tp.n;
+}
+
+static int replay_cpulist(const char *buf, size_t len)
+{
+	unsigned long bits[CPUFREQ_MAX_CPUS / CPUFREQ_CPUMASK_BITS + 1];
+	unsigned int n, i, set = 0;
+	int overflow;
+
+	memset(bits, 0, sizeof(bits));
+	n = sysfs_parse_cpulist(buf, len, bits, CPUFREQ_MAX_CPUS, &overflow);
+	for (i = 0; i < CPUFREQ_MAX_CPUS / CPUFREQ_CPUMASK_BITS; i++)
+		set += __builtin_popcountl(bits[i]);
+	if (bits[CPUFREQ_MAX_CPUS / CPUFREQ_CPUMASK_BITS] || (n && n != set))
+		return REPLAY_BROKEN;
+	return overflow ? -EOVERFLOW : (int) n;
+}
+
+static const struct {
+	const char *name;
+	int (*parse)(const char *buf, size_t len);
+} replay_parsers[] = {
+	{ "time_in_state",	replay_time_in_state },
+	{ "trans_table",	replay_trans_table },
+	{ "cpulist",		replay_cpulist },
+	{ NULL,			NULL },
+};
+
+/* the result for the whole file; REPLAY_BROKEN if the parser broke its
+ * promises for any prefix of it */
+static int replay_file(const char *path, int (*parse)(const char *buf, size_t len))
+{
+	static char input[64 * 1024];
+	FILE *f;
+	size_t len, i;
+	char *buf;
+	int n = 0;
+
+	f = fopen(path, "r");
+	if (!f)
+		return REPLAY_BROKEN;
+	len = fread(input, 1, sizeof(input), f);
+	fclose(f);
+
+	/* a copy of exactly len bytes, so that reading beyond it shows */
+	for (i = 0; i <= len && n != REPLAY_BROKEN; i++) {
+		buf = malloc(i ? i : 1);
+		if (!buf)
+			return REPLAY_BROKEN;
+		memcpy(buf, input, i);
+		n = parse(buf, i);
+		free(buf);
+	}
+	return n;
+}
+
+/* the contents of path.expect, or REPLAY_BROKEN if there is none */
+static int replay_expect(const char *path)
+{
+	char expect[4096 + sizeof(".expect")], word[32];
+	FILE *f;
+	int n = REPLAY_BROKEN;
+
+	snprintf(expect, sizeof(expect), "%s.expect", path);
+	f = fopen(expect, "r");
+	if (!f)
+		return REPLAY_BROKEN;
+	if (fscanf(f, "%31s", word) == 1)
+		n = !strcmp(word, "-EINVAL") ? -EINVAL :
+		    !strcmp(word, "-EOVERFLOW") ? -EOVERFLOW : atoi(word);
+	fclose(f);
+	return n;
+}
+
+static void replay_print(int n)
+{
+	if (n == -EINVAL)
+		printf("-EINVAL");
+	else if (n == -EOVERFLOW)
+		printf("-EOVERFLOW");
+	else if (n == REPLAY_BROKEN)
+		printf("broken");
+	else
+		printf("%d values", n);
+}
+
+static int bench_replay(const struct bench_opts *opts)
+{
+	struct dirent **names;
+	char path[4096];
+	const char *name;
+	size_t len;
+	unsigned int i, failed = 0;
+	int nr, j, n, expect;
+
+	nr = scandir(opts->dir, &names, NULL, alphasort);
+	if (nr < 0) {
+		perror(opts->dir);
+		return 1;
+	}
+
+	for (j = 0; j < nr; j++) {
+		name = names[j]->d_name;
+		len = strlen(name);
+		if (len > 7 && !strcmp(name + len - 7, ".expect"))
+			continue;
+		len = strcspn(name, ".");
+		for (i = 0; replay_parsers[i].name; i++)
+			if (len == strlen(replay_parsers[i].name) &&
+			    !strncmp(name, replay_parsers[i].name, len))
+				break;
+		if (!replay_parsers[i].name)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", opts->dir, name);
+		n = replay_file(path, replay_parsers[i].parse);
+		expect = replay_expect(path);
+
+		printf("  %-32s ", name);
+		replay_print(n);
+		if (n == REPLAY_BROKEN || n != expect) {
+			printf(", FAILED (expected ");
+			replay_print(expect);
+			printf(")");
+			failed++;
+		}
+		printf("\n");
+	}
+
+	for (j = 0; j < nr; j++)
+		free(names[j]);
+	free(names);
+
+	printf("%u failed\n", failed);
+	return failed ? 1 : 0;
+}
+
+#define STATS_READ_ROUNDS 20
+
+/* what consumers of the list API do: match the states of two lists by
+ * frequency and sum up the deltas of one CPU */
+static unsigned long diff_lists(const struct cpufreq_stats *before,
+				const struct cpufreq_stats *after)
+{
+	const struct cpufreq_stats *a, *b = before;
+	unsigned long long total = 0, weighted = 0, value;
+
+	for (a = after; a; a = a->next) {
+		if (!b || b->frequency != a->frequency)
+			for (b = before; b && b->frequency != a->frequency; b = b->next)
+				;
+		if (!b)
+			continue;
+		value = a->time_in_state - b->time_in_state;
+		total += value;
+		weighted += value * a->frequency;
+		b = b->next;
+	}
+
+	return total ? weighted / total : 0;
+}
+
+static int bench_stats(const struct bench_opts *opts)
+{
+	struct cpufreq_stats_sample *before, *after;
+	struct cpufreq_stats_delta *delta;
+	struct cpufreq_stats **lists_before, **lists_after;
+	unsigned long long total_time, cells;
+	unsigned long i, deltas = opts->loops / 100 ? opts->loops / 100 : 1, sum = 0;
+	unsigned int j;
+	double start, t_sample, t_lists, t_delta, t_diff;
+
+	before = cpufreq_get_stats_sample(NULL, 0);
+	after = cpufreq_get_stats_sample(NULL, 0);
+	if (!before || !after || !before->nr_states) {
+		fprintf(stderr, "couldn't read time in state stats\n");
+		return 1;
+	}
+	cells = (unsigned long long) after->nr_cpus * after->nr_states;
+	lists_before = calloc(after->nr_cpus, sizeof(*lists_before));
+	lists_after = calloc(after->nr_cpus, sizeof(*lists_after));
+	if (!lists_before || !lists_after) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	start = now();
+	for (i = 0; i < STATS_READ_ROUNDS; i++)
+		cpufreq_refresh_stats_sample(after);
+	t_sample = now() - start;
+
+	start = now();
+	for (i = 0; i < STATS_READ_ROUNDS; i++)
+		for (j = 0; j < after->nr_cpus; j++) {
+			cpufreq_put_stats(lists_after[j]);
+			lists_after[j] = cpufreq_get_stats(after->cpu[j], &total_time);
+		}
+	t_lists = now() - start;
+
+	/* a static tree has no deltas; make some up */
+	srand(1);
+	for (i = 0; i < cells; i++)
+		after->time_in_state[i] = before->time_in_state[i] + rand() % 1000;
+	for (j = 0; j < after->nr_cpus; j++) {
+		struct cpufreq_stats *entry;
+
+		lists_before[j] = cpufreq_get_stats(after->cpu[j], &total_time);
+		for (entry = lists_after[j]; entry; entry = entry->next)
+			entry->time_in_state += rand() % 1000;
+	}
+
+	delta = cpufreq_get_stats_delta(before, after);
+	if (!delta) {
+		fprintf(stderr, "couldn't compute delta\n");
+		return 1;
+	}
+	start = now();
+	for (i = 0; i < deltas; i++)
+		cpufreq_refresh_stats_delta(delta, before, after);
+	t_delta = now() - start;
+
+	start = now();
+	for (i = 0; i < deltas; i++)
+		for (j = 0; j < after->nr_cpus; j++)
+			sum += diff_lists(lists_before[j], lists_after[j]);
+	t_diff = now() - start;
+
+	printf("%u CPUs x %u states:\n", after->nr_cpus, after->nr_states);
+	printf("  read sample:        %10.1f us\n", t_sample * 1e6 / STATS_READ_ROUNDS);
+	printf("  read lists:         %10.1f us\n", t_lists * 1e6 / STATS_READ_ROUNDS);
+	printf("  delta:              %10.1f us, %6.2f ns/cell\n",
+	       t_delta * 1e6 / deltas, t_delta * 1e9 / deltas / cells);
+	printf("  diff lists:         %10.1f us, %6.2f ns/cell\n",
+	       t_diff * 1e6 / deltas, t_diff * 1e9 / deltas / cells);
+	printf("(average %lu kHz, %lu)\n", delta->avg_frequency_all, sum / deltas / after->nr_cpus);
+
+	for (j = 0; j < after->nr_cpus; j++) {
+		cpufreq_put_stats(lists_before[j]);
+		cpufreq_put_stats(lists_after[j]);
+	}
+	free(lists_before);
+	free(lists_after);
+	cpufreq_put_stats_delta(delta);
+	cpufreq_put_stats_sample(before);
+	cpufreq_put_stats_sample(after);
+	return 0;
+}
+
+static int bench_session(const struct bench_opts *opts)
+{
+	struct cpufreq_freq_session *session;
+	unsigned long freq[2], i;
+	double start, t_set, t_session;
+
+	if (cpufreq_get_hardware_limits(opts->cpu, &freq[0], &freq[1])) {
+		fprintf(stderr, "couldn't read limits of CPU %u\n", opts->cpu);
+		return 1;
+	}
+
+	session = cpufreq_freq_session_begin(opts->cpu);
+	if (!session) {
+		fprintf(stderr, "couldn't begin a session on CPU %u\n", opts->cpu);
+		return 1;
+	}
+	start = now();
+	for (i = 0; i < opts->loops; i++)
+		if (cpufreq_freq_session_set(session, freq[i & 1])) {
+			fprintf(stderr, "couldn't set frequency\n");
+			break;
+		}
+	t_session = now() - start;
+	if (cpufreq_freq_session_end(session))
+		fprintf(stderr, "couldn't restore the policy\n");
+
+	start = now();
+	for (i = 0; i < opts->loops; i++)
+		if (cpufreq_set_frequency(opts->cpu, freq[i & 1])) {
+			fprintf(stderr, "couldn't set frequency\n");
+			break;
+		}
+	t_set = now() - start;
+
+	printf("setting %lu frequencies on CPU %u:\n", opts->loops, opts->cpu);
+	printf("  cpufreq_set_frequency: %12.0f calls/s\n", opts->loops / t_set);
+	printf("  session:               %12.0f calls/s (%.2fx)\n",
+	       opts->loops / t_session, t_set / t_session);
+	return 0;
+}
+
+static const struct {
+	const char *name;
+	int (*run)(const struct bench_opts *opts);
+} tests[] = {
+	{ "freq",	bench_freq },
+	{ "alloc",	bench_alloc },
+	{ "parse",	bench_parse },
+	{ "stats",	bench_stats },
+	{ "session",	bench_session },
+	{ "replay",	bench_replay },
+	{ NULL,		NULL },
+};
+
+static void usage(void)
+{
+	unsigned int i;
+
+	fprintf(stderr, "Usage: libcpufreq-bench TEST [-c CPU] [-n LOOPS] [-d DIR]\n");
+	fprintf(stderr, "Tests:");
+	for (i = 0; tests[i].name; i++)
+		fprintf(stderr, " %s", tests[i].name);
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_opts opts = {
+		.cpu = 0,
+		.loops = 100000,
+		.dir = "corpus",
+	};
+	unsigned int i;
+	int c;
+
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+
+	optind = 2;
+	while ((c = getopt(argc, argv, "c:n:d:")) != -1) {
+		switch (c) {
+		case 'c':
+			opts.cpu = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			opts.loops = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			opts.dir = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	for (i = 0; tests[i].name; i++)
+		if (!strcmp(argv[1], tests[i].name))
+			return tests[i].run(&opts);
+
+	usage();
+	return 1;
+}
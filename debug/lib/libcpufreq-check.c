@@ -0,0 +1,305 @@
+/*
+ * regression checks for libcpufreq
+ *
+ * (C) 2026 cpufrequtils contributors
+ *
+ * Licensed under the terms of the GNU GPL License version 2.
+ *
+ * Build libcpufreq first, then run "make check" in this directory, which
+ * creates a fake sysfs tree of 8 CPUs in pairs sharing a policy with
+ * cpufreq-fake-sysfs.sh and runs all checks against it. To run them by
+ * hand:
+ *   LD_LIBRARY_PATH=../.. ./libcpufreq-check -r ROOT [CHECK...]
+ * The checks write to the tree, so give them a copy of it.
+ *
+ * Available checks:
+ *   elide    a cached write elision entry is shared by the CPUs of a
+ *            policy, so that a write through one CPU isn't skipped after
+ *            another one changed the value through its sibling
+ *   fdcache  threads reading through an fd cache far too small for all
+ *            files, while another one invalidates it, all see the right
+ *            values, and no file is left open afterwards
+ *   arena    a policy that can't be read completely leaves the arena as
+ *            it was before
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "cpufreq.h"
+
+static const char *root;
+
+static FILE * open_policy_file(unsigned int policy, const char *name, const char *mode)
+{
+	char path[4096];
+
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpufreq/policy%u/%s",
+		 root, policy, name);
+	return fopen(path, mode);
+}
+
+static int read_policy_file(unsigned int policy, const char *name, unsigned long *value)
+{
+	FILE *f;
+	int ret;
+
+	f = open_policy_file(policy, name, "r");
+	if (!f)
+		return -1;
+	ret = fscanf(f, "%lu", value) == 1 ? 0 : -1;
+	fclose(f);
+	return ret;
+}
+
+static int write_policy_file(unsigned int policy, const char *name, unsigned long value)
+{
+	FILE *f;
+	int ret;
+
+	f = open_policy_file(policy, name, "w");
+	if (!f)
+		return -1;
+	ret = fprintf(f, "%lu\n", value) > 0 ? 0 : -1;
+	if (fclose(f))
+		ret = -1;
+	return ret;
+}
+
+#define CHECK(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: %s\n", __func__,	\
+				__LINE__, #cond);			\
+			goto out;					\
+		}							\
+	} while (0)
+
+static int check_elide(struct cpufreq_ctx *ctx)
+{
+	unsigned long min, max, value, elided;
+	int ret = 1;
+
+	CHECK(!cpufreq_ctx_set_write_elision(ctx, CPUFREQ_ELIDE_CACHED));
+	CHECK(!read_policy_file(0, "cpuinfo_min_freq", &min));
+	CHECK(!read_policy_file(0, "cpuinfo_max_freq", &max));
+
+	/* CPU 0 and 1 share policy0 */
+	CHECK(!cpufreq_ctx_modify_policy_max(ctx, 0, max));
+	CHECK(!cpufreq_ctx_modify_policy_max(ctx, 1, min));
+	CHECK(!read_policy_file(0, "scaling_max_freq", &value) && value == min);
+	elided = cpufreq_ctx_get_elided_writes(ctx);
+
+	/* must not be skipped: CPU 0 last wrote the same value */
+	CHECK(!cpufreq_ctx_modify_policy_max(ctx, 0, max));
+	CHECK(!read_policy_file(0, "scaling_max_freq", &value) && value == max);
+	CHECK(cpufreq_ctx_get_elided_writes(ctx) == elided);
+
+	/* but through the sibling it can be */
+	CHECK(!cpufreq_ctx_modify_policy_max(ctx, 1, max));
+	CHECK(cpufreq_ctx_get_elided_writes(ctx) == elided + 1);
+
+	ret = 0;
+ out:
+	cpufreq_ctx_set_write_elision(ctx, CPUFREQ_ELIDE_NONE);
+	return ret;
+}
+
+#define FDCACHE_CPUS	8
+#define FDCACHE_THREADS	8
+#define FDCACHE_READS	200000
+
+struct fdcache_thread {
+	struct cpufreq_ctx *ctx;
+	const unsigned long *expect;
+	unsigned int id;
+	unsigned long wrong;
+};
+
+static int stop_invalidating;
+
+static void * fdcache_reader(void *arg)
+{
+	struct fdcache_thread *t = arg;
+	unsigned int i, cpu;
+
+	for (i = 0; i < FDCACHE_READS; i++) {
+		cpu = (i + t->id) % FDCACHE_CPUS;
+		if (cpufreq_ctx_get_freq_kernel(t->ctx, cpu) != t->expect[cpu])
+			t->wrong++;
+	}
+	return NULL;
+}
+
+static void * fdcache_invalidator(void *arg)
+{
+	struct cpufreq_ctx *ctx = arg;
+	unsigned int cpu = 0;
+
+	while (!__atomic_load_n(&stop_invalidating, __ATOMIC_RELAXED))
+		cpufreq_ctx_fd_cache_invalidate(ctx, cpu++ % FDCACHE_CPUS);
+	return NULL;
+}
+
+static unsigned int open_fds(void)
+{
+	unsigned int count = 0;
+	DIR *dir;
+
+	dir = opendir("/proc/self/fd");
+	if (!dir)
+		return 0;
+	while (readdir(dir))
+		count++;
+	closedir(dir);
+	return count;
+}
+
+static int check_fdcache(struct cpufreq_ctx *ctx)
+{
+	struct fdcache_thread t[FDCACHE_THREADS];
+	pthread_t threads[FDCACHE_THREADS], invalidator;
+	unsigned long expect[FDCACHE_CPUS], wrong = 0;
+	unsigned int i, fds;
+	int ret = 1;
+
+	for (i = 0; i < FDCACHE_CPUS; i++)
+		CHECK(!read_policy_file(i & ~1U, "scaling_cur_freq", &expect[i]));
+
+	fds = open_fds();
+	/* fewer entries than files, so that they are swept out all the time */
+	CHECK(!cpufreq_ctx_fd_cache_enable(ctx, FDCACHE_CPUS / 4));
+
+	stop_invalidating = 0;
+	CHECK(!pthread_create(&invalidator, NULL, fdcache_invalidator, ctx));
+	for (i = 0; i < FDCACHE_THREADS; i++) {
+		t[i].ctx = ctx;
+		t[i].expect = expect;
+		t[i].id = i;
+		t[i].wrong = 0;
+		if (pthread_create(&threads[i], NULL, fdcache_reader, &t[i]))
+			break;
+	}
+	while (i--) {
+		pthread_join(threads[i], NULL);
+		wrong += t[i].wrong;
+	}
+	__atomic_store_n(&stop_invalidating, 1, __ATOMIC_RELAXED);
+	pthread_join(invalidator, NULL);
+	CHECK(wrong == 0);
+
+	cpufreq_ctx_fd_cache_disable(ctx);
+	CHECK(open_fds() == fds);
+
+	ret = 0;
+ out:
+	cpufreq_ctx_fd_cache_disable(ctx);
+	return ret;
+}
+
+static int check_arena(struct cpufreq_ctx *ctx)
+{
+	static char buf[4096];
+	struct cpufreq_arena arena, before;
+	unsigned long max = 0;
+	int ret = 1;
+
+	cpufreq_arena_init(&arena, buf, sizeof(buf));
+	CHECK(cpufreq_ctx_get_policy(ctx, 0, &arena));
+	before = arena;
+
+	/* policy2 has a governor, but no limits */
+	CHECK(!read_policy_file(2, "scaling_max_freq", &max));
+	CHECK(!write_policy_file(2, "scaling_max_freq", 0));
+	CHECK(!cpufreq_ctx_get_policy(ctx, 2, &arena));
+	CHECK(arena.used == before.used && arena.last == before.last &&
+	      arena.nr_allocs == before.nr_allocs);
+
+	ret = 0;
+ out:
+	if (max)
+		write_policy_file(2, "scaling_max_freq", max);
+	return ret;
+}
+
+static const struct {
+	const char *name;
+	int (*run)(struct cpufreq_ctx *ctx);
+} checks[] = {
+	{ "elide",	check_elide },
+	{ "fdcache",	check_fdcache },
+	{ "arena",	check_arena },
+	{ NULL,		NULL },
+};
+
+static int run_check(unsigned int i)
+{
+	struct cpufreq_ctx *ctx;
+	int ret;
+
+	/* a context of its own, so that no check sees another one's state */
+	ctx = cpufreq_ctx_open(root);
+	if (!ctx) {
+		fprintf(stderr, "couldn't open a context for %s\n", root);
+		return 1;
+	}
+	ret = checks[i].run(ctx);
+	cpufreq_ctx_close(ctx);
+
+	printf("  %-16s %s\n", checks[i].name, ret ? "FAILED" : "ok");
+	return ret;
+}
+
+static void usage(void)
+{
+	unsigned int i;
+
+	fprintf(stderr, "Usage: libcpufreq-check -r ROOT [CHECK...]\n");
+	fprintf(stderr, "Checks:");
+	for (i = 0; checks[i].name; i++)
+		fprintf(stderr, " %s", checks[i].name);
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, failed = 0;
+	int c, j;
+
+	while ((c = getopt(argc, argv, "r:")) != -1) {
+		switch (c) {
+		case 'r':
+			root = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	if (!root) {
+		usage();
+		return 1;
+	}
+
+	if (optind == argc) {
+		for (i = 0; checks[i].name; i++)
+			failed += run_check(i);
+	}
+	for (j = optind; j < argc; j++) {
+		for (i = 0; checks[i].name; i++)
+			if (!strcmp(argv[j], checks[i].name))
+				break;
+		if (!checks[i].name) {
+			usage();
+			return 1;
+		}
+		failed += run_check(i);
+	}
+
+	printf("%u failed\n", failed);
+	return failed ? 1 : 0;
+}
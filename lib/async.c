@@ -0,0 +1,671 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Batched asynchronous reads of cpufreq sysfs files.
+ *
+ * Reading some files, cpuinfo_cur_freq in particular, makes the driver
+ * ask the hardware, which may take milliseconds. To read many of them at
+ * once, all reads of a batch are submitted in one go and run in parallel,
+ * using io_uring where available and a pool of threads otherwise.
+ *
+ * Reads go into bounce buffers owned by the engine, one per slot. A read
+ * which misses the deadline can't be aborted inside the driver, so its
+ * slot is orphaned: the request fails with -ETIMEDOUT, and the slot is
+ * reused only once the read has returned. Late results therefore never
+ * touch the caller's buffers.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#ifndef IORING_FEAT_EXT_ARG
+#undef HAVE_IO_URING
+#endif
+#endif
+
+#include "cpufreq.h"
+#include "sysfs.h"
+
+#define ASYNC_BUF_LEN		4096
+#define ASYNC_DEFAULT_DEPTH	64
+#define ASYNC_MAX_THREADS	16
+#define SYSFS_PATH_MAX		255
+
+enum {
+	SLOT_FREE,
+	SLOT_QUEUED,	/* waiting for a worker thread */
+	SLOT_BUSY,	/* read in progress */
+	SLOT_DONE,	/* read finished, result not yet passed on */
+	SLOT_ORPHAN,	/* read in progress, but its request timed out */
+};
+
+struct async_slot {
+	int state;
+	int fd;
+	int result;
+	struct cpufreq_read_request *req;
+	char buf[ASYNC_BUF_LEN];
+};
+
+struct cpufreq_async {
+	struct cpufreq_ctx *ctx;
+	int backend;
+	unsigned int depth;
+	struct async_slot *slots;
+
+#ifdef HAVE_IO_URING
+	int ring_fd;
+	void *sq_ptr;
+	void *cq_ptr;
+	size_t sq_len;
+	size_t cq_len;
+	struct io_uring_sqe *sqes;
+	size_t sqes_len;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned int to_submit;
+#endif
+
+	pthread_t threads[ASYNC_MAX_THREADS];
+	unsigned int nr_threads;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	int quit;
+};
+
+
+/* slot handling common to both backends */
+
+static struct async_slot * async_free_slot(struct cpufreq_async *async)
+{
+	unsigned int i;
+
+	for (i = 0; i < async->depth; i++)
+		if (async->slots[i].state == SLOT_FREE)
+			return &async->slots[i];
+
+	return NULL;
+}
+
+static int async_open(struct cpufreq_async *async, struct async_slot *slot,
+		      struct cpufreq_read_request *req)
+{
+	char path[SYSFS_PATH_MAX];
+
+	if (!req->buf || !req->buflen || !req->file ||
+	    sysfs_cpufreq_path(async->ctx, path, sizeof(path), req->cpu, req->file)) {
+		req->result = -EINVAL;
+		return -EINVAL;
+	}
+
+	slot->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (slot->fd < 0) {
+		req->result = -errno;
+		return req->result;
+	}
+
+	slot->req = req;
+	slot->result = 0;
+	return 0;
+}
+
+/* pass the result of a finished read on to its request, if any */
+static void async_finish(struct async_slot *slot)
+{
+	struct cpufreq_read_request *req = slot->req;
+	size_t len;
+
+	if (req) {
+		if (slot->result > 0) {
+			len = slot->result;
+			if (len > req->buflen - 1)
+				len = req->buflen - 1;
+			memcpy(req->buf, slot->buf, len);
+			req->buf[len] = '\0';
+			req->result = len;
+		} else {
+			req->result = slot->result ? slot->result : -ENODATA;
+		}
+	}
+
+	close(slot->fd);
+	slot->req = NULL;
+	slot->state = SLOT_FREE;
+}
+
+static int async_expired(const struct timespec *deadline)
+{
+	struct timespec now;
+
+	if (!deadline)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec > deadline->tv_sec ||
+		(now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec));
+}
+
+/* fail all requests of the current batch which are still pending */
+static void async_expire(struct cpufreq_async *async)
+{
+	struct async_slot *slot;
+	unsigned int i;
+
+	for (i = 0; i < async->depth; i++) {
+		slot = &async->slots[i];
+		if (!slot->req)
+			continue;
+		switch (slot->state) {
+		case SLOT_QUEUED:
+			slot->req->result = -ETIMEDOUT;
+			slot->req = NULL;
+			close(slot->fd);
+			slot->state = SLOT_FREE;
+			break;
+		case SLOT_BUSY:
+			slot->req->result = -ETIMEDOUT;
+			slot->req = NULL;
+			slot->state = SLOT_ORPHAN;
+			break;
+		case SLOT_DONE:
+			async_finish(slot);
+			break;
+		}
+	}
+}
+
+
+/* io_uring backend
+ *
+ * Uses the raw system calls, so that no liburing is needed. Waiting with
+ * a timeout needs IORING_FEAT_EXT_ARG (Linux 5.11); on older kernels the
+ * thread pool is used instead.
+ */
+
+#ifdef HAVE_IO_URING
+
+static int uring_setup(struct cpufreq_async *async)
+{
+	struct io_uring_params p;
+	void *ptr;
+
+	memset(&p, 0, sizeof(p));
+	async->ring_fd = syscall(__NR_io_uring_setup, async->depth, &p);
+	if (async->ring_fd < 0)
+		return -errno;
+
+	if (!(p.features & IORING_FEAT_EXT_ARG) ||
+	    !(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		close(async->ring_fd);
+		return -ENOSYS;
+	}
+
+	async->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	async->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (async->cq_len > async->sq_len)
+		async->sq_len = async->cq_len;
+	async->cq_len = 0;	/* shares the mapping of the SQ ring */
+
+	ptr = mmap(NULL, async->sq_len, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, async->ring_fd, IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED)
+		goto error_out;
+	async->sq_ptr = async->cq_ptr = ptr;
+
+	async->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	async->sqes = mmap(NULL, async->sqes_len, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, async->ring_fd, IORING_OFF_SQES);
+	if (async->sqes == MAP_FAILED) {
+		munmap(ptr, async->sq_len);
+		goto error_out;
+	}
+
+	async->sq_head = (unsigned int *) ((char *) ptr + p.sq_off.head);
+	async->sq_tail = (unsigned int *) ((char *) ptr + p.sq_off.tail);
+	async->sq_mask = (unsigned int *) ((char *) ptr + p.sq_off.ring_mask);
+	async->sq_array = (unsigned int *) ((char *) ptr + p.sq_off.array);
+	async->cq_head = (unsigned int *) ((char *) ptr + p.cq_off.head);
+	async->cq_tail = (unsigned int *) ((char *) ptr + p.cq_off.tail);
+	async->cq_mask = (unsigned int *) ((char *) ptr + p.cq_off.ring_mask);
+	async->cqes = (struct io_uring_cqe *) ((char *) ptr + p.cq_off.cqes);
+	async->to_submit = 0;
+
+	return 0;
+
+ error_out:
+	close(async->ring_fd);
+	return -ENOMEM;
+}
+
+static void uring_queue_read(struct cpufreq_async *async, struct async_slot *slot)
+{
+	unsigned int tail = *async->sq_tail;
+	unsigned int index = tail & *async->sq_mask;
+	struct io_uring_sqe *sqe = &async->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = slot->fd;
+	sqe->addr = (uintptr_t) slot->buf;
+	sqe->len = ASYNC_BUF_LEN - 1;
+	sqe->off = 0;
+	sqe->user_data = slot - async->slots;
+
+	async->sq_array[index] = index;
+	__atomic_store_n(async->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	async->to_submit++;
+	slot->state = SLOT_BUSY;
+}
+
+/* submit queued reads, and wait for at least one completion unless
+ * wait is zero or the deadline passes */
+static int uring_enter(struct cpufreq_async *async, int wait,
+		       const struct timespec *deadline)
+{
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	struct timespec now;
+	unsigned int flags = 0;
+	long ret;
+
+	memset(&arg, 0, sizeof(arg));
+	if (wait) {
+		flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+		if (deadline) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ts.tv_sec = deadline->tv_sec - now.tv_sec;
+			ts.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+			if (ts.tv_nsec < 0) {
+				ts.tv_sec--;
+				ts.tv_nsec += 1000000000;
+			}
+			if (ts.tv_sec < 0)
+				ts.tv_sec = ts.tv_nsec = 0;
+			arg.ts = (uintptr_t) &ts;
+		}
+	}
+
+	ret = syscall(__NR_io_uring_enter, async->ring_fd, async->to_submit,
+		      wait ? 1 : 0, flags, wait ? &arg : NULL, sizeof(arg));
+	if (ret < 0)
+		return (errno == ETIME || errno == EINTR) ? 0 : -errno;
+
+	async->to_submit -= ret;
+	return 0;
+}
+
+static unsigned int uring_reap(struct cpufreq_async *async)
+{
+	unsigned int head = *async->cq_head;
+	unsigned int done = 0;
+	struct io_uring_cqe *cqe;
+	struct async_slot *slot;
+
+	while (head != __atomic_load_n(async->cq_tail, __ATOMIC_ACQUIRE)) {
+		cqe = &async->cqes[head & *async->cq_mask];
+		if (cqe->user_data < async->depth) {
+			slot = &async->slots[cqe->user_data];
+			slot->result = cqe->res;
+			if (slot->req)
+				done++;
+			async_finish(slot);
+		}
+		head++;
+	}
+	__atomic_store_n(async->cq_head, head, __ATOMIC_RELEASE);
+
+	return done;
+}
+
+static void uring_cancel(struct cpufreq_async *async, struct async_slot *slot)
+{
+	unsigned int tail = *async->sq_tail;
+	unsigned int index = tail & *async->sq_mask;
+	struct io_uring_sqe *sqe = &async->sqes[index];
+
+	/* never overwrite entries the kernel has not consumed yet */
+	if (tail - __atomic_load_n(async->sq_head, __ATOMIC_ACQUIRE) > *async->sq_mask)
+		return;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = slot - async->slots;
+	sqe->user_data = (__u64) -1;
+
+	async->sq_array[index] = index;
+	__atomic_store_n(async->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	async->to_submit++;
+}
+
+static int uring_read(struct cpufreq_async *async,
+		      struct cpufreq_read_request *reqs, unsigned int nr,
+		      const struct timespec *deadline)
+{
+	struct async_slot *slot;
+	unsigned int next = 0, pending = 0, i;
+	int ret = 0;
+
+	uring_reap(async);
+
+	while (next < nr || pending) {
+		while (next < nr && (slot = async_free_slot(async))) {
+			if (!async_open(async, slot, &reqs[next]))  {
+				uring_queue_read(async, slot);
+				pending++;
+			}
+			next++;
+		}
+
+		/* all opens failed; without free slots, orphans are still
+		 * in flight and worth waiting for */
+		if (!pending && next == nr)
+			break;
+
+		/* on errors, still detach the busy slots from reqs below */
+		ret = uring_enter(async, 1, deadline);
+		if (ret)
+			break;
+		pending -= uring_reap(async);
+
+		if (async_expired(deadline))
+			break;
+	}
+
+	/* best effort: ask the kernel to give up on late reads */
+	for (i = 0; i < async->depth; i++)
+		if (async->slots[i].req && async->slots[i].state == SLOT_BUSY)
+			uring_cancel(async, &async->slots[i]);
+	async_expire(async);
+	uring_enter(async, 0, NULL);
+
+	for (; next < nr; next++)
+		reqs[next].result = -ETIMEDOUT;
+
+	return ret;
+}
+
+static void uring_close(struct cpufreq_async *async)
+{
+	unsigned int i, busy;
+
+	/* the kernel may still write into orphaned slots */
+	do {
+		busy = 0;
+		for (i = 0; i < async->depth; i++)
+			if (async->slots[i].state != SLOT_FREE)
+				busy++;
+		if (busy) {
+			uring_enter(async, 1, NULL);
+			uring_reap(async);
+		}
+	} while (busy);
+
+	munmap(async->sqes, async->sqes_len);
+	munmap(async->sq_ptr, async->sq_len);
+	close(async->ring_fd);
+}
+
+#endif /* HAVE_IO_URING */
+
+
+/* thread pool backend */
+
+static void * thread_worker(void *data)
+{
+	struct cpufreq_async *async = data;
+	struct async_slot *slot;
+	unsigned int i;
+	ssize_t ret;
+
+	pthread_mutex_lock(&async->lock);
+	while (1) {
+		slot = NULL;
+		for (i = 0; i < async->depth && !slot; i++)
+			if (async->slots[i].state == SLOT_QUEUED)
+				slot = &async->slots[i];
+
+		if (!slot) {
+			if (async->quit)
+				break;
+			pthread_cond_wait(&async->work, &async->lock);
+			continue;
+		}
+
+		slot->state = SLOT_BUSY;
+		pthread_mutex_unlock(&async->lock);
+
+		ret = pread(slot->fd, slot->buf, ASYNC_BUF_LEN - 1, 0);
+
+		pthread_mutex_lock(&async->lock);
+		slot->result = (ret < 0) ? -errno : ret;
+		if (slot->state == SLOT_ORPHAN) {
+			close(slot->fd);
+			slot->state = SLOT_FREE;
+		} else {
+			slot->state = SLOT_DONE;
+		}
+		pthread_cond_broadcast(&async->done);
+	}
+	pthread_mutex_unlock(&async->lock);
+
+	return NULL;
+}
+
+static int thread_setup(struct cpufreq_async *async)
+{
+	pthread_condattr_t attr;
+	unsigned int i;
+
+	pthread_mutex_init(&async->lock, NULL);
+	pthread_cond_init(&async->work, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&async->done, &attr);
+	pthread_condattr_destroy(&attr);
+
+	async->nr_threads = async->depth < ASYNC_MAX_THREADS ?
+		async->depth : ASYNC_MAX_THREADS;
+	for (i = 0; i < async->nr_threads; i++) {
+		if (pthread_create(&async->threads[i], NULL, thread_worker, async))
+			break;
+	}
+	async->nr_threads = i;
+
+	return i ? 0 : -EAGAIN;
+}
+
+static int thread_read(struct cpufreq_async *async,
+		       struct cpufreq_read_request *reqs, unsigned int nr,
+		       const struct timespec *deadline)
+{
+	struct async_slot *slot;
+	unsigned int next = 0, pending = 0, finished, i;
+	int timed_out = 0;
+
+	pthread_mutex_lock(&async->lock);
+	while (next < nr || pending) {
+		while (next < nr && (slot = async_free_slot(async))) {
+			if (!async_open(async, slot, &reqs[next])) {
+				slot->state = SLOT_QUEUED;
+				pending++;
+			}
+			next++;
+		}
+		pthread_cond_broadcast(&async->work);
+
+		finished = 0;
+		for (i = 0; i < async->depth; i++) {
+			slot = &async->slots[i];
+			if (slot->req && slot->state == SLOT_DONE) {
+				async_finish(slot);
+				finished++;
+			}
+		}
+		pending -= finished;
+
+		if (!pending && next == nr)
+			break;
+		if (timed_out || async_expired(deadline))
+			break;
+		/* slots became free, queue more reads before waiting */
+		if (finished && next < nr)
+			continue;
+
+		if (deadline)
+			timed_out = (pthread_cond_timedwait(&async->done, &async->lock,
+							    deadline) == ETIMEDOUT);
+		else
+			pthread_cond_wait(&async->done, &async->lock);
+	}
+
+	async_expire(async);
+	pthread_mutex_unlock(&async->lock);
+
+	for (; next < nr; next++)
+		reqs[next].result = -ETIMEDOUT;
+
+	return 0;
+}
+
+static void thread_close(struct cpufreq_async *async)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&async->lock);
+	async->quit = 1;
+	pthread_cond_broadcast(&async->work);
+	pthread_mutex_unlock(&async->lock);
+
+	/* workers finish their current read before they exit */
+	for (i = 0; i < async->nr_threads; i++)
+		pthread_join(async->threads[i], NULL);
+
+	for (i = 0; i < async->depth; i++)
+		if (async->slots[i].state != SLOT_FREE)
+			close(async->slots[i].fd);
+
+	pthread_cond_destroy(&async->done);
+	pthread_cond_destroy(&async->work);
+	pthread_mutex_destroy(&async->lock);
+}
+
+
+/* public interface */
+
+struct cpufreq_async * sysfs_async_open(struct cpufreq_ctx *ctx, int backend,
+					unsigned int depth)
+{
+	struct cpufreq_async *async;
+	int ret = -ENOSYS;
+
+	if (backend != CPUFREQ_ASYNC_AUTO && backend != CPUFREQ_ASYNC_IO_URING &&
+	    backend != CPUFREQ_ASYNC_THREADS)
+		return NULL;
+
+	async = calloc(1, sizeof(*async));
+	if (!async)
+		return NULL;
+
+	async->ctx = ctx;
+	async->depth = depth ? depth : ASYNC_DEFAULT_DEPTH;
+	async->slots = calloc(async->depth, sizeof(*async->slots));
+	if (!async->slots) {
+		free(async);
+		return NULL;
+	}
+
+#ifdef HAVE_IO_URING
+	if (backend != CPUFREQ_ASYNC_THREADS) {
+		ret = uring_setup(async);
+		if (!ret)
+			async->backend = CPUFREQ_ASYNC_IO_URING;
+	}
+#endif
+	if (ret && backend != CPUFREQ_ASYNC_IO_URING) {
+		ret = thread_setup(async);
+		if (!ret)
+			async->backend = CPUFREQ_ASYNC_THREADS;
+	}
+
+	if (ret) {
+		free(async->slots);
+		free(async);
+		return NULL;
+	}
+
+	return async;
+}
+
+int sysfs_async_backend(const struct cpufreq_async *async)
+{
+	return async->backend;
+}
+
+int sysfs_async_read(struct cpufreq_async *async,
+		     struct cpufreq_read_request *reqs, unsigned int nr,
+		     unsigned int timeout_ms)
+{
+	struct timespec deadline;
+	unsigned int i;
+	int ret, count = 0;
+
+	for (i = 0; i < nr; i++)
+		reqs[i].result = -EINPROGRESS;
+
+	if (timeout_ms) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+#ifdef HAVE_IO_URING
+	if (async->backend == CPUFREQ_ASYNC_IO_URING)
+		ret = uring_read(async, reqs, nr, timeout_ms ? &deadline : NULL);
+	else
+#endif
+		ret = thread_read(async, reqs, nr, timeout_ms ? &deadline : NULL);
+
+	if (ret)
+		return ret;
+
+	for (i = 0; i < nr; i++)
+		if (reqs[i].result > 0)
+			count++;
+
+	return count;
+}
+
+void sysfs_async_close(struct cpufreq_async *async)
+{
+#ifdef HAVE_IO_URING
+	if (async->backend == CPUFREQ_ASYNC_IO_URING)
+		uring_close(async);
+	else
+#endif
+		thread_close(async);
+
+	free(async->slots);
+	free(async);
+}
@@ -15,22 +15,67 @@
 
 int cpufreq_cpu_exists(unsigned int cpu)
 {
-	return sysfs_cpu_exists(cpu);
+	return sysfs_cpu_exists(sysfs_default_ctx(), cpu);
+}
+
+int cpufreq_set_sysfs_root(const char *root)
+{
+	return sysfs_set_root(sysfs_default_ctx(), root);
+}
+
+void cpufreq_arena_init(struct cpufreq_arena *arena, void *buf, size_t size)
+{
+	arena->base = buf;
+	arena->size = buf ? size : 0;
+	cpufreq_arena_reset(arena);
+}
+
+void cpufreq_arena_reset(struct cpufreq_arena *arena)
+{
+	arena->used = 0;
+	arena->last = 0;
+	arena->nr_allocs = 0;
+	arena->nr_failed = 0;
+}
+
+int cpufreq_fd_cache_enable(unsigned int max_fds)
+{
+	return sysfs_fd_cache_enable(sysfs_default_ctx(), max_fds);
+}
+
+void cpufreq_fd_cache_disable(void)
+{
+	sysfs_fd_cache_disable(sysfs_default_ctx());
+}
+
+void cpufreq_fd_cache_invalidate(unsigned int cpu)
+{
+	sysfs_fd_cache_invalidate(sysfs_default_ctx(), cpu);
 }
 
 unsigned long cpufreq_get_freq_kernel(unsigned int cpu)
 {
-	return sysfs_get_freq_kernel(cpu);
+	return sysfs_get_freq_kernel(sysfs_default_ctx(), cpu);
 }
 
 unsigned long cpufreq_get_freq_hardware(unsigned int cpu)
 {
-	return sysfs_get_freq_hardware(cpu);
+	return sysfs_get_freq_hardware(sysfs_default_ctx(), cpu);
+}
+
+unsigned long cpufreq_get_cur_freq(unsigned int cpu, int mode)
+{
+	return sysfs_get_cur_freq(sysfs_default_ctx(), cpu, mode);
+}
+
+int cpufreq_set_cur_freq_mode(int mode)
+{
+	return sysfs_set_cur_freq_mode(sysfs_default_ctx(), mode);
 }
 
 unsigned long cpufreq_get_transition_latency(unsigned int cpu)
 {
-	return sysfs_get_transition_latency(cpu);
+	return sysfs_get_transition_latency(sysfs_default_ctx(), cpu);
 }
 
 int cpufreq_get_hardware_limits(unsigned int cpu,
@@ -39,11 +84,11 @@ int cpufreq_get_hardware_limits(unsigned int cpu,
 {
 	if ((!min) || (!max))
 		return -EINVAL;
-	return sysfs_get_hardware_limits(cpu, min, max);
+	return sysfs_get_hardware_limits(sysfs_default_ctx(), cpu, min, max);
 }
 
 char * cpufreq_get_driver(unsigned int cpu) {
-	return sysfs_get_driver(cpu);
+	return sysfs_get_driver(sysfs_default_ctx(), cpu, NULL);
 }
 
 void cpufreq_put_driver(char * ptr) {
@@ -53,7 +98,7 @@ void cpufreq_put_driver(char * ptr) {
 }
 
 struct cpufreq_policy * cpufreq_get_policy(unsigned int cpu) {
-	return sysfs_get_policy(cpu);
+	return sysfs_get_policy(sysfs_default_ctx(), cpu, NULL);
 }
 
 void cpufreq_put_policy(struct cpufreq_policy *policy) {
@@ -65,8 +110,58 @@ void cpufreq_put_policy(struct cpufreq_policy *policy) {
 	free(policy);
 }
 
+int cpufreq_get_policy_value(unsigned int cpu, struct cpufreq_policy_value *policy) {
+	if (!policy)
+		return -EINVAL;
+
+	return sysfs_get_policy_value(sysfs_default_ctx(), cpu, policy);
+}
+
+int cpufreq_get_governor(unsigned int cpu, char *governor, size_t len) {
+	if (!governor || !len)
+		return -EINVAL;
+
+	return sysfs_get_governor(sysfs_default_ctx(), cpu, governor, len);
+}
+
+/* the list functions are built on top of the vector functions, which
+ * read the same files but return everything in one block of memory */
+
 struct cpufreq_available_governors * cpufreq_get_available_governors(unsigned int cpu) {
-	return sysfs_get_available_governors(cpu);
+	struct cpufreq_governor_vector *vec = sysfs_get_governor_vector(sysfs_default_ctx(), cpu, NULL);
+	struct cpufreq_available_governors *first = NULL;
+	struct cpufreq_available_governors *current = NULL;
+	struct cpufreq_available_governors *tmp;
+	unsigned int i;
+
+	if (!vec)
+		return NULL;
+
+	for (i = 0; i < vec->count; i++) {
+		tmp = malloc(sizeof(*tmp));
+		if (!tmp)
+			goto error_out;
+		tmp->governor = strdup(vec->governor[i]);
+		if (!tmp->governor) {
+			free(tmp);
+			goto error_out;
+		}
+		tmp->first = first ? first : tmp;
+		tmp->next = NULL;
+		if (current)
+			current->next = tmp;
+		else
+			first = tmp;
+		current = tmp;
+	}
+
+	free(vec);
+	return first;
+
+ error_out:
+	free(vec);
+	cpufreq_put_available_governors(first);
+	return NULL;
 }
 
 void cpufreq_put_available_governors(struct cpufreq_available_governors *any) {
@@ -87,7 +182,34 @@ void cpufreq_put_available_governors(struct cpufreq_available_governors *any) {
 
 
 struct cpufreq_available_frequencies * cpufreq_get_available_frequencies(unsigned int cpu) {
-	return sysfs_get_available_frequencies(cpu);
+	struct cpufreq_frequency_vector *vec = sysfs_get_frequency_vector(sysfs_default_ctx(), cpu, NULL);
+	struct cpufreq_available_frequencies *first = NULL;
+	struct cpufreq_available_frequencies *current = NULL;
+	struct cpufreq_available_frequencies *tmp;
+	unsigned int i;
+
+	if (!vec)
+		return NULL;
+
+	for (i = 0; i < vec->count; i++) {
+		tmp = malloc(sizeof(*tmp));
+		if (!tmp) {
+			free(vec);
+			cpufreq_put_available_frequencies(first);
+			return NULL;
+		}
+		tmp->frequency = vec->frequency[i];
+		tmp->first = first ? first : tmp;
+		tmp->next = NULL;
+		if (current)
+			current->next = tmp;
+		else
+			first = tmp;
+		current = tmp;
+	}
+
+	free(vec);
+	return first;
 }
 
 void cpufreq_put_available_frequencies(struct cpufreq_available_frequencies *any) {
@@ -105,8 +227,38 @@ void cpufreq_put_available_frequencies(struct cpufreq_available_frequencies *any
 }
 
 
+static struct cpufreq_affected_cpus * cpu_vector_to_list(struct cpufreq_cpu_vector *vec) {
+	struct cpufreq_affected_cpus *first = NULL;
+	struct cpufreq_affected_cpus *current = NULL;
+	struct cpufreq_affected_cpus *tmp;
+	unsigned int i;
+
+	if (!vec)
+		return NULL;
+
+	for (i = 0; i < vec->count; i++) {
+		tmp = malloc(sizeof(*tmp));
+		if (!tmp) {
+			free(vec);
+			cpufreq_put_affected_cpus(first);
+			return NULL;
+		}
+		tmp->cpu = vec->cpu[i];
+		tmp->first = first ? first : tmp;
+		tmp->next = NULL;
+		if (current)
+			current->next = tmp;
+		else
+			first = tmp;
+		current = tmp;
+	}
+
+	free(vec);
+	return first;
+}
+
 struct cpufreq_affected_cpus * cpufreq_get_affected_cpus(unsigned int cpu) {
-	return sysfs_get_affected_cpus(cpu);
+	return cpu_vector_to_list(sysfs_get_affected_cpu_vector(sysfs_default_ctx(), cpu, NULL));
 }
 
 void cpufreq_put_affected_cpus(struct cpufreq_affected_cpus *any) {
@@ -125,29 +277,102 @@ void cpufreq_put_affected_cpus(struct cpufreq_affected_cpus *any) {
 
 
 struct cpufreq_affected_cpus * cpufreq_get_related_cpus(unsigned int cpu) {
-	return sysfs_get_related_cpus(cpu);
+	return cpu_vector_to_list(sysfs_get_related_cpu_vector(sysfs_default_ctx(), cpu, NULL));
 }
 
 void cpufreq_put_related_cpus(struct cpufreq_affected_cpus *any) {
 	cpufreq_put_affected_cpus(any);
 }
 
+int cpufreq_get_affected_cpumask(unsigned int cpu, struct cpufreq_cpumask *mask) {
+	if (!mask)
+		return -EINVAL;
+
+	return sysfs_get_affected_cpumask(sysfs_default_ctx(), cpu, mask);
+}
+
+int cpufreq_get_related_cpumask(unsigned int cpu, struct cpufreq_cpumask *mask) {
+	if (!mask)
+		return -EINVAL;
+
+	return sysfs_get_related_cpumask(sysfs_default_ctx(), cpu, mask);
+}
+
 
 int cpufreq_set_policy(unsigned int cpu, struct cpufreq_policy *policy) {
 	if (!policy || !(policy->governor))
 		return -EINVAL;
 
-	return sysfs_set_policy(cpu, policy);
+	return sysfs_set_policy(sysfs_default_ctx(), cpu, policy);
+}
+
+
+int cpufreq_set_policy_batch(struct cpufreq_policy_request *reqs,
+			     unsigned int nr) {
+	if (!reqs && nr)
+		return -EINVAL;
+
+	return sysfs_set_policy_batch(sysfs_default_ctx(), reqs, nr);
+}
+
+
+int cpufreq_set_write_elision(int mode) {
+	return sysfs_set_write_elision(sysfs_default_ctx(), mode);
+}
+
+
+unsigned long cpufreq_get_elided_writes(void) {
+	return sysfs_get_elided_writes(sysfs_default_ctx());
+}
+
+
+struct cpufreq_publisher * cpufreq_publisher_create(const char *name, const char *root,
+						    unsigned long interval_us) {
+	return sysfs_publisher_create(name, root, interval_us);
+}
+
+
+int cpufreq_publisher_update(struct cpufreq_publisher *pub) {
+	if (!pub)
+		return -EINVAL;
+
+	return sysfs_publisher_update(pub);
+}
+
+
+void cpufreq_publisher_destroy(struct cpufreq_publisher *pub) {
+	if (!pub)
+		return;
+
+	sysfs_publisher_destroy(pub);
+}
+
+
+int cpufreq_set_shm(const char *name) {
+	return sysfs_set_shm(sysfs_default_ctx(), name);
+}
+
+
+int cpufreq_set_lib_stats(int enable) {
+	return sysfs_set_lib_stats(sysfs_default_ctx(), enable);
+}
+
+
+int cpufreq_get_lib_stats(struct cpufreq_lib_stats *stats) {
+	if (!stats)
+		return -EINVAL;
+
+	return sysfs_get_lib_stats(sysfs_default_ctx(), stats);
 }
 
 
 int cpufreq_modify_policy_min(unsigned int cpu, unsigned long min_freq) {
-	return sysfs_modify_policy_min(cpu, min_freq);
+	return sysfs_modify_policy_min(sysfs_default_ctx(), cpu, min_freq);
 }
 
 
 int cpufreq_modify_policy_max(unsigned int cpu, unsigned long max_freq) {
-	return sysfs_modify_policy_max(cpu, max_freq);
+	return sysfs_modify_policy_max(sysfs_default_ctx(), cpu, max_freq);
 }
 
 
@@ -155,18 +380,81 @@ int cpufreq_modify_policy_governor(unsigned int cpu, char *governor) {
 	if ((!governor) || (strlen(governor) > 19))
 		return -EINVAL;
 
-	return sysfs_modify_policy_governor(cpu, governor);
+	return sysfs_modify_policy_governor(sysfs_default_ctx(), cpu, governor);
+}
+
+struct cpufreq_freq_session * cpufreq_freq_session_begin(unsigned int cpu) {
+	return sysfs_freq_session_begin(sysfs_default_ctx(), cpu);
+}
+
+
+int cpufreq_freq_session_set(struct cpufreq_freq_session *session,
+			     unsigned long target_frequency) {
+	if (!session)
+		return -EINVAL;
+
+	return sysfs_freq_session_set(session, target_frequency);
+}
+
+
+int cpufreq_freq_session_end(struct cpufreq_freq_session *session) {
+	if (!session)
+		return -EINVAL;
+
+	return sysfs_freq_session_end(session);
 }
 
+
+struct cpufreq_latency_report * cpufreq_measure_latency(unsigned int cpu, int method,
+							const unsigned long *freqs,
+							unsigned int nr_freqs,
+							unsigned int rounds,
+							unsigned long timeout_us) {
+	return sysfs_measure_latency(sysfs_default_ctx(), cpu, method, freqs, nr_freqs,
+				     rounds, timeout_us);
+}
+
+
+void cpufreq_put_latency_report(struct cpufreq_latency_report *report) {
+	free(report);
+}
+
+
 int cpufreq_set_frequency(unsigned int cpu, unsigned long target_frequency) {
-	return sysfs_set_frequency(cpu, target_frequency);
+	return sysfs_set_frequency(sysfs_default_ctx(), cpu, target_frequency);
 }
 
 struct cpufreq_stats * cpufreq_get_stats(unsigned int cpu, unsigned long long *total_time) {
-	struct cpufreq_stats *ret;
+	struct cpufreq_stats_table *table = sysfs_get_stats_table(sysfs_default_ctx(), cpu, NULL);
+	struct cpufreq_stats *first = NULL;
+	struct cpufreq_stats *current = NULL;
+	struct cpufreq_stats *tmp;
+	unsigned int i;
+
+	if (!table)
+		return NULL;
+
+	for (i = 0; i < table->count; i++) {
+		tmp = malloc(sizeof(*tmp));
+		if (!tmp) {
+			free(table);
+			cpufreq_put_stats(first);
+			return NULL;
+		}
+		tmp->frequency = table->frequency[i];
+		tmp->time_in_state = table->time_in_state[i];
+		tmp->first = first ? first : tmp;
+		tmp->next = NULL;
+		if (current)
+			current->next = tmp;
+		else
+			first = tmp;
+		current = tmp;
+	}
 
-	ret = sysfs_get_stats(cpu, total_time);
-	return (ret);
+	*total_time = table->total_time;
+	free(table);
+	return first;
 }
 
 void cpufreq_put_stats(struct cpufreq_stats *any) {
@@ -183,8 +471,539 @@ void cpufreq_put_stats(struct cpufreq_stats *any) {
 	}
 }
 
+struct cpufreq_governor_vector * cpufreq_get_governor_vector(unsigned int cpu) {
+	return sysfs_get_governor_vector(sysfs_default_ctx(), cpu, NULL);
+}
+
+void cpufreq_put_governor_vector(struct cpufreq_governor_vector *vec) {
+	free(vec);
+}
+
+struct cpufreq_frequency_vector * cpufreq_get_frequency_vector(unsigned int cpu) {
+	return sysfs_get_frequency_vector(sysfs_default_ctx(), cpu, NULL);
+}
+
+void cpufreq_put_frequency_vector(struct cpufreq_frequency_vector *vec) {
+	free(vec);
+}
+
+struct cpufreq_cpu_vector * cpufreq_get_affected_cpu_vector(unsigned int cpu) {
+	return sysfs_get_affected_cpu_vector(sysfs_default_ctx(), cpu, NULL);
+}
+
+struct cpufreq_cpu_vector * cpufreq_get_related_cpu_vector(unsigned int cpu) {
+	return sysfs_get_related_cpu_vector(sysfs_default_ctx(), cpu, NULL);
+}
+
+void cpufreq_put_cpu_vector(struct cpufreq_cpu_vector *vec) {
+	free(vec);
+}
+
+struct cpufreq_cpu_vector * cpufreq_get_policy_vector(void) {
+	return sysfs_get_policy_vector(sysfs_default_ctx());
+}
+
+struct cpufreq_stats_table * cpufreq_get_stats_table(unsigned int cpu) {
+	return sysfs_get_stats_table(sysfs_default_ctx(), cpu, NULL);
+}
+
+void cpufreq_put_stats_table(struct cpufreq_stats_table *table) {
+	free(table);
+}
+
+char * cpufreq_get_driver_arena(unsigned int cpu, struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_driver(sysfs_default_ctx(), cpu, arena);
+}
+
+struct cpufreq_policy * cpufreq_get_policy_arena(unsigned int cpu, struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_policy(sysfs_default_ctx(), cpu, arena);
+}
+
+struct cpufreq_governor_vector * cpufreq_get_governor_vector_arena(unsigned int cpu,
+								    struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_governor_vector(sysfs_default_ctx(), cpu, arena);
+}
+
+struct cpufreq_frequency_vector * cpufreq_get_frequency_vector_arena(unsigned int cpu,
+								      struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_frequency_vector(sysfs_default_ctx(), cpu, arena);
+}
+
+struct cpufreq_cpu_vector * cpufreq_get_affected_cpu_vector_arena(unsigned int cpu,
+								   struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_affected_cpu_vector(sysfs_default_ctx(), cpu, arena);
+}
+
+struct cpufreq_cpu_vector * cpufreq_get_related_cpu_vector_arena(unsigned int cpu,
+								  struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_related_cpu_vector(sysfs_default_ctx(), cpu, arena);
+}
+
+struct cpufreq_stats_table * cpufreq_get_stats_table_arena(unsigned int cpu,
+							    struct cpufreq_arena *arena) {
+	if (!arena)
+		return NULL;
+
+	return sysfs_get_stats_table(sysfs_default_ctx(), cpu, arena);
+}
+
+unsigned long cpufreq_frequency_vector_nearest(const struct cpufreq_frequency_vector *vec,
+					       unsigned long target) {
+	unsigned int lo, hi, mid;
+	unsigned long below, above;
+
+	if (!vec || !vec->count)
+		return 0;
+
+/* index into the frequencies as if they were sorted ascending */
+#define ASC(i) (vec->frequency[vec->descending ? vec->count - 1 - (i) : (i)])
+
+	/* find the first frequency >= target */
+	lo = 0;
+	hi = vec->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (ASC(mid) < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == vec->count)
+		return ASC(vec->count - 1);
+	if (lo == 0)
+		return ASC(0);
+
+	below = ASC(lo - 1);
+	above = ASC(lo);
+#undef ASC
+
+	return (above - target < target - below) ? above : below;
+}
+
 unsigned long cpufreq_get_transitions(unsigned int cpu) {
-	unsigned long ret = sysfs_get_transitions(cpu);
+	unsigned long ret = sysfs_get_transitions(sysfs_default_ctx(), cpu);
 
 	return (ret);
 }
+
+int cpufreq_get_snapshot(unsigned int cpu, struct cpufreq_snapshot *snap) {
+	if (!snap)
+		return -EINVAL;
+
+	return sysfs_get_snapshot(sysfs_default_ctx(), cpu, snap);
+}
+
+struct cpufreq_system_snapshot * cpufreq_get_system_snapshot(void) {
+	return sysfs_get_system_snapshot(sysfs_default_ctx());
+}
+
+int cpufreq_refresh_system_snapshot(struct cpufreq_system_snapshot *sys) {
+	if (!sys)
+		return -EINVAL;
+
+	return sysfs_refresh_system_snapshot(sys);
+}
+
+void cpufreq_put_system_snapshot(struct cpufreq_system_snapshot *sys) {
+	sysfs_put_system_snapshot(sys);
+}
+
+struct cpufreq_stats_sample * cpufreq_get_stats_sample(const unsigned int *cpus,
+						       unsigned int nr_cpus) {
+	return sysfs_get_stats_sample(sysfs_default_ctx(), cpus, nr_cpus);
+}
+
+int cpufreq_refresh_stats_sample(struct cpufreq_stats_sample *sample) {
+	if (!sample)
+		return -EINVAL;
+
+	return sysfs_refresh_stats_sample(sample);
+}
+
+void cpufreq_put_stats_sample(struct cpufreq_stats_sample *sample) {
+	sysfs_put_stats_sample(sample);
+}
+
+struct cpufreq_stats_delta * cpufreq_get_stats_delta(const struct cpufreq_stats_sample *before,
+						     const struct cpufreq_stats_sample *after) {
+	if (!before || !after)
+		return NULL;
+
+	return sysfs_get_stats_delta(before, after);
+}
+
+int cpufreq_refresh_stats_delta(struct cpufreq_stats_delta *delta,
+				const struct cpufreq_stats_sample *before,
+				const struct cpufreq_stats_sample *after) {
+	if (!delta || !before || !after)
+		return -EINVAL;
+
+	return sysfs_refresh_stats_delta(delta, before, after);
+}
+
+void cpufreq_put_stats_delta(struct cpufreq_stats_delta *delta) {
+	sysfs_put_stats_delta(delta);
+}
+
+int cpufreq_get_trans_matrix(unsigned int cpu, struct cpufreq_trans_matrix *matrix) {
+	if (!matrix)
+		return -EINVAL;
+
+	return sysfs_get_trans_matrix(sysfs_default_ctx(), cpu, matrix);
+}
+
+int cpufreq_get_trans_matrix_delta(const struct cpufreq_trans_matrix *before,
+				   const struct cpufreq_trans_matrix *after,
+				   struct cpufreq_trans_matrix *delta) {
+	if (!before || !after || !delta)
+		return -EINVAL;
+
+	return sysfs_get_trans_matrix_delta(before, after, delta);
+}
+
+unsigned int cpufreq_get_trans_hottest(const struct cpufreq_trans_matrix *matrix,
+				       struct cpufreq_trans_pair *pairs,
+				       unsigned int max) {
+	if (!matrix || !pairs)
+		return 0;
+
+	return sysfs_get_trans_hottest(matrix, pairs, max);
+}
+
+struct cpufreq_topology * cpufreq_get_topology(void) {
+	return sysfs_get_topology(sysfs_default_ctx());
+}
+
+void cpufreq_put_topology(struct cpufreq_topology *topo) {
+	sysfs_put_topology(topo);
+}
+
+struct cpufreq_async * cpufreq_async_open(int backend, unsigned int depth) {
+	return sysfs_async_open(sysfs_default_ctx(), backend, depth);
+}
+
+int cpufreq_async_backend(const struct cpufreq_async *async) {
+	if (!async)
+		return -EINVAL;
+
+	return sysfs_async_backend(async);
+}
+
+int cpufreq_async_read(struct cpufreq_async *async,
+		       struct cpufreq_read_request *reqs, unsigned int nr,
+		       unsigned int timeout_ms) {
+	if (!async || (nr && !reqs))
+		return -EINVAL;
+
+	return sysfs_async_read(async, reqs, nr, timeout_ms);
+}
+
+void cpufreq_async_close(struct cpufreq_async *async) {
+	if (!async)
+		return;
+
+	sysfs_async_close(async);
+}
+
+struct cpufreq_trace * cpufreq_trace_open(const char *save) {
+	return sysfs_trace_open(sysfs_default_ctx(), save);
+}
+
+struct cpufreq_trace * cpufreq_trace_replay(const char *path) {
+	if (!path)
+		return NULL;
+
+	return sysfs_trace_replay(path);
+}
+
+int cpufreq_trace_read(struct cpufreq_trace *trace, struct cpufreq_trace_event *events,
+		       unsigned int max, int timeout_ms) {
+	if (!trace || (max && !events))
+		return -EINVAL;
+
+	return sysfs_trace_read(trace, events, max, timeout_ms);
+}
+
+unsigned long cpufreq_trace_lost(const struct cpufreq_trace *trace) {
+	if (!trace)
+		return 0;
+
+	return sysfs_trace_lost(trace);
+}
+
+void cpufreq_trace_close(struct cpufreq_trace *trace) {
+	sysfs_trace_close(trace);
+}
+
+struct cpufreq_ctx * cpufreq_ctx_open(const char *root) {
+	return sysfs_ctx_open(root);
+}
+
+void cpufreq_ctx_close(struct cpufreq_ctx *ctx) {
+	if (!ctx)
+		return;
+
+	sysfs_ctx_close(ctx);
+}
+
+struct cpufreq_ctx * cpufreq_default_ctx(void) {
+	return sysfs_default_ctx();
+}
+
+int cpufreq_ctx_fd_cache_enable(struct cpufreq_ctx *ctx, unsigned int max_fds) {
+	return sysfs_fd_cache_enable(ctx, max_fds);
+}
+
+void cpufreq_ctx_fd_cache_disable(struct cpufreq_ctx *ctx) {
+	sysfs_fd_cache_disable(ctx);
+}
+
+void cpufreq_ctx_fd_cache_invalidate(struct cpufreq_ctx *ctx, unsigned int cpu) {
+	sysfs_fd_cache_invalidate(ctx, cpu);
+}
+
+int cpufreq_ctx_set_write_elision(struct cpufreq_ctx *ctx, int mode) {
+	return sysfs_set_write_elision(ctx, mode);
+}
+
+unsigned long cpufreq_ctx_get_elided_writes(struct cpufreq_ctx *ctx) {
+	return sysfs_get_elided_writes(ctx);
+}
+
+int cpufreq_ctx_set_shm(struct cpufreq_ctx *ctx, const char *name) {
+	return sysfs_set_shm(ctx, name);
+}
+
+int cpufreq_ctx_set_lib_stats(struct cpufreq_ctx *ctx, int enable) {
+	return sysfs_set_lib_stats(ctx, enable);
+}
+
+struct cpufreq_freq_session * cpufreq_ctx_freq_session_begin(struct cpufreq_ctx *ctx,
+							     unsigned int cpu) {
+	return sysfs_freq_session_begin(ctx, cpu);
+}
+
+struct cpufreq_latency_report * cpufreq_ctx_measure_latency(struct cpufreq_ctx *ctx,
+							    unsigned int cpu, int method,
+							    const unsigned long *freqs,
+							    unsigned int nr_freqs,
+							    unsigned int rounds,
+							    unsigned long timeout_us) {
+	return sysfs_measure_latency(ctx, cpu, method, freqs, nr_freqs, rounds, timeout_us);
+}
+
+int cpufreq_ctx_get_lib_stats(struct cpufreq_ctx *ctx, struct cpufreq_lib_stats *stats) {
+	if (!stats)
+		return -EINVAL;
+
+	return sysfs_get_lib_stats(ctx, stats);
+}
+
+unsigned long cpufreq_ctx_get_freq_kernel(struct cpufreq_ctx *ctx, unsigned int cpu) {
+	return sysfs_get_freq_kernel(ctx, cpu);
+}
+
+unsigned long cpufreq_ctx_get_freq_hardware(struct cpufreq_ctx *ctx, unsigned int cpu) {
+	return sysfs_get_freq_hardware(ctx, cpu);
+}
+
+unsigned long cpufreq_ctx_get_cur_freq(struct cpufreq_ctx *ctx, unsigned int cpu, int mode) {
+	return sysfs_get_cur_freq(ctx, cpu, mode);
+}
+
+int cpufreq_ctx_set_cur_freq_mode(struct cpufreq_ctx *ctx, int mode) {
+	return sysfs_set_cur_freq_mode(ctx, mode);
+}
+
+int cpufreq_ctx_get_policy_value(struct cpufreq_ctx *ctx, unsigned int cpu,
+				 struct cpufreq_policy_value *policy) {
+	if (!policy)
+		return -EINVAL;
+
+	return sysfs_get_policy_value(ctx, cpu, policy);
+}
+
+int cpufreq_ctx_get_governor(struct cpufreq_ctx *ctx, unsigned int cpu,
+			     char *governor, size_t len) {
+	if (!governor || !len)
+		return -EINVAL;
+
+	return sysfs_get_governor(ctx, cpu, governor, len);
+}
+
+unsigned long cpufreq_ctx_get_transition_latency(struct cpufreq_ctx *ctx, unsigned int cpu) {
+	return sysfs_get_transition_latency(ctx, cpu);
+}
+
+int cpufreq_ctx_get_hardware_limits(struct cpufreq_ctx *ctx, unsigned int cpu,
+				    unsigned long *min, unsigned long *max) {
+	if ((!min) || (!max))
+		return -EINVAL;
+
+	return sysfs_get_hardware_limits(ctx, cpu, min, max);
+}
+
+unsigned long cpufreq_ctx_get_transitions(struct cpufreq_ctx *ctx, unsigned int cpu) {
+	return sysfs_get_transitions(ctx, cpu);
+}
+
+char * cpufreq_ctx_get_driver(struct cpufreq_ctx *ctx, unsigned int cpu,
+			      struct cpufreq_arena *arena) {
+	return sysfs_get_driver(ctx, cpu, arena);
+}
+
+struct cpufreq_policy * cpufreq_ctx_get_policy(struct cpufreq_ctx *ctx, unsigned int cpu,
+					       struct cpufreq_arena *arena) {
+	return sysfs_get_policy(ctx, cpu, arena);
+}
+
+struct cpufreq_governor_vector * cpufreq_ctx_get_governor_vector(struct cpufreq_ctx *ctx,
+								 unsigned int cpu,
+								 struct cpufreq_arena *arena) {
+	return sysfs_get_governor_vector(ctx, cpu, arena);
+}
+
+struct cpufreq_frequency_vector * cpufreq_ctx_get_frequency_vector(struct cpufreq_ctx *ctx,
+								   unsigned int cpu,
+								   struct cpufreq_arena *arena) {
+	return sysfs_get_frequency_vector(ctx, cpu, arena);
+}
+
+struct cpufreq_cpu_vector * cpufreq_ctx_get_affected_cpu_vector(struct cpufreq_ctx *ctx,
+								unsigned int cpu,
+								struct cpufreq_arena *arena) {
+	return sysfs_get_affected_cpu_vector(ctx, cpu, arena);
+}
+
+struct cpufreq_cpu_vector * cpufreq_ctx_get_related_cpu_vector(struct cpufreq_ctx *ctx,
+							       unsigned int cpu,
+							       struct cpufreq_arena *arena) {
+	return sysfs_get_related_cpu_vector(ctx, cpu, arena);
+}
+
+struct cpufreq_stats_table * cpufreq_ctx_get_stats_table(struct cpufreq_ctx *ctx,
+							 unsigned int cpu,
+							 struct cpufreq_arena *arena) {
+	return sysfs_get_stats_table(ctx, cpu, arena);
+}
+
+int cpufreq_ctx_get_snapshot(struct cpufreq_ctx *ctx, unsigned int cpu,
+			     struct cpufreq_snapshot *snap) {
+	if (!snap)
+		return -EINVAL;
+
+	return sysfs_get_snapshot(ctx, cpu, snap);
+}
+
+struct cpufreq_system_snapshot * cpufreq_ctx_get_system_snapshot(struct cpufreq_ctx *ctx) {
+	return sysfs_get_system_snapshot(ctx);
+}
+
+struct cpufreq_cpu_vector * cpufreq_ctx_get_policy_vector(struct cpufreq_ctx *ctx) {
+	return sysfs_get_policy_vector(ctx);
+}
+
+struct cpufreq_topology * cpufreq_ctx_get_topology(struct cpufreq_ctx *ctx) {
+	return sysfs_get_topology(ctx);
+}
+
+struct cpufreq_stats_sample * cpufreq_ctx_get_stats_sample(struct cpufreq_ctx *ctx,
+							   const unsigned int *cpus,
+							   unsigned int nr_cpus) {
+	if (!ctx)
+		return NULL;
+
+	return sysfs_get_stats_sample(ctx, cpus, nr_cpus);
+}
+
+int cpufreq_ctx_get_trans_matrix(struct cpufreq_ctx *ctx, unsigned int cpu,
+				 struct cpufreq_trans_matrix *matrix) {
+	if (!ctx || !matrix)
+		return -EINVAL;
+
+	return sysfs_get_trans_matrix(ctx, cpu, matrix);
+}
+
+int cpufreq_ctx_get_affected_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+				     struct cpufreq_cpumask *mask) {
+	if (!ctx || !mask)
+		return -EINVAL;
+
+	return sysfs_get_affected_cpumask(ctx, cpu, mask);
+}
+
+int cpufreq_ctx_get_related_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+				    struct cpufreq_cpumask *mask) {
+	if (!ctx || !mask)
+		return -EINVAL;
+
+	return sysfs_get_related_cpumask(ctx, cpu, mask);
+}
+
+int cpufreq_ctx_set_policy(struct cpufreq_ctx *ctx, unsigned int cpu,
+			   struct cpufreq_policy *policy) {
+	if (!policy || !(policy->governor))
+		return -EINVAL;
+
+	return sysfs_set_policy(ctx, cpu, policy);
+}
+
+int cpufreq_ctx_set_policy_batch(struct cpufreq_ctx *ctx,
+				 struct cpufreq_policy_request *reqs,
+				 unsigned int nr) {
+	if (!reqs && nr)
+		return -EINVAL;
+
+	return sysfs_set_policy_batch(ctx, reqs, nr);
+}
+
+int cpufreq_ctx_modify_policy_min(struct cpufreq_ctx *ctx, unsigned int cpu,
+				  unsigned long min_freq) {
+	return sysfs_modify_policy_min(ctx, cpu, min_freq);
+}
+
+int cpufreq_ctx_modify_policy_max(struct cpufreq_ctx *ctx, unsigned int cpu,
+				  unsigned long max_freq) {
+	return sysfs_modify_policy_max(ctx, cpu, max_freq);
+}
+
+int cpufreq_ctx_modify_policy_governor(struct cpufreq_ctx *ctx, unsigned int cpu,
+				       char *governor) {
+	if ((!governor) || (strlen(governor) > 19))
+		return -EINVAL;
+
+	return sysfs_modify_policy_governor(ctx, cpu, governor);
+}
+
+int cpufreq_ctx_set_frequency(struct cpufreq_ctx *ctx, unsigned int cpu,
+			      unsigned long target_frequency) {
+	return sysfs_set_frequency(ctx, cpu, target_frequency);
+}
+
+struct cpufreq_async * cpufreq_ctx_async_open(struct cpufreq_ctx *ctx,
+					      int backend, unsigned int depth) {
+	return sysfs_async_open(ctx, backend, depth);
+}
+
+struct cpufreq_trace * cpufreq_ctx_trace_open(struct cpufreq_ctx *ctx, const char *save) {
+	return sysfs_trace_open(ctx, save);
+}
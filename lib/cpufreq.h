@@ -20,12 +20,28 @@
 #ifndef _CPUFREQ_H
 #define _CPUFREQ_H 1
 
+#include <stddef.h>
+
 struct cpufreq_policy {
 	unsigned long min;
 	unsigned long max;
 	char *governor;
 };
 
+/* limits of the fixed-size structures below */
+
+#define CPUFREQ_NAME_LEN	20	/* governor and driver names, incl. '\0' */
+#define CPUFREQ_MAX_GOVERNORS	16
+#define CPUFREQ_MAX_STATES	64	/* frequencies and stats entries */
+#define CPUFREQ_MAX_CPUS	4096
+
+/* the same as struct cpufreq_policy, but held by value */
+struct cpufreq_policy_value {
+	unsigned long min;
+	unsigned long max;
+	char governor[CPUFREQ_NAME_LEN];
+};
+
 struct cpufreq_available_governors {
 	char *governor;
 	struct cpufreq_available_governors *next;
@@ -53,6 +69,342 @@ struct cpufreq_stats {
 };
 
 
+/* array-based variants of the lists above
+ *
+ * Each of them is allocated as one block of memory, with the pointers
+ * pointing behind the structure itself.
+ */
+
+struct cpufreq_governor_vector {
+	unsigned int count;
+	char **governor;
+};
+
+struct cpufreq_frequency_vector {
+	unsigned int count;
+	int descending;		/* else ascending */
+	unsigned long *frequency;
+};
+
+struct cpufreq_cpu_vector {
+	unsigned int count;
+	unsigned int *cpu;
+};
+
+struct cpufreq_stats_table {
+	unsigned int count;
+	unsigned long long total_time;
+	unsigned long *frequency;
+	unsigned long long *time_in_state;
+};
+
+
+/* caller-supplied memory for results, see cpufreq_arena_init below */
+
+struct cpufreq_arena {
+	char *base;
+	size_t size;
+	size_t used;
+	size_t last;			/* start of the most recent allocation */
+	unsigned long nr_allocs;	/* since the last reset */
+	unsigned long nr_failed;	/* since the last reset */
+};
+
+
+/* library state, see cpufreq_ctx_open below */
+
+struct cpufreq_ctx;
+
+
+/* publisher of sampled values, see cpufreq_publisher_create below */
+
+struct cpufreq_publisher;
+
+
+/* counters of the library's sysfs accesses, see cpufreq_set_lib_stats below */
+
+#define CPUFREQ_LIB_STATS_BUCKETS	32
+#define CPUFREQ_LIB_STATS_MAX_ATTRS	64
+#define CPUFREQ_LIB_STATS_NAME_LEN	48
+
+struct cpufreq_lib_op_stats {
+	unsigned long long calls;
+	unsigned long long bytes;
+	unsigned long long errors;
+	unsigned long long syscalls;
+	unsigned long long total_ns;
+	/* calls taking [2^(i-1), 2^i) ns, the last one all longer */
+	unsigned long long hist[CPUFREQ_LIB_STATS_BUCKETS];
+};
+
+struct cpufreq_lib_attr_stats {
+	char name[CPUFREQ_LIB_STATS_NAME_LEN];	/* relative to cpuX/cpufreq */
+	struct cpufreq_lib_op_stats read;
+	struct cpufreq_lib_op_stats write;
+	unsigned long long shm_reads;		/* taken from a publisher */
+};
+
+struct cpufreq_lib_stats {
+	unsigned int nr_attrs;
+	struct cpufreq_lib_attr_stats attr[CPUFREQ_LIB_STATS_MAX_ATTRS];
+};
+
+
+/* many frequency changes in a row, see cpufreq_freq_session_begin below */
+
+struct cpufreq_freq_session;
+
+
+/* measured transition latency, see cpufreq_measure_latency below */
+
+#define CPUFREQ_LATENCY_AUTO		0
+#define CPUFREQ_LATENCY_BUSYLOOP	1
+#define CPUFREQ_LATENCY_APERF		2
+
+struct cpufreq_latency_pair {
+	unsigned long from;			/* kHz */
+	unsigned long to;
+	unsigned int measured;			/* rounds completed */
+	unsigned int timeouts;			/* rounds lost */
+	int indistinct;				/* speeds too close to tell */
+	unsigned long long min_ns;
+	unsigned long long median_ns;
+	unsigned long long p90_ns;
+	unsigned long long max_ns;
+	unsigned long long mean_ns;
+	unsigned long long write_ns;		/* median scaling_setspeed write */
+};
+
+struct cpufreq_latency_report {
+	unsigned int cpu;
+	int method;				/* the one used */
+	unsigned long advertised_ns;		/* cpuinfo_transition_latency */
+	unsigned long long sample_ns;		/* resolution */
+	unsigned int rounds;
+	unsigned int nr_freqs;
+	unsigned long frequency[CPUFREQ_MAX_STATES];
+	unsigned int nr_pairs;
+	struct cpufreq_latency_pair *pair;	/* from each to each other */
+};
+
+
+/* frequency change events, see cpufreq_trace_open below */
+
+#define CPUFREQ_TRACE_FREQUENCY		1	/* power:cpu_frequency */
+#define CPUFREQ_TRACE_LIMITS		2	/* power:cpu_frequency_limits */
+
+struct cpufreq_trace;
+
+struct cpufreq_trace_event {
+	unsigned long long timestamp;		/* ns, of the trace clock */
+	unsigned int type;			/* CPUFREQ_TRACE_* */
+	unsigned int cpu;
+	unsigned long freq;			/* kHz, CPUFREQ_TRACE_FREQUENCY */
+	unsigned long min;			/* kHz, CPUFREQ_TRACE_LIMITS */
+	unsigned long max;
+};
+
+
+/* asynchronous reads, see cpufreq_async_open below */
+
+#define CPUFREQ_ASYNC_AUTO	0
+#define CPUFREQ_ASYNC_IO_URING	1
+#define CPUFREQ_ASYNC_THREADS	2
+
+struct cpufreq_async;
+
+struct cpufreq_read_request {
+	unsigned int cpu;
+	const char *file;	/* relative to cpuX/cpufreq/ */
+	char *buf;
+	size_t buflen;
+	int result;		/* bytes read, or negative error value */
+};
+
+
+#define CPUFREQ_CPUMASK_BITS	(8 * sizeof(unsigned long))
+
+struct cpufreq_cpumask {
+	unsigned long bits[CPUFREQ_MAX_CPUS / (8 * sizeof(unsigned long))];
+};
+
+#define cpufreq_cpumask_isset(mask, cpu)				\
+	(((cpu) < CPUFREQ_MAX_CPUS) &&					\
+	 (((mask)->bits[(cpu) / CPUFREQ_CPUMASK_BITS] >>		\
+	   ((cpu) % CPUFREQ_CPUMASK_BITS)) & 1))
+
+#define cpufreq_cpumask_set(mask, cpu)					\
+	do {								\
+		if ((cpu) < CPUFREQ_MAX_CPUS)				\
+			(mask)->bits[(cpu) / CPUFREQ_CPUMASK_BITS] |=	\
+				1UL << ((cpu) % CPUFREQ_CPUMASK_BITS);	\
+	} while (0)
+
+#define cpufreq_cpumask_clear(mask, cpu)				\
+	do {								\
+		if ((cpu) < CPUFREQ_MAX_CPUS)				\
+			(mask)->bits[(cpu) / CPUFREQ_CPUMASK_BITS] &=	\
+				~(1UL << ((cpu) % CPUFREQ_CPUMASK_BITS)); \
+	} while (0)
+
+/* iterates over the CPUs set in mask, in ascending order */
+#define cpufreq_cpumask_for_each(cpu, mask)				\
+	for ((cpu) = cpufreq_cpumask_next((mask), 0);			\
+	     (cpu) < CPUFREQ_MAX_CPUS;					\
+	     (cpu) = cpufreq_cpumask_next((mask), (cpu) + 1))
+
+
+/* which fields of struct cpufreq_snapshot could be read */
+
+#define CPUFREQ_SNAP_CUR_FREQ		0x0001
+#define CPUFREQ_SNAP_HW_FREQ		0x0002
+#define CPUFREQ_SNAP_HW_LIMITS		0x0004
+#define CPUFREQ_SNAP_LATENCY		0x0008
+#define CPUFREQ_SNAP_DRIVER		0x0010
+#define CPUFREQ_SNAP_POLICY		0x0020
+#define CPUFREQ_SNAP_GOVERNORS		0x0040
+#define CPUFREQ_SNAP_FREQUENCIES	0x0080
+#define CPUFREQ_SNAP_AFFECTED_CPUS	0x0100
+#define CPUFREQ_SNAP_RELATED_CPUS	0x0200
+#define CPUFREQ_SNAP_STATS		0x0400
+#define CPUFREQ_SNAP_TRANSITIONS	0x0800
+#define CPUFREQ_SNAP_STATS_TRUNCATED	0x1000	/* more than CPUFREQ_MAX_STATES */
+
+struct cpufreq_snapshot {
+	unsigned int cpu;
+	unsigned int valid;		/* CPUFREQ_SNAP_* */
+
+	unsigned long cur_freq;
+	unsigned long hw_freq;
+	unsigned long hw_min;
+	unsigned long hw_max;
+	unsigned long latency;
+	char driver[CPUFREQ_NAME_LEN];
+
+	unsigned long policy_min;
+	unsigned long policy_max;
+	char governor[CPUFREQ_NAME_LEN];
+
+	unsigned int nr_governors;
+	char governors[CPUFREQ_MAX_GOVERNORS][CPUFREQ_NAME_LEN];
+
+	unsigned int nr_frequencies;
+	unsigned long frequencies[CPUFREQ_MAX_STATES];
+
+	struct cpufreq_cpumask affected_cpus;
+	struct cpufreq_cpumask related_cpus;
+
+	unsigned int nr_stats;
+	unsigned long stats_frequency[CPUFREQ_MAX_STATES];
+	unsigned long long stats_time_in_state[CPUFREQ_MAX_STATES];
+	unsigned long long total_time;
+	unsigned long total_trans;
+};
+
+struct cpufreq_cpu_view {
+	unsigned int cpu;
+	const struct cpufreq_snapshot *policy;	/* NULL if no cpufreq support */
+};
+
+struct cpufreq_system_snapshot {
+	struct cpufreq_ctx *ctx;		/* the context it was read with */
+	unsigned int nr_cpus;
+	struct cpufreq_cpu_view *cpus;		/* sorted by CPU number */
+	unsigned int nr_policies;
+	struct cpufreq_snapshot *policies;
+};
+
+
+/* time in state of many CPUs, see cpufreq_get_stats_sample below
+ *
+ * The arrays are laid out as structure of arrays: time_in_state holds
+ * nr_states rows of nr_cpus values, so that each of the reductions over
+ * CPUs runs over contiguous memory. Times are in 10 ms units, like in
+ * stats/time_in_state.
+ */
+
+struct cpufreq_stats_sample {
+	struct cpufreq_ctx *ctx;		/* the context it was read with */
+	unsigned int nr_cpus;
+	unsigned int nr_states;
+	unsigned long long timestamp;		/* CLOCK_MONOTONIC, in ns */
+	unsigned int *cpu;			/* [nr_cpus] */
+	unsigned char *valid;			/* [nr_cpus], stats could be read */
+	unsigned long *frequency;		/* [nr_states], descending */
+	unsigned long long *time_in_state;	/* [nr_states][nr_cpus] */
+	unsigned long *total_trans;		/* [nr_cpus] */
+};
+
+struct cpufreq_stats_delta {
+	unsigned int nr_cpus;
+	unsigned int nr_states;
+	unsigned long long elapsed;		/* between the samples, in ns */
+	unsigned int *cpu;			/* [nr_cpus] */
+	unsigned long *frequency;		/* [nr_states] */
+	unsigned long long *time_in_state;	/* [nr_states][nr_cpus] */
+	unsigned long long *state_time;		/* [nr_states], of all CPUs */
+	unsigned long long *total_time;		/* [nr_cpus] */
+	unsigned long *avg_frequency;		/* [nr_cpus], in kHz */
+	unsigned long *transitions;		/* [nr_cpus] */
+	double *transition_rate;		/* [nr_cpus], per second */
+	unsigned long avg_frequency_all;	/* of all CPUs, in kHz */
+};
+
+
+/* transitions between the states of a CPU, see cpufreq_get_trans_matrix
+ * below */
+
+struct cpufreq_trans_matrix {
+	unsigned int cpu;
+	unsigned int nr_states;
+	unsigned long long timestamp;		/* CLOCK_MONOTONIC, in ns */
+	unsigned long frequency[CPUFREQ_MAX_STATES];	/* as in trans_table */
+	/* [nr_states][nr_states], from row to column */
+	unsigned int count[CPUFREQ_MAX_STATES * CPUFREQ_MAX_STATES];
+};
+
+struct cpufreq_trans_pair {
+	unsigned long from;
+	unsigned long to;
+	unsigned int count;
+};
+
+
+/* CPU topology, see cpufreq_get_topology below */
+
+#define CPUFREQ_TOPO_UNKNOWN	0xffffffffU
+
+struct cpufreq_topology_cpu {
+	unsigned int policy;	/* first CPU of the policy */
+	unsigned int package;	/* physical_package_id */
+	unsigned int core;	/* core_id, unique within the package */
+	unsigned int node;	/* NUMA node */
+	unsigned int freqs;	/* index into freqs of the topology */
+};
+
+struct cpufreq_topology_freqs {
+	unsigned int nr_policies;	/* sharing this table */
+	unsigned int count;
+	unsigned long frequency[CPUFREQ_MAX_STATES];
+};
+
+struct cpufreq_topology {
+	unsigned long generation;	/* changes on every rebuild */
+	unsigned int nr_cpu_ids;	/* highest possible CPU plus one */
+	struct cpufreq_cpumask possible;
+	struct cpufreq_cpumask present;
+	struct cpufreq_cpumask online;
+	unsigned int nr_present;
+	unsigned int nr_online;
+	unsigned int truncated;		/* CPUs at or above CPUFREQ_MAX_CPUS left out */
+	struct cpufreq_topology_cpu cpu[CPUFREQ_MAX_CPUS];
+	unsigned int nr_policies;
+	unsigned int policies[CPUFREQ_MAX_CPUS];	/* first CPUs, sorted */
+	unsigned int nr_freqs;
+	struct cpufreq_topology_freqs *freqs;
+};
+
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -65,6 +417,63 @@ extern "C" {
 
 extern int cpufreq_cpu_exists(unsigned int cpu);
 
+
+/* address a policy instead of a CPU
+ *
+ * Recent kernels list the policies in cpu/cpufreq/policyN, N being the
+ * first CPU of the policy; cpuX/cpufreq is a symlink to one of them.
+ * Every function which takes a CPU number also takes CPUFREQ_POLICY(N),
+ * which goes to policyN directly. cpufreq_cpu_exists tells whether
+ * policyN exists.
+ *
+ * cpufreq_get_policy_vector returns the numbers N of all policies,
+ * sorted, or NULL if there are none or the kernel does not list them.
+ * It is freed by cpufreq_put_cpu_vector.
+ */
+
+#define CPUFREQ_POLICY_FLAG	0x80000000U
+#define CPUFREQ_POLICY(n)	((n) | CPUFREQ_POLICY_FLAG)
+
+#define cpufreq_is_policy(id)	(((id) & CPUFREQ_POLICY_FLAG) != 0)
+#define cpufreq_policy_nr(id)	((id) & ~CPUFREQ_POLICY_FLAG)
+
+extern struct cpufreq_cpu_vector * cpufreq_get_policy_vector(void);
+
+/* use a different sysfs root
+ *
+ * By default, libcpufreq reads from the sysfs mounted at /sys, or from the
+ * directory named in the environment variable CPUFREQ_SYSFS_ROOT if that
+ * is set. cpufreq_set_sysfs_root overrides both; passing NULL restores the
+ * default of /sys. This is mostly useful to test or benchmark against a
+ * synthetic tree.
+ *
+ * returns 0 on success, and an error value on failure.
+ */
+
+extern int cpufreq_set_sysfs_root(const char *root);
+
+
+/* keep cpufreq sysfs files open between reads
+ *
+ * By default, each value is read by opening and closing the sysfs file.
+ * After calling cpufreq_fd_cache_enable, up to max_fds files (at most
+ * 2^20) are kept open and re-read in place, which is considerably cheaper
+ * for programs polling the same values again and again. If max_fds is
+ * exceeded, a file which wasn't read for a while is closed. Looking up
+ * and reading a cached file takes no lock. Files belonging to a CPU
+ * which went offline are dropped automatically on the next failing
+ * read, or explicitly by calling cpufreq_fd_cache_invalidate.
+ *
+ * returns 0 on success, and an error value on failure.
+ */
+
+extern int cpufreq_fd_cache_enable(unsigned int max_fds);
+
+extern void cpufreq_fd_cache_disable(void);
+
+extern void cpufreq_fd_cache_invalidate(unsigned int cpu);
+
+
 /* determine current CPU frequency
  * - _kernel variant means kernel's opinion of CPU frequency
  * - _hardware variant means actual hardware CPU frequency,
@@ -80,6 +489,47 @@ extern unsigned long cpufreq_get_freq_hardware(unsigned int cpu);
 #define cpufreq_get(cpu) cpufreq_get_freq_kernel(cpu);
 
 
+/* determine current CPU frequency, at a chosen cost
+ *
+ * The modes, from the cheapest to the most accurate one:
+ * - CPUFREQ_CUR_CACHED takes the value a cpufreq-publish process saw
+ *   last (see cpufreq_set_shm), without any system call, and reads
+ *   scaling_cur_freq if there is no publisher.
+ * - CPUFREQ_CUR_KERNEL reads scaling_cur_freq, i.e. the frequency the
+ *   cpufreq core last set, or on x86 the average the scheduler tick of
+ *   the CPU last took. It doesn't disturb the CPU.
+ * - CPUFREQ_CUR_HARDWARE reads cpuinfo_cur_freq, which makes the driver
+ *   ask the hardware. Several drivers, acpi-cpufreq among them, do that
+ *   by an interrupt to the CPU, which wakes it up if it is idle. Only
+ *   root may read it.
+ * - CPUFREQ_CUR_APERF reads the APERF and MPERF registers of the CPU
+ *   through /dev/cpu/N/msr, CPUFREQ_CUR_APERF_US apart, and returns the
+ *   average frequency the CPU ran at meanwhile while not idle, boost
+ *   included. Both reads interrupt the CPU, and the call sleeps in
+ *   between. Needs root, the msr driver, and an x86 CPU.
+ *
+ * cpufreq_set_cur_freq_mode sets how the snapshots below read it: with
+ * CPUFREQ_CUR_CACHED or CPUFREQ_CUR_KERNEL, that way into cur_freq and
+ * not at all into hw_freq; with CPUFREQ_CUR_HARDWARE, the default, or
+ * CPUFREQ_CUR_APERF, cur_freq is cached and hw_freq read that way.
+ *
+ * cpufreq_get_cur_freq returns 0 on failure, else frequency in kHz.
+ * cpufreq_set_cur_freq_mode returns 0 on success, and -EINVAL for an
+ * unknown mode.
+ */
+
+#define CPUFREQ_CUR_CACHED	0
+#define CPUFREQ_CUR_KERNEL	1
+#define CPUFREQ_CUR_HARDWARE	2
+#define CPUFREQ_CUR_APERF	3
+
+#define CPUFREQ_CUR_APERF_US	10000
+
+extern unsigned long cpufreq_get_cur_freq(unsigned int cpu, int mode);
+
+extern int cpufreq_set_cur_freq_mode(int mode);
+
+
 /* determine CPU transition latency
  *
  * returns 0 on failure, else transition latency in 10^(-9) s = nanoseconds
@@ -121,6 +571,20 @@ extern struct cpufreq_policy * cpufreq_get_policy(unsigned int cpu);
 extern void cpufreq_put_policy(struct cpufreq_policy *policy);
 
 
+/* determine CPUfreq policy or governor into caller-provided storage
+ *
+ * Like cpufreq_get_policy, but nothing is allocated, so there is
+ * nothing to put either. Governor names longer than the buffer are
+ * cut short; CPUFREQ_NAME_LEN bytes hold any name the kernel accepts.
+ *
+ * returns 0 on success, and an error value on failure.
+ */
+
+extern int cpufreq_get_policy_value(unsigned int cpu, struct cpufreq_policy_value *policy);
+
+extern int cpufreq_get_governor(unsigned int cpu, char *governor, size_t len);
+
+
 /* determine CPUfreq governors currently available
  *
  * may be modified by modprobe'ing or rmmod'ing other governors. Please
@@ -168,6 +632,57 @@ extern struct cpufreq_affected_cpus * cpufreq_get_related_cpus(unsigned int cpu)
 extern void cpufreq_put_related_cpus(struct cpufreq_affected_cpus *first);
 
 
+/* determine affected and related CPUs as bitmaps
+ *
+ * Fill the caller's mask, so that nothing needs to be freed; whether two
+ * CPUs share a policy is then one cpufreq_cpumask_isset away.
+ *
+ * returns 0 on success, and an error value on failure.
+ */
+
+extern int cpufreq_get_affected_cpumask(unsigned int cpu, struct cpufreq_cpumask *mask);
+
+extern int cpufreq_get_related_cpumask(unsigned int cpu, struct cpufreq_cpumask *mask);
+
+
+/* operate on CPU masks
+ *
+ * dst may be the same as a or b. cpufreq_cpumask_weight counts the CPUs
+ * set; cpufreq_cpumask_next returns the first CPU set at or after cpu,
+ * or CPUFREQ_MAX_CPUS if there is none. cpufreq_cpumask_parse reads
+ * both "0 1 2 3" and "0-3,8" style lists into mask, and returns the
+ * number of CPUs set, or 0 if buf holds no CPU list or one naming a CPU
+ * at or above CPUFREQ_MAX_CPUS.
+ */
+
+extern void cpufreq_cpumask_zero(struct cpufreq_cpumask *mask);
+
+extern void cpufreq_cpumask_or(struct cpufreq_cpumask *dst,
+			       const struct cpufreq_cpumask *a,
+			       const struct cpufreq_cpumask *b);
+
+extern void cpufreq_cpumask_and(struct cpufreq_cpumask *dst,
+				const struct cpufreq_cpumask *a,
+				const struct cpufreq_cpumask *b);
+
+extern void cpufreq_cpumask_andnot(struct cpufreq_cpumask *dst,
+				   const struct cpufreq_cpumask *a,
+				   const struct cpufreq_cpumask *b);
+
+extern int cpufreq_cpumask_equal(const struct cpufreq_cpumask *a,
+				 const struct cpufreq_cpumask *b);
+
+extern int cpufreq_cpumask_intersects(const struct cpufreq_cpumask *a,
+				      const struct cpufreq_cpumask *b);
+
+extern unsigned int cpufreq_cpumask_weight(const struct cpufreq_cpumask *mask);
+
+extern unsigned int cpufreq_cpumask_next(const struct cpufreq_cpumask *mask, unsigned int cpu);
+
+extern unsigned int cpufreq_cpumask_parse(const char *buf, size_t len,
+					  struct cpufreq_cpumask *mask);
+
+
 /* determine stats for cpufreq subsystem
  *
  * This is not available in all kernel versions or configurations.
@@ -180,6 +695,288 @@ extern void cpufreq_put_stats(struct cpufreq_stats *stats);
 extern unsigned long cpufreq_get_transitions(unsigned int cpu);
 
 
+/* array-based variants of the list functions above
+ *
+ * These return the same information as cpufreq_get_available_governors,
+ * cpufreq_get_available_frequencies, cpufreq_get_affected_cpus,
+ * cpufreq_get_related_cpus and cpufreq_get_stats, but as arrays with a
+ * count, in one block of memory. The frequencies are sorted in the order
+ * the kernel lists them, which is either descending or ascending (see
+ * the descending field).
+ *
+ * Remember to call the matching cpufreq_put_* function when no longer
+ * needed to avoid memory leakage, please.
+ */
+
+extern struct cpufreq_governor_vector * cpufreq_get_governor_vector(unsigned int cpu);
+
+extern void cpufreq_put_governor_vector(struct cpufreq_governor_vector *vec);
+
+extern struct cpufreq_frequency_vector * cpufreq_get_frequency_vector(unsigned int cpu);
+
+extern void cpufreq_put_frequency_vector(struct cpufreq_frequency_vector *vec);
+
+extern struct cpufreq_cpu_vector * cpufreq_get_affected_cpu_vector(unsigned int cpu);
+
+extern struct cpufreq_cpu_vector * cpufreq_get_related_cpu_vector(unsigned int cpu);
+
+extern void cpufreq_put_cpu_vector(struct cpufreq_cpu_vector *vec);
+
+extern struct cpufreq_stats_table * cpufreq_get_stats_table(unsigned int cpu);
+
+extern void cpufreq_put_stats_table(struct cpufreq_stats_table *table);
+
+
+/* allocate results from a caller-supplied arena
+ *
+ * cpufreq_arena_init sets up an arena using the size bytes of memory at
+ * buf. The *_arena variants of the getters below allocate their results
+ * from that memory instead of using malloc. Their results must not be
+ * passed to the cpufreq_put_* functions; instead, everything allocated
+ * from an arena is released at once by cpufreq_arena_reset, e.g. once
+ * per sampling cycle. If the arena is exhausted, the getters return NULL
+ * and nr_failed is increased.
+ */
+
+extern void cpufreq_arena_init(struct cpufreq_arena *arena, void *buf, size_t size);
+
+extern void cpufreq_arena_reset(struct cpufreq_arena *arena);
+
+extern char * cpufreq_get_driver_arena(unsigned int cpu, struct cpufreq_arena *arena);
+
+extern struct cpufreq_policy * cpufreq_get_policy_arena(unsigned int cpu, struct cpufreq_arena *arena);
+
+extern struct cpufreq_governor_vector * cpufreq_get_governor_vector_arena(unsigned int cpu,
+									   struct cpufreq_arena *arena);
+
+extern struct cpufreq_frequency_vector * cpufreq_get_frequency_vector_arena(unsigned int cpu,
+									     struct cpufreq_arena *arena);
+
+extern struct cpufreq_cpu_vector * cpufreq_get_affected_cpu_vector_arena(unsigned int cpu,
+									  struct cpufreq_arena *arena);
+
+extern struct cpufreq_cpu_vector * cpufreq_get_related_cpu_vector_arena(unsigned int cpu,
+									 struct cpufreq_arena *arena);
+
+extern struct cpufreq_stats_table * cpufreq_get_stats_table_arena(unsigned int cpu,
+								   struct cpufreq_arena *arena);
+
+
+/* find the available frequency closest to target
+ *
+ * Uses binary search on the frequency vector. If two frequencies are
+ * equally close, the lower one is returned.
+ *
+ * returns 0 on failure, else frequency in kHz.
+ */
+
+extern unsigned long cpufreq_frequency_vector_nearest(const struct cpufreq_frequency_vector *vec,
+						      unsigned long target);
+
+
+/* determine all of the above in one go
+ *
+ * Fills the caller-provided snapshot with everything libcpufreq knows
+ * about a CPU. Every sysfs file is read only once, and no memory is
+ * allocated. Fields which couldn't be read are zero, and their bit in
+ * snap->valid is cleared. Lists longer than the fixed-size arrays are
+ * truncated; for time_in_state this sets CPUFREQ_SNAP_STATS_TRUNCATED,
+ * and total_time still covers all states.
+ *
+ * returns 0 if the cpufreq directory of the CPU could be read at all,
+ * and an error value otherwise.
+ */
+
+extern int cpufreq_get_snapshot(unsigned int cpu, struct cpufreq_snapshot *snap);
+
+
+/* determine snapshots of all CPUs
+ *
+ * Takes one snapshot per cpufreq policy, and maps every CPU found in sysfs
+ * to the snapshot of its policy. CPUs sharing a policy (see related CPUs
+ * above) share the same snapshot, so the cost scales with the number of
+ * policies, not the number of CPUs. Each policy snapshot is taken on the
+ * first CPU of the policy.
+ *
+ * cpufreq_refresh_system_snapshot re-reads all policies in place. It
+ * returns 0 on success, and -EAGAIN if a policy vanished or its CPUs
+ * changed -- then the snapshot needs to be put and taken again.
+ *
+ * Remember to call cpufreq_put_system_snapshot when no longer needed
+ * to avoid memory leakage, please.
+ */
+
+extern struct cpufreq_system_snapshot * cpufreq_get_system_snapshot(void);
+
+extern int cpufreq_refresh_system_snapshot(struct cpufreq_system_snapshot *sys);
+
+extern void cpufreq_put_system_snapshot(struct cpufreq_system_snapshot *sys);
+
+
+/* determine time in state changes of many CPUs
+ *
+ * cpufreq_get_stats_sample reads stats/time_in_state and
+ * stats/total_trans of the nr_cpus CPUs listed in cpus, or of the first
+ * CPU of every policy if cpus is NULL. The frequencies of all CPUs are
+ * merged into one list of states; a CPU gets 0 for the states it
+ * doesn't have. CPUs whose stats can't be read are kept, with valid
+ * cleared. cpufreq_refresh_stats_sample re-reads a sample in place, and
+ * returns -EAGAIN if a new frequency showed up, in which case the sample
+ * needs to be put and taken again.
+ *
+ * cpufreq_get_stats_delta computes what happened between two samples of
+ * the same CPUs: the time spent in each state by each CPU and by all of
+ * them, the average frequency, and the number and rate of transitions.
+ * If the stats of a CPU were reset in between (its total_trans went
+ * backwards), its new values count as the delta.
+ * cpufreq_refresh_stats_delta computes it again into an existing delta,
+ * without allocating any memory. Both return NULL or -EINVAL if the
+ * samples don't match.
+ *
+ * Remember to call cpufreq_put_stats_sample and cpufreq_put_stats_delta
+ * when no longer needed to avoid memory leakage, please.
+ */
+
+extern struct cpufreq_stats_sample * cpufreq_get_stats_sample(const unsigned int *cpus,
+							      unsigned int nr_cpus);
+
+extern int cpufreq_refresh_stats_sample(struct cpufreq_stats_sample *sample);
+
+extern void cpufreq_put_stats_sample(struct cpufreq_stats_sample *sample);
+
+extern struct cpufreq_stats_delta * cpufreq_get_stats_delta(const struct cpufreq_stats_sample *before,
+							    const struct cpufreq_stats_sample *after);
+
+extern int cpufreq_refresh_stats_delta(struct cpufreq_stats_delta *delta,
+				       const struct cpufreq_stats_sample *before,
+				       const struct cpufreq_stats_sample *after);
+
+extern void cpufreq_put_stats_delta(struct cpufreq_stats_delta *delta);
+
+
+/* determine which transitions a CPU makes
+ *
+ * cpufreq_get_trans_matrix parses stats/trans_table of cpu into matrix,
+ * whose count[from * nr_states + to] is the number of transitions from
+ * frequency[from] to frequency[to]. It doesn't allocate memory; the
+ * matrix is some 17 kB. Returns -ENODEV if the CPU has no
+ * trans_table, and -EFBIG if the table was too big for the kernel to
+ * show.
+ *
+ * cpufreq_get_trans_matrix_delta puts the transitions made between two
+ * matrices of the same CPU into delta, which may be after itself. If
+ * the stats were reset in between, the new counts are the delta.
+ * Returns -EINVAL if the states differ.
+ *
+ * cpufreq_get_trans_hottest fills pairs with the up to max pairs of
+ * frequencies with the most transitions in a matrix or delta, most
+ * first, and returns how many it found; a governor which thrashes
+ * shows up as a pair and its reverse near the top.
+ */
+
+extern int cpufreq_get_trans_matrix(unsigned int cpu, struct cpufreq_trans_matrix *matrix);
+
+extern int cpufreq_get_trans_matrix_delta(const struct cpufreq_trans_matrix *before,
+					  const struct cpufreq_trans_matrix *after,
+					  struct cpufreq_trans_matrix *delta);
+
+extern unsigned int cpufreq_get_trans_hottest(const struct cpufreq_trans_matrix *matrix,
+					      struct cpufreq_trans_pair *pairs,
+					      unsigned int max);
+
+
+/* determine the CPU topology
+ *
+ * Returns an index of all CPUs: which are possible, present and online,
+ * and for each CPU its policy, package, core and NUMA node, as far as
+ * the kernel tells (else CPUFREQ_TOPO_UNKNOWN; offline CPUs mostly
+ * don't show any of it). The available frequencies of each policy are
+ * stored once per distinct table, so cpu[x].freqs == cpu[y].freqs
+ * means the same frequencies are available to both CPUs. Only CPUs
+ * below CPUFREQ_MAX_CPUS fit in; truncated is set if the kernel listed
+ * others.
+ *
+ * The index is built once and cached. Later calls only read the online
+ * mask, and rebuild the index if it changed; the generation field tells
+ * whether that happened. The result stays valid until it is passed to
+ * cpufreq_put_topology, even if it was rebuilt meanwhile.
+ *
+ * returns NULL on failure.
+ */
+
+extern struct cpufreq_topology * cpufreq_get_topology(void);
+
+extern void cpufreq_put_topology(struct cpufreq_topology *topo);
+
+
+/* read many files at once
+ *
+ * cpufreq_async_open sets up an engine which reads up to depth files
+ * (0 meaning a default of 64) in parallel, using io_uring if backend is
+ * CPUFREQ_ASYNC_IO_URING, a pool of threads if it is CPUFREQ_ASYNC_THREADS,
+ * or whatever works if it is CPUFREQ_ASYNC_AUTO. io_uring needs Linux 5.11
+ * or later. cpufreq_async_backend tells which one is used.
+ *
+ * cpufreq_async_read reads the files of all nr requests into their
+ * buffers, which are terminated by '\0'. If timeout_ms is not zero,
+ * requests not done by then fail with -ETIMEDOUT, so that one slow
+ * driver can't stall the whole batch. Such late reads keep an engine slot
+ * busy until the driver returns, but never write to the caller's buffer.
+ * Returns the number of successful requests, or a negative error value;
+ * the result of each request is stored in its result field.
+ *
+ * An engine must only be used by one thread at a time. cpufreq_async_close
+ * waits for late reads to return.
+ */
+
+extern struct cpufreq_async * cpufreq_async_open(int backend, unsigned int depth);
+
+extern int cpufreq_async_backend(const struct cpufreq_async *async);
+
+extern int cpufreq_async_read(struct cpufreq_async *async,
+			      struct cpufreq_read_request *reqs, unsigned int nr,
+			      unsigned int timeout_ms);
+
+extern void cpufreq_async_close(struct cpufreq_async *async);
+
+
+/* follow frequency changes as they happen
+ *
+ * cpufreq_trace_open enables the power:cpu_frequency and
+ * power:cpu_frequency_limits tracepoints and reads their events from
+ * the per-CPU ring buffers of tracefs, so that no change is missed and
+ * nothing is polled. It needs root. If save is not NULL, everything
+ * read is also written to that file, which cpufreq_trace_replay reads
+ * back later, e.g. on another machine.
+ *
+ * cpufreq_trace_read hands out up to max events of the current batch.
+ * Once that is empty, it waits up to timeout_ms (-1 meaning forever)
+ * for a ring buffer to fill up to tracing's buffer_percent, then takes
+ * everything the buffers hold as the next batch, sorted by time. The
+ * timeout thus bounds how late events are delivered, and an idle
+ * system costs one wakeup per timeout. Returns the number of events,
+ * which is 0 if there were none; -ENODATA at the end of a replay; or
+ * another negative error value, -EINTR if a signal came in.
+ *
+ * cpufreq_trace_lost returns how many events the kernel dropped since
+ * the trace was opened because the buffers were full.
+ *
+ * cpufreq_trace_close turns the tracepoints, and tracing, off again
+ * if they were off before.
+ */
+
+extern struct cpufreq_trace * cpufreq_trace_open(const char *save);
+
+extern struct cpufreq_trace * cpufreq_trace_replay(const char *path);
+
+extern int cpufreq_trace_read(struct cpufreq_trace *trace, struct cpufreq_trace_event *events,
+			      unsigned int max, int timeout_ms);
+
+extern unsigned long cpufreq_trace_lost(const struct cpufreq_trace *trace);
+
+extern void cpufreq_trace_close(struct cpufreq_trace *trace);
+
+
 /* set new cpufreq policy 
  * 
  * Tries to set the passed policy as new policy as close as possible,
@@ -189,6 +986,110 @@ extern unsigned long cpufreq_get_transitions(unsigned int cpu);
 extern int cpufreq_set_policy(unsigned int cpu, struct cpufreq_policy *policy);
 
 
+/* skip writes which would not change anything
+ *
+ * Every write of scaling_min_freq, scaling_max_freq or scaling_governor
+ * makes the kernel update the policy and may restart the governor, even
+ * if the value stays the same. With CPUFREQ_ELIDE_READ, the setters
+ * (set_policy, set_policy_batch and the modify_policy_* functions) read
+ * the current value first and leave it alone if it matches. With
+ * CPUFREQ_ELIDE_CACHED, the value read or written last is remembered
+ * per CPU, which only is correct as long as no one else changes the
+ * policy; setting the mode again forgets all remembered values.
+ *
+ * Note that scaling_max_freq shows the limit in effect, which may be
+ * lower than the one last asked for, e.g. due to thermal limits.
+ *
+ * cpufreq_get_elided_writes returns the number of writes skipped so far.
+ */
+
+#define CPUFREQ_ELIDE_NONE	0
+#define CPUFREQ_ELIDE_READ	1
+#define CPUFREQ_ELIDE_CACHED	2
+
+extern int cpufreq_set_write_elision(int mode);
+
+extern unsigned long cpufreq_get_elided_writes(void);
+
+
+/* share one sampler among many processes
+ *
+ * A publisher reads scaling_cur_freq, scaling_min_freq, scaling_max_freq,
+ * scaling_governor, scaling_driver, cpuinfo_min_freq, cpuinfo_max_freq,
+ * stats/total_trans and stats/time_in_state of every online CPU each
+ * time cpufreq_publisher_update is called, and publishes them in the
+ * POSIX shared memory segment name ("/cpufreq" if NULL) with a sequence
+ * count per CPU. cpufreq-publish calls it every interval_us
+ * microseconds. cpufreq_publisher_create sets it up for the sysfs
+ * mounted at root, or at the default location if root is NULL, and
+ * cpufreq_publisher_destroy removes the segment.
+ *
+ * Contexts reading the same sysfs then take these files from the
+ * segment instead of sysfs, as long as the publisher keeps up with its
+ * interval; the values are that old at most. After writing to sysfs, a
+ * context reads from it again until the publisher has caught up. The
+ * segment is the one named by the CPUFREQ_SHM environment variable, or
+ * "/cpufreq"; an empty CPUFREQ_SHM turns this off. cpufreq_set_shm
+ * picks another segment, or none if name is NULL.
+ */
+
+extern struct cpufreq_publisher * cpufreq_publisher_create(const char *name, const char *root,
+							   unsigned long interval_us);
+
+extern int cpufreq_publisher_update(struct cpufreq_publisher *pub);
+
+extern void cpufreq_publisher_destroy(struct cpufreq_publisher *pub);
+
+extern int cpufreq_set_shm(const char *name);
+
+
+/* count what the library does
+ *
+ * cpufreq_set_lib_stats(1) starts counting, per sysfs file name, the
+ * reads and writes the library makes: calls, bytes, failures, system
+ * calls made, and a histogram of their latency in power-of-two
+ * nanosecond buckets. Reads answered from a publisher's segment are
+ * counted separately. Enabling again resets the counters, and
+ * cpufreq_set_lib_stats(0) stops counting and drops them; while
+ * disabled, counting costs one test per access.
+ *
+ * cpufreq_get_lib_stats copies the counters into stats; names beyond
+ * the table are summed up as "other". Returns -ENODATA if counting is
+ * not enabled.
+ */
+
+extern int cpufreq_set_lib_stats(int enable);
+
+extern int cpufreq_get_lib_stats(struct cpufreq_lib_stats *stats);
+
+
+/* set new policies on many CPUs at once
+ *
+ * Each request names a CPU and the values it shall get; a min or max
+ * of 0 and a NULL governor leave that value as it is. Requests for CPUs
+ * sharing a policy are merged in order, later values winning, and each
+ * policy is written once: max and min in the order the old limits
+ * need, then the governor. Policies are written in parallel.
+ *
+ * On return, policy holds the first CPU of the policy each request was
+ * merged into, and result is 0 or the negative error of that policy's
+ * writes. Returns the number of policies which failed, or a negative
+ * error if the batch could not be run at all.
+ */
+
+struct cpufreq_policy_request {
+	unsigned int cpu;
+	unsigned long min;
+	unsigned long max;
+	const char *governor;
+	unsigned int policy;	/* out */
+	int result;		/* out */
+};
+
+extern int cpufreq_set_policy_batch(struct cpufreq_policy_request *reqs,
+				    unsigned int nr);
+
+
 /* modify a policy by only changing min/max freq or governor 
  *
  * Does not check whether result is what was intended.
@@ -208,6 +1109,177 @@ extern int cpufreq_modify_policy_governor(unsigned int cpu, char *governor);
 
 extern int cpufreq_set_frequency(unsigned int cpu, unsigned long target_frequency);
 
+
+/* set many frequencies in a row
+ *
+ * cpufreq_set_frequency looks up the governor each time, and leaves the
+ * userspace governor in place. cpufreq_freq_session_begin saves the
+ * policy of cpu, switches it to the userspace governor once and keeps
+ * scaling_setspeed open; cpufreq_freq_session_set then only formats
+ * the value and writes it with one pwrite. cpufreq_freq_session_end
+ * closes the session and restores the saved policy, and the speed set
+ * before if the userspace governor was in use already.
+ *
+ * A session owns the policy of cpu: other changes to it in the
+ * meantime may be undone at the end, and cpufreq_freq_session_set
+ * must not be called for the same session from several threads at
+ * once. cpufreq_freq_session_begin returns NULL on failure, the others
+ * 0 or a negative error.
+ */
+
+extern struct cpufreq_freq_session * cpufreq_freq_session_begin(unsigned int cpu);
+
+extern int cpufreq_freq_session_set(struct cpufreq_freq_session *session,
+				    unsigned long target_frequency);
+
+extern int cpufreq_freq_session_end(struct cpufreq_freq_session *session);
+
+/* measure how long frequency transitions take
+ *
+ * Switches cpu between each pair of the nr_freqs frequencies in freqs,
+ * or of all available ones if freqs is NULL, rounds times each way,
+ * through scaling_setspeed with the userspace governor, and times how
+ * long it takes until the CPU runs at the new speed. The calling
+ * thread runs on cpu meanwhile and samples its speed with a busy loop,
+ * timed against the clock (CPUFREQ_LATENCY_BUSYLOOP) or counted by the
+ * APERF and MPERF registers (CPUFREQ_LATENCY_APERF, x86 and root
+ * only); CPUFREQ_LATENCY_AUTO uses APERF and MPERF where it can. A
+ * round is lost if the speed doesn't settle within timeout_us.
+ *
+ * The result is exact to one sample, sample_ns, and meant to be set
+ * against advertised_ns, the driver's cpuinfo_transition_latency.
+ * Pairs whose speeds can't be told apart, e.g. because the hardware
+ * doesn't follow the request, are marked indistinct. The governor, or
+ * the speed set with userspace, and the thread's CPU affinity are
+ * restored afterwards. This takes at least 20ms per frequency plus the
+ * switches themselves, and disturbs everything else on the policy.
+ *
+ * Returns NULL on failure; free the report with
+ * cpufreq_put_latency_report.
+ */
+
+extern struct cpufreq_latency_report * cpufreq_measure_latency(unsigned int cpu, int method,
+							       const unsigned long *freqs,
+							       unsigned int nr_freqs,
+							       unsigned int rounds,
+							       unsigned long timeout_us);
+
+extern void cpufreq_put_latency_report(struct cpufreq_latency_report *report);
+
+
+/* library contexts
+ *
+ * A context holds all state of libcpufreq: the sysfs root, the fd cache,
+ * the write elision settings and counters, which policy each CPU
+ * belongs to, the topology index, the publisher segment it reads from
+ * and the counters of cpufreq_set_lib_stats. cpufreq_ctx_open creates
+ * one for the sysfs mounted at root, or at the default location if
+ * root is NULL. All functions above use the default context, which is
+ * returned by cpufreq_default_ctx; those below take the context to
+ * work on. cpufreq_ctx_close on the default context does nothing.
+ *
+ * Settings (sysfs root, fd cache, write elision, shm, lib stats, current
+ * frequency mode) must not be changed while other threads use the same
+ * context. All other calls may be made from any number of threads at
+ * once: reads use the fd cache and the policy map without taking any
+ * lock, and writes to the same policy are serialized by a lock.
+ *
+ * The list functions, such as cpufreq_get_available_governors, have no
+ * variant taking a context; the vector functions they are built on do.
+ */
+
+extern struct cpufreq_ctx * cpufreq_ctx_open(const char *root);
+
+extern void cpufreq_ctx_close(struct cpufreq_ctx *ctx);
+
+extern struct cpufreq_ctx * cpufreq_default_ctx(void);
+
+extern int cpufreq_ctx_fd_cache_enable(struct cpufreq_ctx *ctx, unsigned int max_fds);
+extern void cpufreq_ctx_fd_cache_disable(struct cpufreq_ctx *ctx);
+extern void cpufreq_ctx_fd_cache_invalidate(struct cpufreq_ctx *ctx, unsigned int cpu);
+
+extern int cpufreq_ctx_set_write_elision(struct cpufreq_ctx *ctx, int mode);
+extern unsigned long cpufreq_ctx_get_elided_writes(struct cpufreq_ctx *ctx);
+extern int cpufreq_ctx_set_shm(struct cpufreq_ctx *ctx, const char *name);
+extern int cpufreq_ctx_set_lib_stats(struct cpufreq_ctx *ctx, int enable);
+extern int cpufreq_ctx_get_lib_stats(struct cpufreq_ctx *ctx, struct cpufreq_lib_stats *stats);
+extern struct cpufreq_freq_session * cpufreq_ctx_freq_session_begin(struct cpufreq_ctx *ctx,
+								   unsigned int cpu);
+extern struct cpufreq_latency_report * cpufreq_ctx_measure_latency(struct cpufreq_ctx *ctx,
+								   unsigned int cpu, int method,
+								   const unsigned long *freqs,
+								   unsigned int nr_freqs,
+								   unsigned int rounds,
+								   unsigned long timeout_us);
+
+extern unsigned long cpufreq_ctx_get_freq_kernel(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern unsigned long cpufreq_ctx_get_freq_hardware(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern unsigned long cpufreq_ctx_get_cur_freq(struct cpufreq_ctx *ctx, unsigned int cpu, int mode);
+extern int cpufreq_ctx_set_cur_freq_mode(struct cpufreq_ctx *ctx, int mode);
+extern int cpufreq_ctx_get_policy_value(struct cpufreq_ctx *ctx, unsigned int cpu,
+					struct cpufreq_policy_value *policy);
+extern int cpufreq_ctx_get_governor(struct cpufreq_ctx *ctx, unsigned int cpu,
+				    char *governor, size_t len);
+extern unsigned long cpufreq_ctx_get_transition_latency(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern int cpufreq_ctx_get_hardware_limits(struct cpufreq_ctx *ctx, unsigned int cpu,
+					   unsigned long *min, unsigned long *max);
+extern unsigned long cpufreq_ctx_get_transitions(struct cpufreq_ctx *ctx, unsigned int cpu);
+
+/* arena may be NULL; the results are then freed by the put functions of
+ * the calls without a context */
+extern char * cpufreq_ctx_get_driver(struct cpufreq_ctx *ctx, unsigned int cpu,
+				     struct cpufreq_arena *arena);
+extern struct cpufreq_policy * cpufreq_ctx_get_policy(struct cpufreq_ctx *ctx, unsigned int cpu,
+						      struct cpufreq_arena *arena);
+extern struct cpufreq_governor_vector * cpufreq_ctx_get_governor_vector(struct cpufreq_ctx *ctx,
+									unsigned int cpu,
+									struct cpufreq_arena *arena);
+extern struct cpufreq_frequency_vector * cpufreq_ctx_get_frequency_vector(struct cpufreq_ctx *ctx,
+									  unsigned int cpu,
+									  struct cpufreq_arena *arena);
+extern struct cpufreq_cpu_vector * cpufreq_ctx_get_affected_cpu_vector(struct cpufreq_ctx *ctx,
+								       unsigned int cpu,
+								       struct cpufreq_arena *arena);
+extern struct cpufreq_cpu_vector * cpufreq_ctx_get_related_cpu_vector(struct cpufreq_ctx *ctx,
+								      unsigned int cpu,
+								      struct cpufreq_arena *arena);
+extern struct cpufreq_stats_table * cpufreq_ctx_get_stats_table(struct cpufreq_ctx *ctx,
+								unsigned int cpu,
+								struct cpufreq_arena *arena);
+
+extern int cpufreq_ctx_get_snapshot(struct cpufreq_ctx *ctx, unsigned int cpu,
+				    struct cpufreq_snapshot *snap);
+extern struct cpufreq_system_snapshot * cpufreq_ctx_get_system_snapshot(struct cpufreq_ctx *ctx);
+extern struct cpufreq_cpu_vector * cpufreq_ctx_get_policy_vector(struct cpufreq_ctx *ctx);
+extern struct cpufreq_topology * cpufreq_ctx_get_topology(struct cpufreq_ctx *ctx);
+extern int cpufreq_ctx_get_affected_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+					    struct cpufreq_cpumask *mask);
+extern int cpufreq_ctx_get_related_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+					   struct cpufreq_cpumask *mask);
+extern struct cpufreq_stats_sample * cpufreq_ctx_get_stats_sample(struct cpufreq_ctx *ctx,
+								  const unsigned int *cpus,
+								  unsigned int nr_cpus);
+extern int cpufreq_ctx_get_trans_matrix(struct cpufreq_ctx *ctx, unsigned int cpu,
+					struct cpufreq_trans_matrix *matrix);
+
+extern int cpufreq_ctx_set_policy(struct cpufreq_ctx *ctx, unsigned int cpu,
+				  struct cpufreq_policy *policy);
+extern int cpufreq_ctx_set_policy_batch(struct cpufreq_ctx *ctx,
+					struct cpufreq_policy_request *reqs,
+					unsigned int nr);
+extern int cpufreq_ctx_modify_policy_min(struct cpufreq_ctx *ctx, unsigned int cpu,
+					 unsigned long min_freq);
+extern int cpufreq_ctx_modify_policy_max(struct cpufreq_ctx *ctx, unsigned int cpu,
+					 unsigned long max_freq);
+extern int cpufreq_ctx_modify_policy_governor(struct cpufreq_ctx *ctx, unsigned int cpu,
+					      char *governor);
+extern int cpufreq_ctx_set_frequency(struct cpufreq_ctx *ctx, unsigned int cpu,
+				     unsigned long target_frequency);
+
+extern struct cpufreq_async * cpufreq_ctx_async_open(struct cpufreq_ctx *ctx,
+						     int backend, unsigned int depth);
+extern struct cpufreq_trace * cpufreq_ctx_trace_open(struct cpufreq_ctx *ctx, const char *save);
+
 #ifdef __cplusplus
 }
 #endif
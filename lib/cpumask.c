@@ -0,0 +1,121 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Operations on struct cpufreq_cpumask. They work on whole words, so
+ * that e.g. grouping thousands of CPUs by policy costs a few dozen
+ * operations per policy rather than a scan over a list of CPUs.
+ */
+
+#include <string.h>
+
+#include "cpufreq.h"
+#include "parse.h"
+
+#define CPUMASK_WORDS	(CPUFREQ_MAX_CPUS / CPUFREQ_CPUMASK_BITS)
+
+void cpufreq_cpumask_zero(struct cpufreq_cpumask *mask)
+{
+	memset(mask, 0, sizeof(*mask));
+}
+
+void cpufreq_cpumask_or(struct cpufreq_cpumask *dst,
+			const struct cpufreq_cpumask *a,
+			const struct cpufreq_cpumask *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < CPUMASK_WORDS; i++)
+		dst->bits[i] = a->bits[i] | b->bits[i];
+}
+
+void cpufreq_cpumask_and(struct cpufreq_cpumask *dst,
+			 const struct cpufreq_cpumask *a,
+			 const struct cpufreq_cpumask *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < CPUMASK_WORDS; i++)
+		dst->bits[i] = a->bits[i] & b->bits[i];
+}
+
+void cpufreq_cpumask_andnot(struct cpufreq_cpumask *dst,
+			    const struct cpufreq_cpumask *a,
+			    const struct cpufreq_cpumask *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < CPUMASK_WORDS; i++)
+		dst->bits[i] = a->bits[i] & ~b->bits[i];
+}
+
+int cpufreq_cpumask_equal(const struct cpufreq_cpumask *a,
+			  const struct cpufreq_cpumask *b)
+{
+	return !memcmp(a->bits, b->bits, sizeof(a->bits));
+}
+
+int cpufreq_cpumask_intersects(const struct cpufreq_cpumask *a,
+			       const struct cpufreq_cpumask *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < CPUMASK_WORDS; i++)
+		if (a->bits[i] & b->bits[i])
+			return 1;
+
+	return 0;
+}
+
+unsigned int cpufreq_cpumask_weight(const struct cpufreq_cpumask *mask)
+{
+	unsigned int i, weight = 0;
+
+	for (i = 0; i < CPUMASK_WORDS; i++)
+		weight += __builtin_popcountl(mask->bits[i]);
+
+	return weight;
+}
+
+unsigned int cpufreq_cpumask_next(const struct cpufreq_cpumask *mask, unsigned int cpu)
+{
+	unsigned int i;
+	unsigned long word;
+
+	if (cpu >= CPUFREQ_MAX_CPUS)
+		return CPUFREQ_MAX_CPUS;
+
+	/* the first word is shifted to start at cpu, the others whole */
+	i = cpu / CPUFREQ_CPUMASK_BITS;
+	word = mask->bits[i] >> (cpu % CPUFREQ_CPUMASK_BITS);
+	if (word)
+		return cpu + __builtin_ctzl(word);
+
+	for (i++; i < CPUMASK_WORDS; i++)
+		if (mask->bits[i])
+			return i * CPUFREQ_CPUMASK_BITS + __builtin_ctzl(mask->bits[i]);
+
+	return CPUFREQ_MAX_CPUS;
+}
+
+unsigned int cpufreq_cpumask_parse(const char *buf, size_t len,
+				   struct cpufreq_cpumask *mask)
+{
+	unsigned int count;
+	int overflow;
+
+	memset(mask, 0, sizeof(*mask));
+	if (!buf)
+		return 0;
+
+	count = sysfs_parse_cpulist(buf, len, mask->bits, CPUFREQ_MAX_CPUS, &overflow);
+	if (overflow) {
+		/* not to be mistaken for the whole list */
+		memset(mask, 0, sizeof(*mask));
+		return 0;
+	}
+	return count;
+}
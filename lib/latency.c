@@ -0,0 +1,386 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Measured frequency transition latency. The measuring thread runs on
+ * the CPU itself, switches it between frequencies through
+ * scaling_setspeed and watches the speed it runs at, either by timing
+ * a fixed busy loop or by the ratio of the APERF and MPERF counters
+ * over the same loop. Each frequency's speed is calibrated first, and
+ * a switch counts as done once two samples in a row are near the new
+ * speed; the latency is the time from the start of the write to the
+ * start of the first of them, so it is exact to one sample.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpufreq.h"
+#include "sysfs.h"
+
+#define LATENCY_SAMPLE_NS	2000	/* aimed-for length of one sample */
+#define LATENCY_SETTLE_NS	20000000ULL	/* before calibrating */
+#define LATENCY_CALIBRATE	64	/* samples per frequency */
+#define LATENCY_DISTINCT	20	/* percent speeds must differ by */
+
+struct latency_probe {
+	int method;
+	int msr_fd;
+	unsigned int iters;		/* busy loop per sample */
+	unsigned long long aperf, mperf;		/* last MSR values */
+};
+
+static unsigned long long latency_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* a dependency chain the compiler can neither drop nor shorten */
+static void latency_spin(unsigned int iters)
+{
+	unsigned int i, acc = 0;
+
+	for (i = 0; i < iters; i++) {
+		acc = acc * 3 + 1;
+		__asm__ __volatile__("" : "+r" (acc));
+	}
+}
+
+/*
+ * One sample of the speed the CPU runs at, in arbitrary units
+ * proportional to its frequency, taken over one run of the busy loop
+ * ending at *end. Returns 0 if it couldn't be taken.
+ */
+static double latency_sample(struct latency_probe *probe, unsigned long long *end)
+{
+	unsigned long long start = latency_now();
+	unsigned long long aperf, mperf;
+	double rate;
+
+	latency_spin(probe->iters);
+
+	if (probe->method == CPUFREQ_LATENCY_BUSYLOOP) {
+		*end = latency_now();
+		return *end > start ? (double)probe->iters / (*end - start) : 0;
+	}
+
+	/* *end is needed in any case, to know when to give up */
+	if (sysfs_msr_read_perf(probe->msr_fd, &aperf, &mperf)) {
+		*end = latency_now();
+		return 0;
+	}
+	*end = latency_now();
+	rate = mperf != probe->mperf ? (double)(aperf - probe->aperf) / (mperf - probe->mperf) : 0;
+	probe->aperf = aperf;
+	probe->mperf = mperf;
+	return rate;
+}
+
+static int latency_probe_init(struct latency_probe *probe, unsigned int cpu, int method)
+{
+	unsigned long long start, end;
+
+	probe->msr_fd = -1;
+	if (method != CPUFREQ_LATENCY_BUSYLOOP) {
+		probe->msr_fd = sysfs_msr_open(cpu);
+		if (probe->msr_fd >= 0 &&
+		    sysfs_msr_read_perf(probe->msr_fd, &probe->aperf, &probe->mperf)) {
+			close(probe->msr_fd);
+			probe->msr_fd = -1;
+		}
+		if (probe->msr_fd < 0 && method == CPUFREQ_LATENCY_APERF)
+			return -EIO;
+	}
+	probe->method = probe->msr_fd >= 0 ? CPUFREQ_LATENCY_APERF : CPUFREQ_LATENCY_BUSYLOOP;
+
+	/* size the busy loop to about one sample */
+	for (probe->iters = 256; probe->iters < (1U << 28); probe->iters *= 2) {
+		start = latency_now();
+		latency_spin(probe->iters);
+		end = latency_now();
+		if (end - start >= LATENCY_SAMPLE_NS)
+			break;
+	}
+	return 0;
+}
+
+static int latency_cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int latency_cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int latency_setspeed(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long freq)
+{
+	char value[24];
+	unsigned int len = snprintf(value, sizeof(value), "%lu", freq);
+
+	return sysfs_write_file(ctx, cpu, "scaling_setspeed", value, len) == len ? 0 : -EIO;
+}
+
+/* median speed at freq, after it has had time to take effect */
+static double latency_calibrate(struct cpufreq_ctx *ctx, unsigned int cpu,
+				struct latency_probe *probe, unsigned long freq)
+{
+	double rate[LATENCY_CALIBRATE];
+	unsigned long long start, end;
+	unsigned int i;
+
+	if (latency_setspeed(ctx, cpu, freq))
+		return 0;
+
+	start = latency_now();
+	do
+		latency_sample(probe, &end);
+	while (end - start < LATENCY_SETTLE_NS);
+
+	for (i = 0; i < LATENCY_CALIBRATE; i++) {
+		rate[i] = latency_sample(probe, &end);
+		if (!rate[i])
+			return 0;
+	}
+	qsort(rate, LATENCY_CALIBRATE, sizeof(rate[0]), latency_cmp_double);
+	return rate[LATENCY_CALIBRATE / 2];
+}
+
+/*
+ * Time from the start of the write until two samples in a row are
+ * nearer to want than a quarter of the way from the other speed.
+ * Returns 0 on timeout, and the time the write took in *write_ns.
+ */
+static unsigned long long latency_switch(struct cpufreq_ctx *ctx, unsigned int cpu,
+					 struct latency_probe *probe, unsigned long freq,
+					 double from, double want, unsigned long long timeout_ns,
+					 unsigned long long *write_ns)
+{
+	double slack = (from > want ? from - want : want - from) / 4;
+	unsigned long long start, begin, end, first = 0;
+	double rate;
+
+	start = latency_now();
+	if (latency_setspeed(ctx, cpu, freq))
+		return 0;
+	begin = latency_now();
+	*write_ns = begin - start;
+
+	while (begin - start < timeout_ns) {
+		rate = latency_sample(probe, &end);
+		if (rate > want - slack && rate < want + slack) {
+			if (first)
+				return first - start;
+			first = begin;
+		} else {
+			first = 0;
+		}
+		begin = end;
+	}
+	return 0;
+}
+
+static void latency_pair_stats(struct cpufreq_latency_pair *pair,
+			       unsigned long long *ns, unsigned long long *write_ns)
+{
+	unsigned int i, n = pair->measured;
+	unsigned long long sum = 0;
+
+	if (!n)
+		return;
+
+	qsort(ns, n, sizeof(ns[0]), latency_cmp_ull);
+	qsort(write_ns, n, sizeof(write_ns[0]), latency_cmp_ull);
+	for (i = 0; i < n; i++)
+		sum += ns[i];
+
+	pair->min_ns = ns[0];
+	pair->median_ns = ns[n / 2];
+	pair->p90_ns = ns[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1];
+	pair->max_ns = ns[n - 1];
+	pair->mean_ns = sum / n;
+	pair->write_ns = write_ns[n / 2];
+}
+
+/* all available frequencies, if freqs is NULL */
+static unsigned int latency_freqs(struct cpufreq_ctx *ctx, unsigned int cpu,
+				  const unsigned long *freqs, unsigned int nr_freqs,
+				  unsigned long *out)
+{
+	struct cpufreq_frequency_vector *vec;
+	unsigned int i;
+
+	if (freqs) {
+		if (nr_freqs > CPUFREQ_MAX_STATES)
+			nr_freqs = CPUFREQ_MAX_STATES;
+		memcpy(out, freqs, nr_freqs * sizeof(*out));
+		return nr_freqs;
+	}
+
+	vec = sysfs_get_frequency_vector(ctx, cpu, NULL);
+	if (!vec)
+		return 0;
+	for (i = 0; i < vec->count && i < CPUFREQ_MAX_STATES; i++)
+		out[i] = vec->frequency[i];
+	free(vec);
+	return i;
+}
+
+static int latency_pin(unsigned int cpu, cpu_set_t **saved, size_t *size)
+{
+	cpu_set_t *set;
+
+	*size = CPU_ALLOC_SIZE(CPUFREQ_MAX_CPUS);
+	*saved = CPU_ALLOC(CPUFREQ_MAX_CPUS);
+	set = CPU_ALLOC(CPUFREQ_MAX_CPUS);
+	if (!*saved || !set || sched_getaffinity(0, *size, *saved))
+		goto err;
+
+	CPU_ZERO_S(*size, set);
+	CPU_SET_S(cpu, *size, set);
+	if (sched_setaffinity(0, *size, set))
+		goto err;
+
+	CPU_FREE(set);
+	return 0;
+ err:
+	CPU_FREE(set);
+	CPU_FREE(*saved);
+	*saved = NULL;
+	return errno ? -errno : -EINVAL;
+}
+
+struct cpufreq_latency_report * sysfs_measure_latency(struct cpufreq_ctx *ctx, unsigned int cpu,
+						      int method, const unsigned long *freqs,
+						      unsigned int nr_freqs, unsigned int rounds,
+						      unsigned long timeout_us)
+{
+	struct cpufreq_latency_report *report = NULL;
+	struct cpufreq_policy_value saved;
+	struct latency_probe probe;
+	struct cpufreq_latency_pair *pair;
+	unsigned long freq[CPUFREQ_MAX_STATES];
+	double rate[CPUFREQ_MAX_STATES];
+	unsigned long long *ns = NULL, *write_ns = NULL, lat, wns;
+	unsigned long long timeout_ns = timeout_us * 1000ULL;
+	unsigned long setspeed = 0;
+	unsigned int i, j, r, n, nr_pairs;
+	cpu_set_t *affinity;
+	size_t affinity_size;
+
+	if (cpufreq_is_policy(cpu) || cpu >= CPUFREQ_MAX_CPUS || !rounds || !timeout_us)
+		return NULL;
+
+	n = latency_freqs(ctx, cpu, freqs, nr_freqs, freq);
+	if (n < 2)
+		return NULL;
+	nr_pairs = n * (n - 1);
+
+	report = calloc(1, sizeof(*report) + nr_pairs * sizeof(*report->pair));
+	ns = malloc(rounds * sizeof(*ns));
+	write_ns = malloc(rounds * sizeof(*write_ns));
+	if (!report || !ns || !write_ns)
+		goto err;
+	report->pair = (struct cpufreq_latency_pair *)(report + 1);
+
+	if (sysfs_get_policy_value(ctx, cpu, &saved))
+		goto err;
+	if (!strcmp(saved.governor, "userspace"))
+		setspeed = sysfs_get_freq_kernel(ctx, cpu);
+	else if (sysfs_modify_policy_governor(ctx, cpu, "userspace"))
+		goto err;
+
+	if (latency_pin(cpu, &affinity, &affinity_size))
+		goto restore;
+	if (latency_probe_init(&probe, cpu, method))
+		goto unpin;
+
+	report->cpu = cpu;
+	report->method = probe.method;
+	report->advertised_ns = sysfs_get_transition_latency(ctx, cpu);
+	report->rounds = rounds;
+	report->nr_freqs = n;
+	memcpy(report->frequency, freq, n * sizeof(freq[0]));
+	for (i = 0; i < n; i++)
+		rate[i] = latency_calibrate(ctx, cpu, &probe, freq[i]);
+	report->sample_ns = latency_now();
+	latency_sample(&probe, &lat);
+	report->sample_ns = lat - report->sample_ns;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			double lo, hi;
+
+			if (i == j)
+				continue;
+			pair = &report->pair[report->nr_pairs++];
+			pair->from = freq[i];
+			pair->to = freq[j];
+
+			lo = rate[i] < rate[j] ? rate[i] : rate[j];
+			hi = rate[i] < rate[j] ? rate[j] : rate[i];
+			if (!lo || (hi - lo) * 100 < hi * LATENCY_DISTINCT) {
+				pair->indistinct = 1;
+				continue;
+			}
+
+			for (r = 0; r < rounds; r++) {
+				/* from a settled start, else the round is lost */
+				if (!latency_switch(ctx, cpu, &probe, freq[i], rate[j], rate[i],
+						    timeout_ns, &wns)) {
+					pair->timeouts++;
+					continue;
+				}
+				lat = latency_switch(ctx, cpu, &probe, freq[j], rate[i], rate[j],
+						     timeout_ns, &wns);
+				if (!lat) {
+					pair->timeouts++;
+					continue;
+				}
+				write_ns[pair->measured] = wns;
+				ns[pair->measured++] = lat;
+			}
+			latency_pair_stats(pair, ns, write_ns);
+		}
+	}
+
+ unpin:
+	if (probe.msr_fd >= 0)
+		close(probe.msr_fd);
+	sched_setaffinity(0, affinity_size, affinity);
+	CPU_FREE(affinity);
+ restore:
+	if (setspeed)
+		latency_setspeed(ctx, cpu, setspeed);
+	else
+		sysfs_modify_policy_governor(ctx, cpu, saved.governor);
+	free(ns);
+	free(write_ns);
+	if (report->nr_freqs)
+		return report;
+	free(report);
+	return NULL;
+
+ err:
+	free(report);
+	free(ns);
+	free(write_ns);
+	return NULL;
+}
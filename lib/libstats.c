@@ -0,0 +1,152 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Counters and latency histograms of the sysfs files the library reads
+ * and writes, per file name. Counting is lock-free; only adding a file
+ * name not seen before takes a lock. The table is only allocated while
+ * counting is enabled, so that a disabled context pays one test of a
+ * NULL pointer per file access.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpufreq.h"
+#include "sysfs.h"
+
+struct sysfs_lib_stats {
+	pthread_mutex_t lock;		/* taken to add attributes */
+	unsigned int nr_attrs;
+	struct cpufreq_lib_attr_stats attr[CPUFREQ_LIB_STATS_MAX_ATTRS];
+};
+
+/* everything beyond the table goes here */
+#define LIB_STATS_OTHER		(CPUFREQ_LIB_STATS_MAX_ATTRS - 1)
+
+unsigned long long sysfs_lib_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct sysfs_lib_stats * sysfs_lib_stats_alloc(void)
+{
+	struct sysfs_lib_stats *stats;
+
+	stats = calloc(1, sizeof(*stats));
+	if (!stats)
+		return NULL;
+	pthread_mutex_init(&stats->lock, NULL);
+	strcpy(stats->attr[LIB_STATS_OTHER].name, "other");
+
+	return stats;
+}
+
+void sysfs_lib_stats_free(struct sysfs_lib_stats *stats)
+{
+	if (!stats)
+		return;
+
+	pthread_mutex_destroy(&stats->lock);
+	free(stats);
+}
+
+static struct cpufreq_lib_attr_stats * sysfs_lib_attr(struct sysfs_lib_stats *stats,
+						       const char *fname)
+{
+	unsigned int i, nr;
+
+	nr = __atomic_load_n(&stats->nr_attrs, __ATOMIC_ACQUIRE);
+	for (i = 0; i < nr; i++)
+		if (!strcmp(stats->attr[i].name, fname))
+			return &stats->attr[i];
+
+	pthread_mutex_lock(&stats->lock);
+	for (i = nr; i < stats->nr_attrs; i++)
+		if (!strcmp(stats->attr[i].name, fname))
+			break;
+	if (i == stats->nr_attrs && i < LIB_STATS_OTHER &&
+	    strlen(fname) < sizeof(stats->attr[i].name)) {
+		strcpy(stats->attr[i].name, fname);
+		__atomic_store_n(&stats->nr_attrs, i + 1, __ATOMIC_RELEASE);
+	} else if (i == stats->nr_attrs) {
+		i = LIB_STATS_OTHER;
+	}
+	pthread_mutex_unlock(&stats->lock);
+
+	return &stats->attr[i];
+}
+
+static unsigned int sysfs_lib_bucket(unsigned long long ns)
+{
+	unsigned int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+
+	return bucket < CPUFREQ_LIB_STATS_BUCKETS ? bucket : CPUFREQ_LIB_STATS_BUCKETS - 1;
+}
+
+/* bytes is what read() or write() returned, 0 meaning failure */
+void sysfs_lib_stats_account(struct sysfs_lib_stats *stats, const char *fname, int write,
+			     unsigned long long ns, unsigned int bytes, unsigned int syscalls)
+{
+	struct cpufreq_lib_attr_stats *attr = sysfs_lib_attr(stats, fname);
+	struct cpufreq_lib_op_stats *op = write ? &attr->write : &attr->read;
+
+	__atomic_fetch_add(&op->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&op->bytes, bytes, __ATOMIC_RELAXED);
+	if (!bytes)
+		__atomic_fetch_add(&op->errors, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&op->syscalls, syscalls, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&op->total_ns, ns, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&op->hist[sysfs_lib_bucket(ns)], 1, __ATOMIC_RELAXED);
+}
+
+void sysfs_lib_stats_shm(struct sysfs_lib_stats *stats, const char *fname)
+{
+	__atomic_fetch_add(&sysfs_lib_attr(stats, fname)->shm_reads, 1, __ATOMIC_RELAXED);
+}
+
+static void sysfs_lib_copy_op(struct cpufreq_lib_op_stats *dst, struct cpufreq_lib_op_stats *src)
+{
+	unsigned int i;
+
+	dst->calls = __atomic_load_n(&src->calls, __ATOMIC_RELAXED);
+	dst->bytes = __atomic_load_n(&src->bytes, __ATOMIC_RELAXED);
+	dst->errors = __atomic_load_n(&src->errors, __ATOMIC_RELAXED);
+	dst->syscalls = __atomic_load_n(&src->syscalls, __ATOMIC_RELAXED);
+	dst->total_ns = __atomic_load_n(&src->total_ns, __ATOMIC_RELAXED);
+	for (i = 0; i < CPUFREQ_LIB_STATS_BUCKETS; i++)
+		dst->hist[i] = __atomic_load_n(&src->hist[i], __ATOMIC_RELAXED);
+}
+
+static void sysfs_lib_copy_attr(struct cpufreq_lib_attr_stats *dst,
+				struct cpufreq_lib_attr_stats *src)
+{
+	memcpy(dst->name, src->name, sizeof(dst->name));
+	sysfs_lib_copy_op(&dst->read, &src->read);
+	sysfs_lib_copy_op(&dst->write, &src->write);
+	dst->shm_reads = __atomic_load_n(&src->shm_reads, __ATOMIC_RELAXED);
+}
+
+/* the counters may move on while they are copied, but each of them is
+ * read atomically */
+void sysfs_lib_stats_copy(struct sysfs_lib_stats *stats, struct cpufreq_lib_stats *out)
+{
+	struct cpufreq_lib_attr_stats *other = &stats->attr[LIB_STATS_OTHER];
+	unsigned int i, nr;
+
+	nr = __atomic_load_n(&stats->nr_attrs, __ATOMIC_ACQUIRE);
+	for (i = 0; i < nr; i++)
+		sysfs_lib_copy_attr(&out->attr[i], &stats->attr[i]);
+	if (other->read.calls || other->write.calls || other->shm_reads)
+		sysfs_lib_copy_attr(&out->attr[nr++], other);
+	out->nr_attrs = nr;
+}
@@ -0,0 +1,76 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * The APERF and MPERF registers, read through the msr driver. MPERF
+ * counts at the base frequency and APERF at the one the CPU actually
+ * runs at, both only while the CPU is not idle. Every read of
+ * /dev/cpu/N/msr makes the kernel run rdmsr on CPU N, which interrupts
+ * it unless the reader already runs there.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpufreq.h"
+#include "sysfs.h"
+
+#define MSR_IA32_MPERF		0xe7
+#define MSR_IA32_APERF		0xe8
+
+/* returns an fd, or a negative errno */
+int sysfs_msr_open(unsigned int cpu)
+{
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), "/dev/cpu/%u/msr", cpu & ~CPUFREQ_POLICY_FLAG);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	return fd >= 0 ? fd : -errno;
+}
+
+int sysfs_msr_read_perf(int fd, unsigned long long *aperf, unsigned long long *mperf)
+{
+	if (pread(fd, aperf, sizeof(*aperf), MSR_IA32_APERF) != sizeof(*aperf) ||
+	    pread(fd, mperf, sizeof(*mperf), MSR_IA32_MPERF) != sizeof(*mperf))
+		return -EIO;
+	return 0;
+}
+
+/* average frequency in kHz while the CPU wasn't idle during the next
+ * interval_us, given the base frequency; 0 if it can't be told */
+unsigned long sysfs_msr_get_freq(unsigned int cpu, unsigned long base, unsigned long interval_us)
+{
+	struct timespec ts = {
+		.tv_sec = interval_us / 1000000,
+		.tv_nsec = (interval_us % 1000000) * 1000,
+	};
+	unsigned long long aperf[2], mperf[2];
+	int fd;
+
+	fd = sysfs_msr_open(cpu);
+	if (fd < 0)
+		return 0;
+
+	if (sysfs_msr_read_perf(fd, &aperf[0], &mperf[0])) {
+		close(fd);
+		return 0;
+	}
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+	if (sysfs_msr_read_perf(fd, &aperf[1], &mperf[1])) {
+		close(fd);
+		return 0;
+	}
+	close(fd);
+
+	if (mperf[1] == mperf[0])
+		return 0;
+	return (double)(aperf[1] - aperf[0]) / (mperf[1] - mperf[0]) * base + 0.5;
+}
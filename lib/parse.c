@@ -0,0 +1,213 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Parsers for the numeric sysfs files read by libcpufreq. They work in
+ * place on the buffer filled by sysfs_read_file(), in a single pass, and
+ * never look beyond buf + len, so they don't depend on the buffer being
+ * terminated. Numbers are unsigned decimals separated by any amount of
+ * whitespace.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+
+#include "parse.h"
+
+static inline int is_space(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t';
+}
+
+/* parses the number at *pos, skipping leading whitespace, and advances
+ * *pos behind it. Returns 0 on success, -EINVAL if there is no number at
+ * *pos (*pos then points to the offending character, or to end), and
+ * -ERANGE on overflow. */
+int sysfs_parse_number(const char **pos, const char *end,
+		       unsigned long long *value)
+{
+	const char *p = *pos;
+	unsigned long long v = 0;
+	unsigned int digit;
+
+	while (p < end && is_space(*p))
+		p++;
+	*pos = p;
+
+	if (p == end || *p < '0' || *p > '9')
+		return -EINVAL;
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		digit = *p - '0';
+		if (v > (ULLONG_MAX - digit) / 10)
+			return -ERANGE;
+		v = v * 10 + digit;
+	}
+
+	*pos = p;
+	*value = v;
+	return 0;
+}
+
+unsigned int sysfs_parse_count_words(const char *buf, size_t len)
+{
+	unsigned int count = 0;
+	int in_word = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (is_space(buf[i])) {
+			in_word = 0;
+		} else if (!in_word) {
+			in_word = 1;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* parse up to max numbers; stops at the first thing which isn't one */
+unsigned int sysfs_parse_ulongs(const char *buf, size_t len,
+				unsigned long *values, unsigned int max)
+{
+	const char *pos = buf, *end = buf + len;
+	unsigned long long value;
+	unsigned int count = 0;
+
+	while (count < max && !sysfs_parse_number(&pos, end, &value)) {
+		if (value > ULONG_MAX)
+			break;
+		values[count++] = value;
+	}
+
+	return count;
+}
+
+unsigned int sysfs_parse_uints(const char *buf, size_t len,
+			       unsigned int *values, unsigned int max)
+{
+	const char *pos = buf, *end = buf + len;
+	unsigned long long value;
+	unsigned int count = 0;
+
+	while (count < max && !sysfs_parse_number(&pos, end, &value)) {
+		if (value > UINT_MAX)
+			break;
+		values[count++] = value;
+	}
+
+	return count;
+}
+
+/* parse up to max "first second" pairs, as found in time_in_state */
+unsigned int sysfs_parse_pairs(const char *buf, size_t len,
+			       unsigned long *first,
+			       unsigned long long *second,
+			       unsigned int max)
+{
+	const char *pos = buf, *end = buf + len;
+	unsigned long long a, b;
+	unsigned int count = 0;
+
+	while (count < max) {
+		if (sysfs_parse_number(&pos, end, &a) || a > ULONG_MAX)
+			break;
+		if (sysfs_parse_number(&pos, end, &b))
+			break;
+		first[count] = a;
+		second[count] = b;
+		count++;
+	}
+
+	return count;
+}
+
+/* parse a CPU list, either a range list like "0-3,8,10-11" as found in
+ * online or cpulist files, or separated by spaces like "0 1 2 3" as in
+ * affected_cpus, setting the bits of the CPUs listed below nr_bits.
+ * Returns the number of bits set, or 0 if buf is not a CPU list. If
+ * overflow isn't NULL, it tells whether CPUs at or above nr_bits were
+ * listed and left out. */
+unsigned int sysfs_parse_cpulist(const char *buf, size_t len,
+				 unsigned long *bits, unsigned int nr_bits,
+				 int *overflow)
+{
+	const char *pos = buf, *end = buf + len;
+	unsigned long long first, last, cpu;
+	unsigned int count = 0;
+	const unsigned int word = 8 * sizeof(unsigned long);
+
+	if (overflow)
+		*overflow = 0;
+
+	for (;;) {
+		if (sysfs_parse_number(&pos, end, &first))
+			break;
+		last = first;
+		if (pos < end && *pos == '-') {
+			pos++;
+			if (sysfs_parse_number(&pos, end, &last) || last < first)
+				return 0;
+		}
+		if (overflow && last >= nr_bits)
+			*overflow = 1;
+		for (cpu = first; cpu <= last && cpu < nr_bits; cpu++) {
+			if (!(bits[cpu / word] & (1UL << (cpu % word))))
+				count++;
+			bits[cpu / word] |= 1UL << (cpu % word);
+		}
+		if (pos < end && *pos == ',')
+			pos++;
+	}
+
+	return count;
+}
+
+/* parse one line of stats/trans_table: a header line, a line of the n
+ * frequencies after a ':', and n lines of "freq: " followed by the n
+ * counts of transitions from that frequency to each of them. Fills
+ * freqs[n] and counts[from * n + to] for up to max states; the table is
+ * complete when lines == n + 2. Returns 0, or -EINVAL if the line
+ * doesn't belong into a table. */
+int sysfs_parse_trans_line(struct sysfs_trans_parse *tp, const char *line, size_t len)
+{
+	const char *pos = line, *end = line + len;
+	unsigned long long label;
+	unsigned int row;
+
+	switch (tp->lines) {
+	case 0:
+		/* "   From  :    To" */
+		break;
+	case 1:
+		/* "         :   f1   f2 ..." */
+		while (pos < end && is_space(*pos))
+			pos++;
+		if (pos == end || *pos != ':')
+			return -EINVAL;
+		pos++;
+		tp->n = sysfs_parse_ulongs(pos, end - pos, tp->freqs, tp->max);
+		if (!tp->n || sysfs_parse_count_words(pos, end - pos) != tp->n)
+			return -EINVAL;
+		break;
+	default:
+		row = tp->lines - 2;
+		if (row >= tp->n)
+			return -EINVAL;
+		if (sysfs_parse_number(&pos, end, &label) || label != tp->freqs[row] ||
+		    pos == end || *pos != ':')
+			return -EINVAL;
+		pos++;
+		if (sysfs_parse_uints(pos, end - pos, tp->counts + row * tp->n, tp->n) != tp->n ||
+		    sysfs_parse_count_words(pos, end - pos) != tp->n)
+			return -EINVAL;
+	}
+
+	tp->lines++;
+	return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ *  parsers for the contents of sysfs files, see parse.c
+ */
+
+extern int sysfs_parse_number(const char **pos, const char *end,
+			      unsigned long long *value);
+extern unsigned int sysfs_parse_count_words(const char *buf, size_t len);
+extern unsigned int sysfs_parse_ulongs(const char *buf, size_t len,
+				       unsigned long *values, unsigned int max);
+extern unsigned int sysfs_parse_uints(const char *buf, size_t len,
+				      unsigned int *values, unsigned int max);
+extern unsigned int sysfs_parse_pairs(const char *buf, size_t len,
+				      unsigned long *first,
+				      unsigned long long *second,
+				      unsigned int max);
+extern unsigned int sysfs_parse_cpulist(const char *buf, size_t len,
+					unsigned long *bits, unsigned int nr_bits,
+					int *overflow);
+
+struct sysfs_trans_parse {
+	unsigned long *freqs;		/* [max] */
+	unsigned int *counts;		/* [max * max] */
+	unsigned int max;
+	unsigned int n;			/* states */
+	unsigned int lines;		/* parsed so far */
+};
+
+extern int sysfs_parse_trans_line(struct sysfs_trans_parse *tp, const char *line, size_t len);
@@ -0,0 +1,481 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * One sampler for many processes.
+ *
+ * A publisher (cpufreq-publish) reads the files listed below for every
+ * online CPU at a fixed interval, and copies their contents into a
+ * POSIX shared memory segment, one slot per CPU. sysfs_read_file() of
+ * every process using libcpufreq then copies from the slot instead of
+ * asking the kernel, as long as the publisher is alive and reads the
+ * same sysfs tree. Each slot has a sequence count which is odd while
+ * the publisher writes it; readers retry if it was odd or changed while
+ * they copied.
+ *
+ * Published values are as old as the publisher's interval. After a
+ * write through a context, it reads from sysfs again until the
+ * publisher has sampled anew.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "cpufreq.h"
+#include "sysfs.h"
+#include "shm.h"
+
+#define SHM_MAGIC	0x51524643	/* "CFRQ" */
+#define SHM_VERSION	1
+#define SHM_ALIGN	64
+#define SHM_PATH_MAX	256
+#define SHM_RETRY_NS	1000000000ULL	/* between attempts to attach */
+#define SHM_GRACE_NS	20000000ULL	/* lateness of the publisher tolerated */
+#define SHM_READ_TRIES	64
+
+/* the published files, and where their contents go in a slot */
+static const struct {
+	const char *fname;
+	unsigned int offset;
+	unsigned int size;
+} shm_files[] = {
+	{ "scaling_cur_freq",		0,	32 },
+	{ "scaling_min_freq",		32,	32 },
+	{ "scaling_max_freq",		64,	32 },
+	{ "scaling_governor",		96,	32 },
+	{ "scaling_driver",		128,	32 },
+	{ "cpuinfo_min_freq",		160,	32 },
+	{ "cpuinfo_max_freq",		192,	32 },
+	{ "stats/total_trans",		224,	32 },
+	{ "stats/time_in_state",	256,	2048 },
+};
+
+#define SHM_FILES	(sizeof(shm_files) / sizeof(shm_files[0]))
+#define SHM_DATA_LEN	(256 + 2048)
+
+struct shm_header {
+	uint32_t magic;			/* written last */
+	uint32_t version;
+	uint32_t nr_slots;
+	uint32_t slot_size;
+	uint64_t interval;		/* ns */
+	uint64_t heartbeat;		/* CLOCK_MONOTONIC ns of the last update */
+	char path_to_cpu[SHM_PATH_MAX];	/* of the publisher's context */
+};
+
+struct shm_slot {
+	uint32_t seq;
+	uint32_t valid;			/* bit per file in shm_files */
+	uint64_t timestamp;		/* CLOCK_MONOTONIC ns when read */
+	uint16_t len[SHM_FILES];
+	char data[SHM_DATA_LEN];
+};
+
+#define SHM_ALIGNED(size)	(((size) + SHM_ALIGN - 1) & ~((size_t) SHM_ALIGN - 1))
+#define SHM_SLOTS_OFFSET	SHM_ALIGNED(sizeof(struct shm_header))
+#define SHM_SLOT_SIZE		SHM_ALIGNED(sizeof(struct shm_slot))
+
+static uint64_t shm_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct shm_slot * shm_slot(const struct shm_header *header, unsigned int cpu)
+{
+	return (struct shm_slot *) ((char *) header + SHM_SLOTS_OFFSET +
+				    (size_t) cpu * header->slot_size);
+}
+
+
+/* reading */
+
+struct shm_map {
+	struct shm_header *header;
+	size_t size;
+	uint64_t max_age;		/* ns a heartbeat stays good for */
+	struct shm_map *next;		/* on the retired list */
+};
+
+/* Mappings replaced while the context is in use may still be read by
+ * other threads, so they are retired rather than unmapped, until the
+ * context is closed or its root changes. That only happens when a
+ * publisher is restarted. */
+struct sysfs_shm_reader {
+	char name[SYSFS_SHM_NAME_MAX];
+	pthread_mutex_t lock;
+	struct shm_map *map;		/* NULL until attached */
+	struct shm_map *retired;
+	uint64_t next_attach;		/* ns */
+	uint64_t written;		/* ns of the last write to sysfs */
+};
+
+static void shm_unmap(struct shm_map *map)
+{
+	munmap(map->header, map->size);
+	free(map);
+}
+
+static struct shm_map * shm_attach(const char *name, const char *path_to_cpu)
+{
+	struct shm_header *header;
+	struct shm_map *map;
+	struct stat st;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+	/* anybody may create a segment of that name: only trust those of
+	 * root or of our own user, which nobody else can write to */
+	if (fstat(fd, &st) || (st.st_uid != 0 && st.st_uid != geteuid()) ||
+	    (st.st_mode & (S_IWGRP | S_IWOTH)) ||
+	    (size_t) st.st_size < SHM_SLOTS_OFFSET) {
+		close(fd);
+		return NULL;
+	}
+	header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+		return NULL;
+
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+	    header->version != SHM_VERSION || header->slot_size != SHM_SLOT_SIZE ||
+	    SHM_SLOTS_OFFSET + (size_t) header->nr_slots * header->slot_size > (size_t) st.st_size ||
+	    strncmp(header->path_to_cpu, path_to_cpu, sizeof(header->path_to_cpu)))
+		goto fail;
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		goto fail;
+	map->header = header;
+	map->size = st.st_size;
+	map->max_age = 2 * header->interval + SHM_GRACE_NS;
+	return map;
+
+ fail:
+	munmap(header, st.st_size);
+	return NULL;
+}
+
+static int shm_alive(const struct shm_map *map, uint64_t now)
+{
+	uint64_t heartbeat = __atomic_load_n(&map->header->heartbeat, __ATOMIC_ACQUIRE);
+
+	/* a heartbeat after now is fine, too */
+	return (int64_t) (now - heartbeat) <= (int64_t) map->max_age;
+}
+
+/* the mapping of a live publisher, attaching at most once per
+ * SHM_RETRY_NS while there is none */
+static struct shm_map * shm_current(struct sysfs_shm_reader *reader, const char *path_to_cpu,
+				    uint64_t now)
+{
+	struct shm_map *map, *fresh;
+
+	map = __atomic_load_n(&reader->map, __ATOMIC_ACQUIRE);
+	if (map && shm_alive(map, now))
+		return map;
+	if (now < __atomic_load_n(&reader->next_attach, __ATOMIC_RELAXED))
+		return NULL;
+
+	pthread_mutex_lock(&reader->lock);
+	if (now >= reader->next_attach) {
+		__atomic_store_n(&reader->next_attach, now + SHM_RETRY_NS, __ATOMIC_RELAXED);
+		fresh = shm_attach(reader->name, path_to_cpu);
+		if (fresh && !shm_alive(fresh, now)) {
+			shm_unmap(fresh);
+		} else if (fresh) {
+			if (reader->map) {
+				reader->map->next = reader->retired;
+				reader->retired = reader->map;
+			}
+			__atomic_store_n(&reader->map, fresh, __ATOMIC_RELEASE);
+		}
+	}
+	map = reader->map;
+	pthread_mutex_unlock(&reader->lock);
+
+	return map && shm_alive(map, now) ? map : NULL;
+}
+
+/* returns the length copied to buf, or 0 if the file is to be read
+ * from sysfs */
+unsigned int sysfs_shm_read(struct sysfs_shm_reader *reader, const char *path_to_cpu,
+			    unsigned int cpu, const char *fname, char *buf, size_t buflen)
+{
+	const struct shm_slot *slot;
+	struct shm_map *map;
+	uint64_t written;
+	uint32_t seq;
+	unsigned int file, len, tries;
+
+	if (cpufreq_is_policy(cpu))
+		return 0;
+	for (file = 0; file < SHM_FILES; file++)
+		if (!strcmp(fname, shm_files[file].fname))
+			break;
+	if (file == SHM_FILES)
+		return 0;
+
+	map = shm_current(reader, path_to_cpu, shm_now());
+	if (!map || cpu >= map->header->nr_slots)
+		return 0;
+	slot = shm_slot(map->header, cpu);
+	written = __atomic_load_n(&reader->written, __ATOMIC_RELAXED);
+
+	for (tries = 0; tries < SHM_READ_TRIES; tries++) {
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		len = 0;
+		if ((slot->valid & (1U << file)) && slot->timestamp > written) {
+			len = slot->len[file];
+			if (len <= shm_files[file].size && len < buflen)
+				memcpy(buf, slot->data + shm_files[file].offset, len);
+			else
+				len = 0;
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq) {
+			if (len)
+				buf[len] = '\0';
+			return len;
+		}
+	}
+
+	return 0;
+}
+
+void sysfs_shm_written(struct sysfs_shm_reader *reader)
+{
+	__atomic_store_n(&reader->written, shm_now(), __ATOMIC_RELAXED);
+}
+
+struct sysfs_shm_reader * sysfs_shm_reader_open(const char *name)
+{
+	struct sysfs_shm_reader *reader;
+
+	if (!name || !name[0] || strlen(name) >= SYSFS_SHM_NAME_MAX)
+		return NULL;
+
+	reader = calloc(1, sizeof(*reader));
+	if (!reader)
+		return NULL;
+	strcpy(reader->name, name);
+	pthread_mutex_init(&reader->lock, NULL);
+
+	return reader;
+}
+
+/* forgets all mappings; must not race with readers */
+void sysfs_shm_reader_flush(struct sysfs_shm_reader *reader)
+{
+	struct shm_map *map;
+
+	if (reader->map)
+		shm_unmap(reader->map);
+	while ((map = reader->retired)) {
+		reader->retired = map->next;
+		shm_unmap(map);
+	}
+	reader->map = NULL;
+	reader->next_attach = 0;
+}
+
+void sysfs_shm_reader_close(struct sysfs_shm_reader *reader)
+{
+	if (!reader)
+		return;
+
+	sysfs_shm_reader_flush(reader);
+	pthread_mutex_destroy(&reader->lock);
+	free(reader);
+}
+
+
+/* publishing */
+
+struct cpufreq_publisher {
+	struct cpufreq_ctx *ctx;
+	char name[SYSFS_SHM_NAME_MAX];
+	struct shm_header *header;
+	size_t size;
+	struct shm_slot staging;
+};
+
+struct cpufreq_publisher * sysfs_publisher_create(const char *name, const char *root,
+						  unsigned long interval_us)
+{
+	struct cpufreq_publisher *pub;
+	struct cpufreq_topology *topo;
+	struct shm_header *header;
+	struct rlimit nofile;
+	unsigned int nr_slots, nr_fds;
+	int fd;
+
+	if (!name)
+		name = SYSFS_SHM_DEFAULT;
+	if (!name[0] || strlen(name) >= SYSFS_SHM_NAME_MAX || !interval_us)
+		return NULL;
+
+	pub = calloc(1, sizeof(*pub));
+	if (!pub)
+		return NULL;
+	strcpy(pub->name, name);
+
+	/* the publisher's own reads go to sysfs, of course */
+	pub->ctx = sysfs_ctx_open(root);
+	if (!pub->ctx)
+		goto fail;
+	sysfs_set_shm(pub->ctx, NULL);
+
+	topo = sysfs_get_topology(pub->ctx);
+	if (!topo)
+		goto fail;
+	nr_slots = topo->nr_cpu_ids;
+	nr_fds = topo->nr_policies * SHM_FILES + 16;
+	sysfs_put_topology(topo);
+
+	/* keep all files open, leaving half of the allowed fds for
+	 * everything else */
+	if (!getrlimit(RLIMIT_NOFILE, &nofile) && nofile.rlim_cur != RLIM_INFINITY &&
+	    nr_fds > nofile.rlim_cur / 2)
+		nr_fds = nofile.rlim_cur / 2;
+	sysfs_fd_cache_enable(pub->ctx, nr_fds);
+
+	pub->size = SHM_SLOTS_OFFSET + (size_t) nr_slots * SHM_SLOT_SIZE;
+	/* never take over a segment somebody else created */
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+		goto fail;
+	if (ftruncate(fd, pub->size)) {
+		close(fd);
+		goto fail_unlink;
+	}
+	header = mmap(NULL, pub->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+		goto fail_unlink;
+
+	header->version = SHM_VERSION;
+	header->nr_slots = nr_slots;
+	header->slot_size = SHM_SLOT_SIZE;
+	header->interval = interval_us * 1000ULL;
+	strncpy(header->path_to_cpu, sysfs_path_to_cpu(pub->ctx), sizeof(header->path_to_cpu) - 1);
+	__atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+	pub->header = header;
+
+	return pub;
+
+ fail_unlink:
+	shm_unlink(name);
+ fail:
+	if (pub->ctx)
+		sysfs_ctx_close(pub->ctx);
+	free(pub);
+	return NULL;
+}
+
+static void shm_read_slot(struct cpufreq_ctx *ctx, unsigned int cpu, struct shm_slot *staging)
+{
+	char buf[4096];
+	unsigned int file, len;
+
+	staging->valid = 0;
+	for (file = 0; file < SHM_FILES; file++) {
+		len = sysfs_read_file(ctx, cpu, shm_files[file].fname, buf, sizeof(buf));
+		if (!len || len > shm_files[file].size) {
+			staging->len[file] = 0;
+			continue;
+		}
+		memcpy(staging->data + shm_files[file].offset, buf, len);
+		staging->len[file] = len;
+		staging->valid |= 1U << file;
+	}
+}
+
+static void shm_write_slot(struct shm_slot *slot, const struct shm_slot *staging)
+{
+	uint32_t seq = slot->seq;
+	unsigned int file;
+
+	__atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	slot->valid = staging->valid;
+	slot->timestamp = staging->timestamp;
+	memcpy(slot->len, staging->len, sizeof(slot->len));
+	for (file = 0; file < SHM_FILES; file++)
+		if (staging->valid & (1U << file))
+			memcpy(slot->data + shm_files[file].offset,
+			       staging->data + shm_files[file].offset, staging->len[file]);
+
+	__atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* samples every online CPU once; the files are read for the first CPU
+ * of each policy only, and copied for the others */
+int sysfs_publisher_update(struct cpufreq_publisher *pub)
+{
+	struct shm_slot *staging = &pub->staging;
+	struct cpufreq_topology *topo;
+	unsigned int cpu, policy, staged = CPUFREQ_TOPO_UNKNOWN;
+	uint64_t now = shm_now();
+
+	topo = sysfs_get_topology(pub->ctx);
+	if (!topo)
+		return -ENODEV;
+
+	for (cpu = 0; cpu < pub->header->nr_slots; cpu++) {
+		policy = CPUFREQ_TOPO_UNKNOWN;
+		if (cpu < topo->nr_cpu_ids && cpufreq_cpumask_isset(&topo->online, cpu))
+			policy = topo->cpu[cpu].policy;
+
+		if (policy == CPUFREQ_TOPO_UNKNOWN) {
+			staging->valid = 0;
+			staged = policy;
+		} else if (policy != staged && policy < cpu &&
+			   shm_slot(pub->header, policy)->timestamp == now) {
+			/* only this process writes the slots, so no need
+			 * for the sequence count here */
+			memcpy(staging, shm_slot(pub->header, policy), sizeof(*staging));
+			staged = policy;
+		} else if (policy != staged) {
+			shm_read_slot(pub->ctx, cpu, staging);
+			staged = policy;
+		}
+
+		staging->timestamp = now;
+		shm_write_slot(shm_slot(pub->header, cpu), staging);
+	}
+
+	__atomic_store_n(&pub->header->heartbeat, now, __ATOMIC_RELEASE);
+	sysfs_put_topology(topo);
+	return 0;
+}
+
+void sysfs_publisher_destroy(struct cpufreq_publisher *pub)
+{
+	munmap(pub->header, pub->size);
+	shm_unlink(pub->name);
+	sysfs_ctx_close(pub->ctx);
+	free(pub);
+}
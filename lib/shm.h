@@ -0,0 +1,16 @@
+/*
+ *  values shared through a memory segment by cpufreq-publish, see shm.c
+ */
+
+#define SYSFS_SHM_DEFAULT	"/cpufreq"
+#define SYSFS_SHM_ENV		"CPUFREQ_SHM"
+#define SYSFS_SHM_NAME_MAX	64
+
+struct sysfs_shm_reader;
+
+extern struct sysfs_shm_reader * sysfs_shm_reader_open(const char *name);
+extern void sysfs_shm_reader_close(struct sysfs_shm_reader *reader);
+extern void sysfs_shm_reader_flush(struct sysfs_shm_reader *reader);
+extern unsigned int sysfs_shm_read(struct sysfs_shm_reader *reader, const char *path_to_cpu,
+				   unsigned int cpu, const char *fname, char *buf, size_t buflen);
+extern void sysfs_shm_written(struct sysfs_shm_reader *reader);
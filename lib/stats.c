@@ -0,0 +1,481 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Time in state deltas of many CPUs, and transition matrices.
+ *
+ * Samples and deltas keep their values as structure of arrays, with one
+ * row of nr_cpus values per state. The delta of a state and its sums
+ * over CPUs then come from one pass over contiguous memory, with no
+ * dependencies between CPUs and no 64 bit compares, which the compiler
+ * turns into vector code; this file is built with -O2 -ftree-vectorize
+ * (see the Makefile), as -Os doesn't vectorize.
+ *
+ * Each sample and delta is one block of memory, with every array
+ * starting on a cache line of its own.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpufreq.h"
+#include "sysfs.h"
+#include "parse.h"
+
+#define STATS_ALIGN	64
+#define STATS_NO_STATE	(~0U)
+
+/* layout of a block: the first pass with base == NULL only adds up the
+ * size, the second one hands out the arrays */
+struct stats_layout {
+	char *base;
+	size_t size;
+};
+
+static void * stats_carve(struct stats_layout *layout, size_t size)
+{
+	void *ptr = layout->base ? layout->base + layout->size : NULL;
+
+	layout->size += (size + STATS_ALIGN - 1) & ~((size_t) STATS_ALIGN - 1);
+	return ptr;
+}
+
+static void * stats_alloc(size_t size)
+{
+	void *ptr;
+
+	if (posix_memalign(&ptr, STATS_ALIGN, size))
+		return NULL;
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+static unsigned long long stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/* samples */
+
+struct stats_row {
+	unsigned int count;
+	unsigned long frequency[CPUFREQ_MAX_STATES];
+	unsigned long long time[CPUFREQ_MAX_STATES];
+	unsigned long total_trans;
+};
+
+/* returns the number of states read, 0 if there are no stats */
+static unsigned int stats_read_row(struct cpufreq_ctx *ctx, unsigned int cpu,
+				   struct stats_row *row)
+{
+	struct sysfs_stream stream;
+	char buf[32];
+	const char *pos = buf, *line;
+	unsigned long long value;
+	unsigned int len;
+
+	row->count = 0;
+	row->total_trans = 0;
+
+	if (sysfs_stream_open(&stream, ctx, cpu, "stats/time_in_state"))
+		return 0;
+	while (row->count < CPUFREQ_MAX_STATES && (line = sysfs_stream_line(&stream, &len)))
+		row->count += sysfs_parse_pairs(line, len, row->frequency + row->count,
+						row->time + row->count, 1);
+	sysfs_stream_close(&stream);
+
+	len = sysfs_read_file(ctx, cpu, "stats/total_trans", buf, sizeof(buf));
+	if (len && !sysfs_parse_number(&pos, buf + len, &value))
+		row->total_trans = value;
+
+	return row->count;
+}
+
+static unsigned int stats_find_state(const unsigned long *frequency, unsigned int nr_states,
+				     unsigned long freq)
+{
+	unsigned int lo = 0, hi = nr_states, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (frequency[mid] == freq)
+			return mid;
+		if (frequency[mid] > freq)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return STATS_NO_STATE;
+}
+
+static int stats_fill_row(struct cpufreq_stats_sample *sample, unsigned int i,
+			  const struct stats_row *row)
+{
+	size_t n = sample->nr_cpus;
+	unsigned int s, state;
+	int ret = 0;
+
+	sample->valid[i] = row->count != 0;
+	sample->total_trans[i] = row->total_trans;
+
+	/* the common case: all states, in the same order */
+	if (row->count == sample->nr_states &&
+	    !memcmp(row->frequency, sample->frequency, row->count * sizeof(*row->frequency))) {
+		for (s = 0; s < row->count; s++)
+			sample->time_in_state[s * n + i] = row->time[s];
+		return 0;
+	}
+
+	for (s = 0; s < sample->nr_states; s++)
+		sample->time_in_state[s * n + i] = 0;
+	for (s = 0; s < row->count; s++) {
+		state = stats_find_state(sample->frequency, sample->nr_states,
+					 row->frequency[s]);
+		if (state == STATS_NO_STATE)
+			ret = -EAGAIN;
+		else
+			sample->time_in_state[state * n + i] = row->time[s];
+	}
+
+	return ret;
+}
+
+static void stats_sample_layout(struct cpufreq_stats_sample *sample, struct stats_layout *layout,
+				unsigned int nr_cpus, unsigned int nr_states)
+{
+	stats_carve(layout, sizeof(*sample));
+	sample->cpu = stats_carve(layout, nr_cpus * sizeof(*sample->cpu));
+	sample->valid = stats_carve(layout, nr_cpus * sizeof(*sample->valid));
+	sample->frequency = stats_carve(layout, nr_states * sizeof(*sample->frequency));
+	sample->time_in_state = stats_carve(layout, (size_t) nr_states * nr_cpus *
+					    sizeof(*sample->time_in_state));
+	sample->total_trans = stats_carve(layout, nr_cpus * sizeof(*sample->total_trans));
+}
+
+struct cpufreq_stats_sample * sysfs_get_stats_sample(struct cpufreq_ctx *ctx,
+						     const unsigned int *cpus,
+						     unsigned int nr_cpus)
+{
+	struct cpufreq_stats_sample layout_sample, *sample = NULL;
+	struct cpufreq_topology *topo = NULL;
+	struct stats_layout layout = { NULL, 0 };
+	struct stats_row *rows = NULL;
+	unsigned long states[CPUFREQ_MAX_STATES];
+	unsigned long long timestamp;
+	unsigned int nr_states = 0, i, s, state;
+
+	if (!cpus) {
+		topo = sysfs_get_topology(ctx);
+		if (!topo)
+			return NULL;
+		cpus = topo->policies;
+		nr_cpus = topo->nr_policies;
+	}
+	if (!nr_cpus)
+		goto out;
+
+	rows = malloc(nr_cpus * sizeof(*rows));
+	if (!rows)
+		goto out;
+
+	/* read everything first, to know all states before laying out
+	 * the sample */
+	timestamp = stats_now();
+	for (i = 0; i < nr_cpus; i++) {
+		stats_read_row(ctx, cpus[i], &rows[i]);
+		for (s = 0; s < rows[i].count; s++) {
+			if (stats_find_state(states, nr_states, rows[i].frequency[s]) !=
+			    STATS_NO_STATE || nr_states == CPUFREQ_MAX_STATES)
+				continue;
+			for (state = nr_states; state > 0 &&
+				     states[state - 1] < rows[i].frequency[s]; state--)
+				states[state] = states[state - 1];
+			states[state] = rows[i].frequency[s];
+			nr_states++;
+		}
+	}
+
+	stats_sample_layout(&layout_sample, &layout, nr_cpus, nr_states);
+	layout.base = stats_alloc(layout.size);
+	if (!layout.base)
+		goto out;
+	layout.size = 0;
+	sample = (struct cpufreq_stats_sample *) layout.base;
+	stats_sample_layout(sample, &layout, nr_cpus, nr_states);
+
+	sample->ctx = ctx;
+	sample->nr_cpus = nr_cpus;
+	sample->nr_states = nr_states;
+	sample->timestamp = timestamp;
+	memcpy(sample->cpu, cpus, nr_cpus * sizeof(*cpus));
+	memcpy(sample->frequency, states, nr_states * sizeof(*states));
+	for (i = 0; i < nr_cpus; i++)
+		stats_fill_row(sample, i, &rows[i]);
+
+ out:
+	free(rows);
+	sysfs_put_topology(topo);
+	return sample;
+}
+
+int sysfs_refresh_stats_sample(struct cpufreq_stats_sample *sample)
+{
+	struct stats_row row;
+	unsigned int i;
+	int ret = 0;
+
+	sample->timestamp = stats_now();
+	for (i = 0; i < sample->nr_cpus; i++) {
+		stats_read_row(sample->ctx, sample->cpu[i], &row);
+		if (stats_fill_row(sample, i, &row))
+			ret = -EAGAIN;
+	}
+
+	return ret;
+}
+
+void sysfs_put_stats_sample(struct cpufreq_stats_sample *sample)
+{
+	free(sample);
+}
+
+
+/* deltas */
+
+struct stats_delta {
+	struct cpufreq_stats_delta delta;	/* must be first */
+	unsigned long long *weighted;		/* [nr_cpus], frequency * time */
+	unsigned long long *mask;		/* [nr_cpus], ~0 if valid in both */
+	unsigned long long *keep;		/* [nr_cpus], mask, 0 after a reset */
+};
+
+static void stats_delta_layout(struct stats_delta *d, struct stats_layout *layout,
+			       unsigned int nr_cpus, unsigned int nr_states)
+{
+	struct cpufreq_stats_delta *delta = &d->delta;
+
+	stats_carve(layout, sizeof(*d));
+	delta->cpu = stats_carve(layout, nr_cpus * sizeof(*delta->cpu));
+	delta->frequency = stats_carve(layout, nr_states * sizeof(*delta->frequency));
+	delta->time_in_state = stats_carve(layout, (size_t) nr_states * nr_cpus *
+					   sizeof(*delta->time_in_state));
+	delta->state_time = stats_carve(layout, nr_states * sizeof(*delta->state_time));
+	delta->total_time = stats_carve(layout, nr_cpus * sizeof(*delta->total_time));
+	delta->avg_frequency = stats_carve(layout, nr_cpus * sizeof(*delta->avg_frequency));
+	delta->transitions = stats_carve(layout, nr_cpus * sizeof(*delta->transitions));
+	delta->transition_rate = stats_carve(layout, nr_cpus * sizeof(*delta->transition_rate));
+	d->weighted = stats_carve(layout, nr_cpus * sizeof(*d->weighted));
+	d->mask = stats_carve(layout, nr_cpus * sizeof(*d->mask));
+	d->keep = stats_carve(layout, nr_cpus * sizeof(*d->keep));
+}
+
+static int stats_samples_match(const struct cpufreq_stats_sample *a,
+			       const struct cpufreq_stats_sample *b)
+{
+	return a->nr_cpus == b->nr_cpus && a->nr_states == b->nr_states &&
+		!memcmp(a->cpu, b->cpu, a->nr_cpus * sizeof(*a->cpu)) &&
+		!memcmp(a->frequency, b->frequency, a->nr_states * sizeof(*a->frequency));
+}
+
+/* one state of all CPUs */
+static unsigned long long stats_delta_state(size_t n, unsigned long long freq,
+					    const unsigned long long *restrict before,
+					    const unsigned long long *restrict after,
+					    const unsigned long long *restrict keep,
+					    const unsigned long long *restrict mask,
+					    unsigned long long *restrict delta,
+					    unsigned long long *restrict total,
+					    unsigned long long *restrict weighted)
+{
+	unsigned long long sum = 0, value;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		value = (after[i] & mask[i]) - (before[i] & keep[i]);
+		delta[i] = value;
+		total[i] += value;
+		weighted[i] += value * freq;
+		sum += value;
+	}
+
+	return sum;
+}
+
+int sysfs_refresh_stats_delta(struct cpufreq_stats_delta *delta,
+			      const struct cpufreq_stats_sample *before,
+			      const struct cpufreq_stats_sample *after)
+{
+	struct stats_delta *d = (struct stats_delta *) delta;
+	size_t n = after->nr_cpus;
+	unsigned long long all_time = 0, all_weighted = 0;
+	unsigned long trans;
+	unsigned int s;
+	size_t i;
+
+	if (!stats_samples_match(before, after) ||
+	    delta->nr_cpus != after->nr_cpus || delta->nr_states != after->nr_states)
+		return -EINVAL;
+
+	memcpy(delta->cpu, after->cpu, n * sizeof(*delta->cpu));
+	memcpy(delta->frequency, after->frequency, after->nr_states * sizeof(*delta->frequency));
+	delta->elapsed = after->timestamp > before->timestamp ?
+		after->timestamp - before->timestamp : 0;
+
+	/* resetting the stats of a CPU resets all its counters, and then
+	 * everything in after counts; total_trans tells */
+	for (i = 0; i < n; i++) {
+		d->mask[i] = (before->valid[i] && after->valid[i]) ? ~0ULL : 0;
+		d->keep[i] = after->total_trans[i] >= before->total_trans[i] ? d->mask[i] : 0;
+		delta->total_time[i] = 0;
+		d->weighted[i] = 0;
+	}
+
+	for (s = 0; s < after->nr_states; s++)
+		delta->state_time[s] =
+			stats_delta_state(n, after->frequency[s],
+					  before->time_in_state + s * n,
+					  after->time_in_state + s * n, d->keep, d->mask,
+					  delta->time_in_state + s * n,
+					  delta->total_time, d->weighted);
+
+	for (i = 0; i < n; i++) {
+		delta->avg_frequency[i] = delta->total_time[i] ?
+			d->weighted[i] / delta->total_time[i] : 0;
+		all_time += delta->total_time[i];
+		all_weighted += d->weighted[i];
+
+		trans = after->total_trans[i] - (d->keep[i] ? before->total_trans[i] : 0);
+		delta->transitions[i] = d->mask[i] ? trans : 0;
+		delta->transition_rate[i] = delta->elapsed ?
+			delta->transitions[i] * 1e9 / delta->elapsed : 0;
+	}
+	delta->avg_frequency_all = all_time ? all_weighted / all_time : 0;
+
+	return 0;
+}
+
+struct cpufreq_stats_delta * sysfs_get_stats_delta(const struct cpufreq_stats_sample *before,
+						   const struct cpufreq_stats_sample *after)
+{
+	struct stats_delta layout_delta, *d;
+	struct stats_layout layout = { NULL, 0 };
+
+	if (!stats_samples_match(before, after))
+		return NULL;
+
+	stats_delta_layout(&layout_delta, &layout, after->nr_cpus, after->nr_states);
+	layout.base = stats_alloc(layout.size);
+	if (!layout.base)
+		return NULL;
+	layout.size = 0;
+	d = (struct stats_delta *) layout.base;
+	stats_delta_layout(d, &layout, after->nr_cpus, after->nr_states);
+
+	d->delta.nr_cpus = after->nr_cpus;
+	d->delta.nr_states = after->nr_states;
+	sysfs_refresh_stats_delta(&d->delta, before, after);
+
+	return &d->delta;
+}
+
+void sysfs_put_stats_delta(struct cpufreq_stats_delta *delta)
+{
+	free(delta);
+}
+
+/* transition matrices */
+
+int sysfs_get_trans_matrix(struct cpufreq_ctx *ctx, unsigned int cpu,
+			   struct cpufreq_trans_matrix *matrix)
+{
+	struct sysfs_trans_parse tp = {
+		.freqs = matrix->frequency,
+		.counts = matrix->count,
+		.max = CPUFREQ_MAX_STATES,
+	};
+	struct sysfs_stream stream;
+	const char *line;
+	unsigned int len;
+	int ret = 0, err;
+
+	matrix->cpu = cpu;
+	matrix->nr_states = 0;
+	matrix->timestamp = stats_now();
+
+	if (sysfs_stream_open(&stream, ctx, cpu, "stats/trans_table"))
+		return -ENODEV;
+	while (!ret && (line = sysfs_stream_line(&stream, &len)))
+		ret = sysfs_parse_trans_line(&tp, line, len);
+	/* the kernel refuses tables which don't fit into a page with
+	 * -EFBIG; older ones cut them off */
+	err = sysfs_stream_close(&stream);
+	if (!ret && err)
+		return err == -EFBIG ? -EFBIG : -ENODEV;
+	if (ret || !tp.n || tp.lines != tp.n + 2)
+		return -EINVAL;
+
+	matrix->nr_states = tp.n;
+	return 0;
+}
+
+/* counts are 32 bit in the kernel, so a count going backwards means the
+ * stats were reset, and the new counts are the delta */
+int sysfs_get_trans_matrix_delta(const struct cpufreq_trans_matrix *before,
+				 const struct cpufreq_trans_matrix *after,
+				 struct cpufreq_trans_matrix *delta)
+{
+	unsigned int i, n = after->nr_states, cells = n * n, reset = 0;
+
+	if (before->nr_states != n ||
+	    memcmp(before->frequency, after->frequency, n * sizeof(after->frequency[0])))
+		return -EINVAL;
+
+	for (i = 0; i < cells; i++)
+		reset |= after->count[i] < before->count[i];
+	for (i = 0; i < cells; i++)
+		delta->count[i] = after->count[i] - (reset ? 0 : before->count[i]);
+
+	delta->cpu = after->cpu;
+	delta->nr_states = n;
+	delta->timestamp = after->timestamp;
+	memcpy(delta->frequency, after->frequency, n * sizeof(after->frequency[0]));
+	return 0;
+}
+
+/* the max pairs with the most transitions, most first */
+unsigned int sysfs_get_trans_hottest(const struct cpufreq_trans_matrix *matrix,
+				     struct cpufreq_trans_pair *pairs, unsigned int max)
+{
+	unsigned int from, to, i, nr = 0, n = matrix->nr_states, count;
+
+	if (!max)
+		return 0;
+
+	for (from = 0; from < n; from++) {
+		for (to = 0; to < n; to++) {
+			count = matrix->count[from * n + to];
+			if (!count || (nr == max && count <= pairs[nr - 1].count))
+				continue;
+
+			/* insert in order, dropping the last if full */
+			i = nr < max ? nr++ : nr - 1;
+			for (; i && pairs[i - 1].count < count; i--)
+				pairs[i] = pairs[i - 1];
+			pairs[i].from = matrix->frequency[from];
+			pairs[i].to = matrix->frequency[to];
+			pairs[i].count = count;
+		}
+	}
+
+	return nr;
+}
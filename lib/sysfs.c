@@ -9,537 +9,2270 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
-#include <limits.h>
+#include <stddef.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "cpufreq.h"
+#include "sysfs.h"
+#include "parse.h"
+#include "shm.h"
 
-#define PATH_TO_CPU "/sys/devices/system/cpu/"
+#define SYSFS_DEFAULT_ROOT "/sys"
+#define SYSFS_ROOT_ENV "CPUFREQ_SYSFS_ROOT"
+#define PATH_TO_CPU "/devices/system/cpu/"
 #define MAX_LINE_LEN 4096
 #define SYSFS_PATH_MAX 255
+#define SYSFS_FNAME_MAX 48
+#define SYSFS_FD_CACHE_MAX (1U << 20)	/* the kernel's default of nr_open */
+#define SYSFS_POLICY_LOCKS 64		/* stripes, a power of two */
 
-/* helper function to read file from /sys into given buffer */
-/* fname is a relative path under "cpuX/cpufreq" dir */
-unsigned int sysfs_read_file(unsigned int cpu, const char *fname, char *buf, size_t buflen)
+/* library contexts
+ *
+ * All state of the library lives in a struct cpufreq_ctx: where sysfs is
+ * mounted, the fd cache, the write elision settings and counters,
+ * which policy each CPU belongs to, the topology index, the segment of
+ * a publisher to read from, counters of the library's own work, and
+ * how snapshots read the current frequency. The cpufreq_* calls
+ * without a context argument use the default context, which is set up
+ * on first use.
+ *
+ * Settings (root, fd cache, write elision, shm, lib stats, current
+ * frequency mode) must not be changed while other threads use the same
+ * context. Everything else may be called concurrently: the fd cache and
+ * the policy map are read without any locks, and writes to a policy are
+ * serialized by
+ * a lock, which it shares with every SYSFS_POLICY_LOCKS-th policy.
+ */
+
+struct sysfs_fd_entry;
+struct sysfs_elide_entry;
+struct sysfs_topology;
+
+struct cpufreq_ctx {
+	/* where sysfs is mounted, e.g. a fake tree created by
+	 * debug/lib/cpufreq-fake-sysfs.sh */
+	char path_to_cpu[SYSFS_PATH_MAX];
+
+	struct {
+		pthread_mutex_t lock;		/* for changes, not for lookups */
+		unsigned int max_fds;
+		unsigned int nr_entries;
+		unsigned int hash_size;
+		struct sysfs_fd_entry **hash;
+		struct sysfs_fd_entry *all;	/* every entry allocated */
+		struct sysfs_fd_entry *free;	/* those without a file */
+		struct sysfs_fd_entry *clock;	/* the next to sweep */
+	} fd_cache;
+
+	struct {
+		int mode;
+		unsigned long elided;
+		struct sysfs_elide_entry *cache;	/* per CPU, CPUFREQ_ELIDE_CACHED only */
+	} write_elision;
+
+	/* first CPU of the policy of each CPU, plus one; 0 if not known yet */
+	unsigned int policy_of[CPUFREQ_MAX_CPUS];
+	/* by first CPU of the policy modulo SYSFS_POLICY_LOCKS; no one
+	 * holds two at once, so policies sharing one only wait longer */
+	pthread_mutex_t policy_lock[SYSFS_POLICY_LOCKS];
+
+	struct {
+		pthread_mutex_t lock;
+		int online_fd;			/* kept open to poll for changes */
+		unsigned long generation;
+		struct sysfs_topology *current;
+	} topology;
+
+	/* values published by cpufreq-publish, NULL if not wanted */
+	struct sysfs_shm_reader *shm;
+
+	/* counters of file accesses, NULL unless enabled */
+	struct sysfs_lib_stats *lib_stats;
+
+	/* how snapshots read the current frequency, CPUFREQ_CUR_* */
+	int cur_freq_mode;
+};
+
+static struct cpufreq_ctx default_ctx;
+static pthread_once_t default_ctx_once = PTHREAD_ONCE_INIT;
+
+static void sysfs_fd_cache_flush(struct cpufreq_ctx *ctx);
+static void sysfs_topology_flush(struct cpufreq_ctx *ctx);
+static unsigned int sysfs_policy_of(struct cpufreq_ctx *ctx, unsigned int cpu);
+
+int sysfs_set_root(struct cpufreq_ctx *ctx, const char *root)
 {
-	char path[SYSFS_PATH_MAX];
-	int fd;
-	size_t numread;
+	size_t len;
 
-	snprintf(path, sizeof(path), PATH_TO_CPU "cpu%u/cpufreq/%s",
-			 cpu, fname);
+	if (!root)
+		root = SYSFS_DEFAULT_ROOT;
 
-	if ( ( fd = open(path, O_RDONLY) ) == -1 )
+	len = strlen(root);
+	while (len > 1 && root[len - 1] == '/')
+		len--;
+
+	if (len + sizeof(PATH_TO_CPU) + 32 > SYSFS_PATH_MAX)
+		return -ENAMETOOLONG;
+
+	memcpy(ctx->path_to_cpu, root, len);
+	strcpy(ctx->path_to_cpu + len, PATH_TO_CPU);
+
+	sysfs_fd_cache_flush(ctx);
+	sysfs_topology_flush(ctx);
+	memset(ctx->policy_of, 0, sizeof(ctx->policy_of));
+	if (ctx->shm)
+		sysfs_shm_reader_flush(ctx->shm);
+
+	return 0;
+}
+
+const char * sysfs_path_to_cpu(struct cpufreq_ctx *ctx)
+{
+	return ctx->path_to_cpu;
+}
+
+int sysfs_set_lib_stats(struct cpufreq_ctx *ctx, int enable)
+{
+	sysfs_lib_stats_free(ctx->lib_stats);
+	ctx->lib_stats = NULL;
+	if (!enable)
 		return 0;
 
-	numread = read(fd, buf, buflen - 1);
-	if ( numread < 1 )
-	{
-		close(fd);
+	ctx->lib_stats = sysfs_lib_stats_alloc();
+	return ctx->lib_stats ? 0 : -ENOMEM;
+}
+
+int sysfs_get_lib_stats(struct cpufreq_ctx *ctx, struct cpufreq_lib_stats *stats)
+{
+	if (!ctx->lib_stats)
+		return -ENODATA;
+
+	sysfs_lib_stats_copy(ctx->lib_stats, stats);
+	return 0;
+}
+
+int sysfs_set_shm(struct cpufreq_ctx *ctx, const char *name)
+{
+	sysfs_shm_reader_close(ctx->shm);
+	ctx->shm = NULL;
+	if (!name)
 		return 0;
-	}
 
-	buf[numread] = '\0';
-	close(fd);
+	ctx->shm = sysfs_shm_reader_open(name);
+	return ctx->shm ? 0 : -EINVAL;
+}
 
-	return numread;
+static int sysfs_ctx_init(struct cpufreq_ctx *ctx, const char *root)
+{
+	const char *shm;
+	unsigned int i;
+	int ret;
+
+	pthread_mutex_init(&ctx->fd_cache.lock, NULL);
+	for (i = 0; i < SYSFS_POLICY_LOCKS; i++)
+		pthread_mutex_init(&ctx->policy_lock[i], NULL);
+	pthread_mutex_init(&ctx->topology.lock, NULL);
+	ctx->topology.online_fd = -1;
+	ctx->cur_freq_mode = CPUFREQ_CUR_HARDWARE;
+
+	/* a publisher is used if there is one; an empty name turns that off */
+	shm = getenv(SYSFS_SHM_ENV);
+	ctx->shm = sysfs_shm_reader_open(shm ? shm : SYSFS_SHM_DEFAULT);
+
+	/* without an explicit root, the environment may name one */
+	ret = sysfs_set_root(ctx, root ? root : getenv(SYSFS_ROOT_ENV));
+	if (ret && !root)
+		ret = sysfs_set_root(ctx, NULL);
+
+	return ret;
 }
 
-/* helper function to write a new value to a /sys file */
-/* fname is a relative path under "cpuX/cpufreq" dir */
-unsigned int sysfs_write_file(unsigned int cpu, const char *fname, const char *value, size_t len)
+static void sysfs_default_ctx_init(void)
 {
-	char path[SYSFS_PATH_MAX];
-	int fd;
-	size_t numwrite;
+	sysfs_ctx_init(&default_ctx, NULL);
+}
 
-	snprintf(path, sizeof(path), PATH_TO_CPU "cpu%u/cpufreq/%s",
-			 cpu, fname);
+struct cpufreq_ctx * sysfs_default_ctx(void)
+{
+	pthread_once(&default_ctx_once, sysfs_default_ctx_init);
+	return &default_ctx;
+}
 
-	if ( ( fd = open(path, O_WRONLY) ) == -1 )
-		return 0;
+struct cpufreq_ctx * sysfs_ctx_open(const char *root)
+{
+	struct cpufreq_ctx *ctx;
 
-	numwrite = write(fd, value, len);
-	if ( numwrite < 1 )
-	{
-		close(fd);
-		return 0;
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+
+	if (sysfs_ctx_init(ctx, root)) {
+		sysfs_ctx_close(ctx);
+		return NULL;
 	}
 
-	close(fd);
+	return ctx;
+}
 
-	return numwrite;
+void sysfs_ctx_close(struct cpufreq_ctx *ctx)
+{
+	unsigned int i;
+
+	if (ctx == &default_ctx)
+		return;
+
+	sysfs_fd_cache_disable(ctx);
+	sysfs_topology_flush(ctx);
+	sysfs_shm_reader_close(ctx->shm);
+	sysfs_lib_stats_free(ctx->lib_stats);
+	free(ctx->write_elision.cache);
+
+	pthread_mutex_destroy(&ctx->fd_cache.lock);
+	for (i = 0; i < SYSFS_POLICY_LOCKS; i++)
+		pthread_mutex_destroy(&ctx->policy_lock[i]);
+	pthread_mutex_destroy(&ctx->topology.lock);
+	free(ctx);
 }
 
-/* read access to files which contain one numeric value */
+/* path of a file below "cpuX/cpufreq", or "cpufreq/policyN" if cpu is
+ * CPUFREQ_POLICY(N) */
+int sysfs_cpufreq_path(struct cpufreq_ctx *ctx, char *path, size_t len,
+		       unsigned int cpu, const char *fname)
+{
+	int ret;
 
-enum {
-	CPUINFO_CUR_FREQ,
-	CPUINFO_MIN_FREQ,
-	CPUINFO_MAX_FREQ,
-	CPUINFO_LATENCY,
-	SCALING_CUR_FREQ,
-	SCALING_MIN_FREQ,
-	SCALING_MAX_FREQ,
-	STATS_NUM_TRANSITIONS,
-	MAX_VALUE_FILES
-};
+	if (cpufreq_is_policy(cpu))
+		ret = snprintf(path, len, "%scpufreq/policy%u/%s",
+			       ctx->path_to_cpu, cpufreq_policy_nr(cpu), fname);
+	else
+		ret = snprintf(path, len, "%scpu%u/cpufreq/%s",
+			       ctx->path_to_cpu, cpu, fname);
+	if (ret < 0 || (size_t) ret >= len)
+		return -ENAMETOOLONG;
 
-static const char *value_files[MAX_VALUE_FILES] = {
-	[CPUINFO_CUR_FREQ] = "cpuinfo_cur_freq",
-	[CPUINFO_MIN_FREQ] = "cpuinfo_min_freq",
-	[CPUINFO_MAX_FREQ] = "cpuinfo_max_freq",
-	[CPUINFO_LATENCY]  = "cpuinfo_transition_latency",
-	[SCALING_CUR_FREQ] = "scaling_cur_freq",
-	[SCALING_MIN_FREQ] = "scaling_min_freq",
-	[SCALING_MAX_FREQ] = "scaling_max_freq",
-	[STATS_NUM_TRANSITIONS] = "stats/total_trans"
+	return 0;
+}
+
+/* optional cache of open sysfs files
+ *
+ * If enabled, files read by sysfs_read_file() are kept open and re-read
+ * using pread() at offset 0, which makes sysfs call the show() method
+ * again. Entries are hashed by (cpu, fname). Once max_fds files are
+ * open, a clock sweep closes one which wasn't used since the sweep last
+ * passed it. No process may have more than SYSFS_FD_CACHE_MAX files
+ * open anyway.
+ *
+ * Looking up and reading a cached file takes no lock. Entries are only
+ * ever reused, and freed when the cache is disabled, so a reader may
+ * look at any entry it reached through the hash, even one dropped
+ * meanwhile. It compares the key, takes a reference, which fails once
+ * the last one is gone, and then checks that seq didn't change, i.e.
+ * that the entry wasn't refilled for another file before it got its
+ * reference. The last reference closes the file. The lock serializes
+ * inserting and dropping entries.
+ */
+
+struct sysfs_fd_entry {
+	unsigned int seq;		/* odd while the entry is refilled */
+	unsigned int refs;		/* readers, plus one while hashed */
+	unsigned int cpu;
+	int fd;
+	unsigned char hashed;		/* under the lock only */
+	unsigned char used;		/* since the clock last passed */
+	char fname[SYSFS_FNAME_MAX];
+	struct sysfs_fd_entry *hash_next;
+	struct sysfs_fd_entry *free_next;
+	struct sysfs_fd_entry *all_next;
 };
 
+static unsigned int sysfs_fd_hash(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname)
+{
+	unsigned int hash = cpu * 2654435761U;
+
+	while (*fname)
+		hash = (hash * 31) + (unsigned char) *fname++;
+
+	return hash & (ctx->fd_cache.hash_size - 1);
+}
 
-static unsigned long sysfs_get_one_value(unsigned int cpu, unsigned int which)
+/* called with the lock held */
+static void sysfs_fd_free(struct cpufreq_ctx *ctx, struct sysfs_fd_entry *entry)
 {
- 	unsigned long value;
-	unsigned int len;
-	char linebuf[MAX_LINE_LEN];
-	char *endp;
+	close(entry->fd);
+	entry->free_next = ctx->fd_cache.free;
+	ctx->fd_cache.free = entry;
+}
 
-	if ( which >= MAX_VALUE_FILES )
-		return 0;
+static void sysfs_fd_put(struct cpufreq_ctx *ctx, struct sysfs_fd_entry *entry)
+{
+	if (__atomic_sub_fetch(&entry->refs, 1, __ATOMIC_ACQ_REL))
+		return;
 
-	if ( ( len = sysfs_read_file(cpu, value_files[which], linebuf, sizeof(linebuf))) == 0 )
-	{
-		return 0;
-	}
+	pthread_mutex_lock(&ctx->fd_cache.lock);
+	sysfs_fd_free(ctx, entry);
+	pthread_mutex_unlock(&ctx->fd_cache.lock);
+}
+
+/* called with the lock held */
+static void sysfs_fd_drop(struct cpufreq_ctx *ctx, struct sysfs_fd_entry *entry)
+{
+	struct sysfs_fd_entry **pp;
+
+	pp = &ctx->fd_cache.hash[sysfs_fd_hash(ctx, entry->cpu, entry->fname)];
+	while (*pp != entry)
+		pp = &(*pp)->hash_next;
+	/* readers at entry still get to the rest of the chain */
+	__atomic_store_n(pp, entry->hash_next, __ATOMIC_RELEASE);
+	entry->hashed = 0;
+
+	if (!__atomic_sub_fetch(&entry->refs, 1, __ATOMIC_ACQ_REL))
+		sysfs_fd_free(ctx, entry);
+}
 
-	value = strtoul(linebuf, &endp, 0);
+/* the key may be changing while it is compared, which seq tells
+ * afterwards; so it is read, and written, only by atomic accesses */
+static int sysfs_fd_key_is(struct sysfs_fd_entry *entry, unsigned int cpu, const char *fname)
+{
+	unsigned int i;
+	char c;
 
-	if ( endp == linebuf || errno == ERANGE )
+	if (__atomic_load_n(&entry->cpu, __ATOMIC_RELAXED) != cpu)
 		return 0;
+	for (i = 0; i < SYSFS_FNAME_MAX; i++) {
+		c = __atomic_load_n(&entry->fname[i], __ATOMIC_RELAXED);
+		if (c != fname[i])
+			return 0;
+		if (!c)
+			return 1;
+	}
+	return 0;
+}
 
-	return value;
+static void sysfs_fd_set_key(struct sysfs_fd_entry *entry, unsigned int cpu, const char *fname)
+{
+	unsigned int i = 0;
+
+	__atomic_store_n(&entry->cpu, cpu, __ATOMIC_RELAXED);
+	do
+		__atomic_store_n(&entry->fname[i], fname[i], __ATOMIC_RELAXED);
+	while (fname[i++]);
 }
 
-/* read access to files which contain one string */
+/* the entry of (cpu, fname) with a reference taken, or NULL; without
+ * the lock */
+static struct sysfs_fd_entry * sysfs_fd_get(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname)
+{
+	struct sysfs_fd_entry *entry;
+	unsigned int seq, refs, steps = 0;
+
+	entry = __atomic_load_n(&ctx->fd_cache.hash[sysfs_fd_hash(ctx, cpu, fname)],
+				__ATOMIC_ACQUIRE);
+	/* an entry refilled under us leads into another chain, maybe
+	 * back into this one; that's a miss, not an endless walk */
+	for (; entry && steps < ctx->fd_cache.max_fds; steps++) {
+		seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+		if ((seq & 1) || !sysfs_fd_key_is(entry, cpu, fname)) {
+			entry = __atomic_load_n(&entry->hash_next, __ATOMIC_ACQUIRE);
+			continue;
+		}
 
-enum {
-	SCALING_DRIVER,
-	SCALING_GOVERNOR,
-	MAX_STRING_FILES
-};
+		refs = __atomic_load_n(&entry->refs, __ATOMIC_RELAXED);
+		do {
+			if (!refs)
+				return NULL;	/* dropped meanwhile */
+		} while (!__atomic_compare_exchange_n(&entry->refs, &refs, refs + 1, 1,
+						      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+		if (__atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) != seq) {
+			sysfs_fd_put(ctx, entry);
+			return NULL;
+		}
 
-static const char *string_files[MAX_STRING_FILES] = {
-	[SCALING_DRIVER] = "scaling_driver",
-	[SCALING_GOVERNOR] = "scaling_governor",
-};
+		if (!__atomic_load_n(&entry->used, __ATOMIC_RELAXED))
+			__atomic_store_n(&entry->used, 1, __ATOMIC_RELAXED);
+		return entry;
+	}
+	return NULL;
+}
 
+/* called with the lock held: a free entry, allocating one until there
+ * are max_fds, and then sweeping one out */
+static struct sysfs_fd_entry * sysfs_fd_alloc(struct cpufreq_ctx *ctx)
+{
+	struct sysfs_fd_entry *entry;
+	unsigned int i;
+
+	if (!ctx->fd_cache.free && ctx->fd_cache.nr_entries < ctx->fd_cache.max_fds) {
+		entry = calloc(1, sizeof(*entry));
+		if (!entry)
+			return NULL;
+		entry->all_next = ctx->fd_cache.all;
+		ctx->fd_cache.all = entry;
+		ctx->fd_cache.nr_entries++;
+		return entry;
+	}
+
+	/* twice round, as the first may only clear the used marks; an
+	 * entry still being read is freed by its last reader */
+	for (i = 0; !ctx->fd_cache.free && i < 2 * ctx->fd_cache.nr_entries; i++) {
+		entry = ctx->fd_cache.clock ? ctx->fd_cache.clock : ctx->fd_cache.all;
+		ctx->fd_cache.clock = entry->all_next;
+		if (!entry->hashed ||
+		    __atomic_exchange_n(&entry->used, 0, __ATOMIC_RELAXED))
+			continue;
+		sysfs_fd_drop(ctx, entry);
+	}
+
+	entry = ctx->fd_cache.free;
+	if (entry)
+		ctx->fd_cache.free = entry->free_next;
+	return entry;
+}
 
-static char * sysfs_get_one_string(unsigned int cpu, unsigned int which)
+/* called with the lock held; returns NULL if fd wasn't taken over */
+static struct sysfs_fd_entry * sysfs_fd_insert(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname, int fd)
 {
-	char linebuf[MAX_LINE_LEN];
-	char *result;
-	unsigned int len;
+	struct sysfs_fd_entry *entry, **head;
 
-	if (which >= MAX_STRING_FILES)
+	if (strlen(fname) >= SYSFS_FNAME_MAX)
 		return NULL;
 
-	if ( ( len = sysfs_read_file(cpu, string_files[which], linebuf, sizeof(linebuf))) == 0 )
-	{
-		return NULL;
-	}
+	/* another thread may have been faster */
+	head = &ctx->fd_cache.hash[sysfs_fd_hash(ctx, cpu, fname)];
+	for (entry = *head; entry; entry = entry->hash_next)
+		if (entry->cpu == cpu && !strcmp(entry->fname, fname))
+			return NULL;
 
-	if ( ( result = strdup(linebuf) ) == NULL )
+	entry = sysfs_fd_alloc(ctx);
+	if (!entry)
 		return NULL;
 
-	if (result[strlen(result) - 1] == '\n')
-		result[strlen(result) - 1] = '\0';
+	__atomic_store_n(&entry->seq, entry->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	sysfs_fd_set_key(entry, cpu, fname);
+	entry->fd = fd;
+	entry->hashed = 1;
+	entry->used = 1;
+	__atomic_store_n(&entry->refs, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->hash_next, *head, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->seq, entry->seq + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(head, entry, __ATOMIC_RELEASE);
+
+	return entry;
+}
 
-	return result;
+/* called with the lock held */
+static void sysfs_fd_drop_cpu(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	struct sysfs_fd_entry *entry;
+
+	for (entry = ctx->fd_cache.all; entry; entry = entry->all_next)
+		if (entry->hashed && entry->cpu == cpu)
+			sysfs_fd_drop(ctx, entry);
 }
 
-/* write access */
+static void sysfs_fd_cache_flush(struct cpufreq_ctx *ctx)
+{
+	struct sysfs_fd_entry *entry;
 
-enum {
-	WRITE_SCALING_MIN_FREQ,
-	WRITE_SCALING_MAX_FREQ,
-	WRITE_SCALING_GOVERNOR,
-	WRITE_SCALING_SET_SPEED,
-	MAX_WRITE_FILES
-};
+	pthread_mutex_lock(&ctx->fd_cache.lock);
+	for (entry = ctx->fd_cache.all; entry; entry = entry->all_next)
+		if (entry->hashed)
+			sysfs_fd_drop(ctx, entry);
+	pthread_mutex_unlock(&ctx->fd_cache.lock);
+}
 
-static const char *write_files[MAX_VALUE_FILES] = {
-	[WRITE_SCALING_MIN_FREQ] = "scaling_min_freq",
-	[WRITE_SCALING_MAX_FREQ] = "scaling_max_freq",
-	[WRITE_SCALING_GOVERNOR] = "scaling_governor",
-	[WRITE_SCALING_SET_SPEED] = "scaling_setspeed",
-};
+void sysfs_fd_cache_disable(struct cpufreq_ctx *ctx)
+{
+	struct sysfs_fd_entry *entry, *next;
 
-static int sysfs_write_one_value(unsigned int cpu, unsigned int which,
-				 const char *new_value, size_t len)
+	/* a setting: no one else may be reading, so all are free then */
+	sysfs_fd_cache_flush(ctx);
+
+	for (entry = ctx->fd_cache.all; entry; entry = next) {
+		next = entry->all_next;
+		free(entry);
+	}
+	ctx->fd_cache.all = NULL;
+	ctx->fd_cache.free = NULL;
+	ctx->fd_cache.clock = NULL;
+	ctx->fd_cache.nr_entries = 0;
+
+	free(ctx->fd_cache.hash);
+	ctx->fd_cache.hash = NULL;
+	ctx->fd_cache.hash_size = 0;
+	ctx->fd_cache.max_fds = 0;
+}
+
+int sysfs_fd_cache_enable(struct cpufreq_ctx *ctx, unsigned int max_fds)
 {
-	if (which >= MAX_WRITE_FILES)
-		return 0;
+	unsigned int hash_size = 1;
 
-	if ( sysfs_write_file(cpu, write_files[which], new_value, len) != len )
-		return -ENODEV;
+	if (!max_fds)
+		return -EINVAL;
+	if (max_fds > SYSFS_FD_CACHE_MAX)
+		max_fds = SYSFS_FD_CACHE_MAX;
+
+	sysfs_fd_cache_disable(ctx);
+
+	while (hash_size < max_fds * 2)
+		hash_size <<= 1;
+
+	ctx->fd_cache.hash = calloc(hash_size, sizeof(*ctx->fd_cache.hash));
+	if (!ctx->fd_cache.hash)
+		return -ENOMEM;
+
+	ctx->fd_cache.hash_size = hash_size;
+	ctx->fd_cache.max_fds = max_fds;
 
 	return 0;
-};
+}
+
+void sysfs_fd_cache_invalidate(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	if (!ctx->fd_cache.max_fds)
+		return;
 
+	pthread_mutex_lock(&ctx->fd_cache.lock);
+	sysfs_fd_drop_cpu(ctx, cpu);
+	pthread_mutex_unlock(&ctx->fd_cache.lock);
+}
 
-int sysfs_cpu_exists(unsigned int cpu)
+/* helper function to read file from /sys into given buffer */
+/* fname is a relative path under "cpuX/cpufreq" dir */
+static unsigned int sysfs_read_raw(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname,
+				   char *buf, size_t buflen, unsigned int *syscalls)
 {
-	char file[SYSFS_PATH_MAX];
-	struct stat statbuf;
+	char path[SYSFS_PATH_MAX];
+	struct sysfs_fd_entry *entry = NULL;
+	int fd;
+	ssize_t numread;
+
+	if (ctx->fd_cache.max_fds)
+		entry = sysfs_fd_get(ctx, cpu, fname);
+
+	if (entry) {
+		numread = pread(entry->fd, buf, buflen - 1, 0);
+		(*syscalls)++;
+
+		/* the CPU went offline or the driver was unloaded:
+		 * forget about all files of this CPU and try again */
+		if (numread <= 0) {
+			pthread_mutex_lock(&ctx->fd_cache.lock);
+			if (entry->hashed)
+				sysfs_fd_drop_cpu(ctx, cpu);
+			pthread_mutex_unlock(&ctx->fd_cache.lock);
+		}
+		sysfs_fd_put(ctx, entry);
 
-	snprintf(file, SYSFS_PATH_MAX, PATH_TO_CPU "cpu%u/", cpu);
+		if (numread > 0) {
+			buf[numread] = '\0';
+			return numread;
+		}
+	}
 
-	if ( stat(file, &statbuf) != 0 )
-		return -ENOSYS;
+	if (sysfs_cpufreq_path(ctx, path, sizeof(path), cpu, fname))
+		return 0;
 
-	return S_ISDIR(statbuf.st_mode) ? 0 : -ENOSYS;
-}
+	(*syscalls)++;
+	if ( ( fd = open(path, O_RDONLY) ) == -1 )
+		return 0;
+
+	*syscalls += 2;
+	numread = read(fd, buf, buflen - 1);
+	if ( numread < 1 )
+	{
+		close(fd);
+		return 0;
+	}
 
+	buf[numread] = '\0';
 
-unsigned long sysfs_get_freq_kernel(unsigned int cpu)
-{
-	return sysfs_get_one_value(cpu, SCALING_CUR_FREQ);
+	if (ctx->fd_cache.max_fds) {
+		pthread_mutex_lock(&ctx->fd_cache.lock);
+		entry = sysfs_fd_insert(ctx, cpu, fname, fd);
+		pthread_mutex_unlock(&ctx->fd_cache.lock);
+	}
+	if (!entry)
+		close(fd);
+	else
+		(*syscalls)--;
+
+	return numread;
 }
 
-unsigned long sysfs_get_freq_hardware(unsigned int cpu)
+/* the same, counted if the context keeps lib stats */
+static unsigned int sysfs_read_kernel(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname,
+				      char *buf, size_t buflen)
 {
-	return sysfs_get_one_value(cpu, CPUINFO_CUR_FREQ);
+	unsigned long long start;
+	unsigned int len, syscalls = 0;
+
+	if (!ctx->lib_stats)
+		return sysfs_read_raw(ctx, cpu, fname, buf, buflen, &syscalls);
+
+	start = sysfs_lib_stats_now();
+	len = sysfs_read_raw(ctx, cpu, fname, buf, buflen, &syscalls);
+	sysfs_lib_stats_account(ctx->lib_stats, fname, 0, sysfs_lib_stats_now() - start,
+				len, syscalls);
+	return len;
 }
 
-unsigned long sysfs_get_transition_latency(unsigned int cpu)
+/* the same, but from the segment of a publisher if one is alive */
+unsigned int sysfs_read_file(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname, char *buf, size_t buflen)
 {
-	return sysfs_get_one_value(cpu, CPUINFO_LATENCY);
+	unsigned int len;
+
+	if (ctx->shm) {
+		len = sysfs_shm_read(ctx->shm, ctx->path_to_cpu, cpu, fname, buf, buflen);
+		if (len) {
+			if (ctx->lib_stats)
+				sysfs_lib_stats_shm(ctx->lib_stats, fname);
+			return len;
+		}
+	}
+
+	return sysfs_read_kernel(ctx, cpu, fname, buf, buflen);
 }
 
-int sysfs_get_hardware_limits(unsigned int cpu,
-			      unsigned long *min,
-			      unsigned long *max)
+/* streaming reads
+ *
+ * sysfs_read_file() reads a file with one read() into the caller's
+ * buffer, and cuts off what doesn't fit. A stream instead reads files
+ * of any length through the small window in struct sysfs_stream, and
+ * hands them out line by line, so that parsers can work on one line
+ * at a time. Lines must fit into the window.
+ */
+
+int sysfs_stream_open(struct sysfs_stream *stream, struct cpufreq_ctx *ctx,
+		      unsigned int cpu, const char *fname)
 {
-	if ((!min) || (!max))
-		return -EINVAL;
+	char path[SYSFS_PATH_MAX];
+	unsigned int len;
 
-	*min = sysfs_get_one_value(cpu, CPUINFO_MIN_FREQ);
-	if (!*min)
-		return -ENODEV;
+	memset(stream, 0, offsetof(struct sysfs_stream, buf));
+	stream->ctx = ctx;
+	stream->cpu = cpu;
+	stream->fname = fname;
+	stream->fd = -1;
+
+	if (ctx->shm) {
+		len = sysfs_shm_read(ctx->shm, ctx->path_to_cpu, cpu, fname, stream->buf,
+				     sizeof(stream->buf));
+		if (len) {
+			if (ctx->lib_stats)
+				sysfs_lib_stats_shm(ctx->lib_stats, fname);
+			stream->end = len;
+			stream->eof = 1;
+			return 0;
+		}
+	}
 
-	*max = sysfs_get_one_value(cpu, CPUINFO_MAX_FREQ);
-	if (!*max)
+	if (ctx->lib_stats)
+		stream->start_ns = sysfs_lib_stats_now();
+
+	if (ctx->fd_cache.max_fds) {
+		stream->entry = sysfs_fd_get(ctx, cpu, fname);
+		if (stream->entry) {
+			stream->fd = stream->entry->fd;
+			return 0;
+		}
+	}
+
+	if (sysfs_cpufreq_path(ctx, path, sizeof(path), cpu, fname))
 		return -ENODEV;
 
+	stream->syscalls++;
+	stream->fd = open(path, O_RDONLY);
+	if (stream->fd < 0) {
+		stream->error = -errno;
+		sysfs_stream_close(stream);
+		return -ENODEV;
+	}
 	return 0;
 }
 
-char * sysfs_get_driver(unsigned int cpu) {
-	return sysfs_get_one_string(cpu, SCALING_DRIVER);
+/* an attribute is shown as one record, which sysfs hands out as far as
+ * there is room; so a short read is the end of it, and saves reading
+ * again to see that */
+static void sysfs_stream_fill(struct sysfs_stream *stream)
+{
+	size_t room;
+	ssize_t numread;
+
+	memmove(stream->buf, stream->buf + stream->start, stream->end - stream->start);
+	stream->end -= stream->start;
+	stream->start = 0;
+
+	room = sizeof(stream->buf) - stream->end;
+	numread = pread(stream->fd, stream->buf + stream->end, room, stream->offset);
+	stream->syscalls++;
+	if (numread < 0)
+		stream->error = -errno;
+	if (numread < (ssize_t) room)
+		stream->eof = 1;
+	if (numread <= 0)
+		return;
+	stream->offset += numread;
+	stream->end += numread;
 }
 
-struct cpufreq_policy * sysfs_get_policy(unsigned int cpu) {
-	struct cpufreq_policy *policy;
-
-	policy = malloc(sizeof(struct cpufreq_policy));
+/* the next line, without its '\n', or NULL at the end of the file or on
+ * errors; valid until the next call */
+const char * sysfs_stream_line(struct sysfs_stream *stream, unsigned int *len)
+{
+	char *line, *eol;
+
+	for (;;) {
+		line = stream->buf + stream->start;
+		eol = memchr(line, '\n', stream->end - stream->start);
+		if (eol) {
+			*len = eol - line;
+			stream->start += *len + 1;
+			return line;
+		}
+		if (stream->eof || stream->error)
+			break;
+		if (stream->start == 0 && stream->end == sizeof(stream->buf)) {
+			/* too long a line */
+			stream->error = -EOVERFLOW;
+			return NULL;
+		}
+		sysfs_stream_fill(stream);
+	}
+
+	/* the last line may lack its '\n' */
+	if (stream->error || stream->start == stream->end)
+		return NULL;
+	*len = stream->end - stream->start;
+	stream->start = stream->end;
+	return line;
+}
+
+/* returns 0 if the whole file could be read, else the negative error */
+int sysfs_stream_close(struct sysfs_stream *stream)
+{
+	struct cpufreq_ctx *ctx = stream->ctx;
+	struct sysfs_fd_entry *entry = stream->entry;
+
+	if (entry) {
+		/* see sysfs_read_raw() */
+		if (stream->error) {
+			pthread_mutex_lock(&ctx->fd_cache.lock);
+			if (entry->hashed)
+				sysfs_fd_drop_cpu(ctx, stream->cpu);
+			pthread_mutex_unlock(&ctx->fd_cache.lock);
+		}
+		sysfs_fd_put(ctx, entry);
+	} else if (stream->fd >= 0) {
+		if (!stream->error && ctx->fd_cache.max_fds) {
+			pthread_mutex_lock(&ctx->fd_cache.lock);
+			entry = sysfs_fd_insert(ctx, stream->cpu, stream->fname, stream->fd);
+			pthread_mutex_unlock(&ctx->fd_cache.lock);
+		}
+		if (!entry) {
+			close(stream->fd);
+			stream->syscalls++;
+		}
+	}
+
+	if (ctx->lib_stats && stream->syscalls)
+		sysfs_lib_stats_account(ctx->lib_stats, stream->fname, 0,
+					sysfs_lib_stats_now() - stream->start_ns,
+					stream->error ? 0 : stream->offset, stream->syscalls);
+
+	if (stream->error)
+		return stream->error;
+	return stream->eof ? 0 : -EIO;
+}
+
+/* helper function to write a new value to a /sys file */
+/* fname is a relative path under "cpuX/cpufreq" dir */
+static unsigned int sysfs_write_raw(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname,
+				    const char *value, size_t len, unsigned int *syscalls)
+{
+	char path[SYSFS_PATH_MAX];
+	int fd;
+	ssize_t numwrite;
+
+	if (sysfs_cpufreq_path(ctx, path, sizeof(path), cpu, fname))
+		return 0;
+
+	(*syscalls)++;
+	if ( ( fd = open(path, O_WRONLY) ) == -1 )
+		return 0;
+
+	*syscalls += 2;
+	numwrite = write(fd, value, len);
+	if ( numwrite < 1 )
+	{
+		close(fd);
+		return 0;
+	}
+
+	close(fd);
+
+	return numwrite;
+}
+
+unsigned int sysfs_write_file(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname, const char *value, size_t len)
+{
+	unsigned long long start = 0;
+	unsigned int numwrite, syscalls = 0;
+
+	if (ctx->lib_stats)
+		start = sysfs_lib_stats_now();
+	numwrite = sysfs_write_raw(ctx, cpu, fname, value, len, &syscalls);
+	if (ctx->lib_stats)
+		sysfs_lib_stats_account(ctx->lib_stats, fname, 1, sysfs_lib_stats_now() - start,
+					numwrite == len ? numwrite : 0, syscalls);
+
+	/* published values don't show this yet */
+	if (numwrite && ctx->shm)
+		sysfs_shm_written(ctx->shm);
+
+	return numwrite;
+}
+
+/* memory for results
+ *
+ * Comes from the caller's arena if one is passed, else from malloc().
+ * Arena memory is only given back by cpufreq_arena_reset(), except for
+ * the most recent allocation, which sysfs_free() can roll back, and all
+ * allocations since sysfs_arena_mark(), which sysfs_arena_rollback()
+ * gives back.
+ */
+
+#define SYSFS_ARENA_ALIGN 16
+
+static void * sysfs_alloc(struct cpufreq_arena *arena, size_t size)
+{
+	uintptr_t base, start;
+
+	if (!arena)
+		return malloc(size);
+
+	base = (uintptr_t) arena->base;
+	start = (base + arena->used + SYSFS_ARENA_ALIGN - 1) & ~(uintptr_t) (SYSFS_ARENA_ALIGN - 1);
+	if (start - base > arena->size || size > arena->size - (start - base)) {
+		arena->nr_failed++;
+		return NULL;
+	}
+
+	arena->last = arena->used;
+	arena->used = start - base + size;
+	arena->nr_allocs++;
+
+	return (void *) start;
+}
+
+static void sysfs_free(struct cpufreq_arena *arena, void *ptr)
+{
+	uintptr_t start;
+
+	if (!arena) {
+		free(ptr);
+		return;
+	}
+
+	start = ((uintptr_t) arena->base + arena->last + SYSFS_ARENA_ALIGN - 1) &
+		~(uintptr_t) (SYSFS_ARENA_ALIGN - 1);
+	if ((uintptr_t) ptr == start) {
+		arena->used = arena->last;
+		arena->nr_allocs--;
+	}
+}
+
+static void sysfs_arena_mark(const struct cpufreq_arena *arena, struct cpufreq_arena *mark)
+{
+	if (arena)
+		*mark = *arena;
+}
+
+static void sysfs_arena_rollback(struct cpufreq_arena *arena, const struct cpufreq_arena *mark)
+{
+	arena->used = mark->used;
+	arena->last = mark->last;
+	arena->nr_allocs = mark->nr_allocs;
+}
+
+/* read access to files which contain one numeric value */
+
+enum {
+	CPUINFO_CUR_FREQ,
+	CPUINFO_MIN_FREQ,
+	CPUINFO_MAX_FREQ,
+	CPUINFO_LATENCY,
+	SCALING_CUR_FREQ,
+	SCALING_MIN_FREQ,
+	SCALING_MAX_FREQ,
+	STATS_NUM_TRANSITIONS,
+	SCALING_SET_SPEED,
+	BASE_FREQUENCY,
+	MAX_VALUE_FILES
+};
+
+static const char *value_files[MAX_VALUE_FILES] = {
+	[CPUINFO_CUR_FREQ] = "cpuinfo_cur_freq",
+	[CPUINFO_MIN_FREQ] = "cpuinfo_min_freq",
+	[CPUINFO_MAX_FREQ] = "cpuinfo_max_freq",
+	[CPUINFO_LATENCY]  = "cpuinfo_transition_latency",
+	[SCALING_CUR_FREQ] = "scaling_cur_freq",
+	[SCALING_MIN_FREQ] = "scaling_min_freq",
+	[SCALING_MAX_FREQ] = "scaling_max_freq",
+	[STATS_NUM_TRANSITIONS] = "stats/total_trans",
+	[SCALING_SET_SPEED] = "scaling_setspeed",
+	[BASE_FREQUENCY] = "base_frequency",
+};
+
+
+/* from_kernel skips the segment of a publisher */
+static unsigned long sysfs_get_value(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+				     int from_kernel)
+{
+	unsigned long long value;
+	unsigned int len;
+	char linebuf[MAX_LINE_LEN];
+	const char *pos = linebuf;
+
+	if ( which >= MAX_VALUE_FILES )
+		return 0;
+
+	if (from_kernel)
+		len = sysfs_read_kernel(ctx, cpu, value_files[which], linebuf, sizeof(linebuf));
+	else
+		len = sysfs_read_file(ctx, cpu, value_files[which], linebuf, sizeof(linebuf));
+	if ( len == 0 )
+	{
+		return 0;
+	}
+
+	if ( sysfs_parse_number(&pos, linebuf + len, &value) || value > ULONG_MAX )
+		return 0;
+
+	return value;
+}
+
+static unsigned long sysfs_get_one_value(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which)
+{
+	return sysfs_get_value(ctx, cpu, which, 0);
+}
+
+/* read access to files which contain one string */
+
+enum {
+	SCALING_DRIVER,
+	SCALING_GOVERNOR,
+	MAX_STRING_FILES
+};
+
+static const char *string_files[MAX_STRING_FILES] = {
+	[SCALING_DRIVER] = "scaling_driver",
+	[SCALING_GOVERNOR] = "scaling_governor",
+};
+
+
+static char * sysfs_get_one_string(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+				   struct cpufreq_arena *arena)
+{
+	char linebuf[MAX_LINE_LEN];
+	char *result;
+	unsigned int len;
+
+	if (which >= MAX_STRING_FILES)
+		return NULL;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, string_files[which], linebuf, sizeof(linebuf))) == 0 )
+	{
+		return NULL;
+	}
+
+	if (linebuf[len - 1] == '\n')
+		linebuf[--len] = '\0';
+
+	if ( ( result = sysfs_alloc(arena, len + 1) ) == NULL )
+		return NULL;
+
+	memcpy(result, linebuf, len + 1);
+
+	return result;
+}
+
+/* write access */
+
+enum {
+	WRITE_SCALING_MIN_FREQ,
+	WRITE_SCALING_MAX_FREQ,
+	WRITE_SCALING_GOVERNOR,
+	WRITE_SCALING_SET_SPEED,
+	MAX_WRITE_FILES
+};
+
+static const char *write_files[MAX_VALUE_FILES] = {
+	[WRITE_SCALING_MIN_FREQ] = "scaling_min_freq",
+	[WRITE_SCALING_MAX_FREQ] = "scaling_max_freq",
+	[WRITE_SCALING_GOVERNOR] = "scaling_governor",
+	[WRITE_SCALING_SET_SPEED] = "scaling_setspeed",
+};
+
+static int sysfs_write_one_value(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+				 const char *new_value, size_t len)
+{
+	if (which >= MAX_WRITE_FILES)
+		return 0;
+
+	if ( sysfs_write_file(ctx, cpu, write_files[which], new_value, len) != len )
+		return -ENODEV;
+
+	return 0;
+};
+
+/* write elision, see cpufreq_set_write_elision() */
+
+#define SYSFS_ELIDE_LEN 24
+
+struct sysfs_elide_entry {
+	char value[MAX_WRITE_FILES][SYSFS_ELIDE_LEN];
+};
+
+int sysfs_set_write_elision(struct cpufreq_ctx *ctx, int mode)
+{
+	struct sysfs_elide_entry *cache = NULL;
+
+	if (mode != CPUFREQ_ELIDE_NONE && mode != CPUFREQ_ELIDE_READ &&
+	    mode != CPUFREQ_ELIDE_CACHED)
+		return -EINVAL;
+
+	if (mode == CPUFREQ_ELIDE_CACHED) {
+		cache = calloc(CPUFREQ_MAX_CPUS, sizeof(*cache));
+		if (!cache)
+			return -ENOMEM;
+	}
+
+	free(ctx->write_elision.cache);
+	ctx->write_elision.cache = cache;
+	ctx->write_elision.mode = mode;
+
+	return 0;
+}
+
+unsigned long sysfs_get_elided_writes(struct cpufreq_ctx *ctx)
+{
+	return __atomic_load_n(&ctx->write_elision.elided, __ATOMIC_RELAXED);
+}
+
+/* one entry per policy, kept at its first CPU, so that a write through
+ * any CPU of the policy is seen by all of them */
+static char * sysfs_elide_slot(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which)
+{
+	if (!ctx->write_elision.cache)
+		return NULL;
+
+	return ctx->write_elision.cache[sysfs_policy_of(ctx, cpu)].value[which];
+}
+
+static void sysfs_elide_remember(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+				 const char *value, size_t len)
+{
+	char *cached = sysfs_elide_slot(ctx, cpu, which);
+
+	if (!cached)
+		return;
+
+	if (len >= SYSFS_ELIDE_LEN)
+		len = 0;	/* too long to remember */
+	memcpy(cached, value, len);
+	cached[len] = '\0';
+}
+
+/* returns 1 if writing value would not change anything */
+static int sysfs_write_unchanged(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+				 const char *value, size_t len)
+{
+	char linebuf[MAX_LINE_LEN];
+	const char *cached;
+	unsigned int cur;
+	int unchanged;
+
+	if (ctx->write_elision.mode == CPUFREQ_ELIDE_NONE ||
+	    which == WRITE_SCALING_SET_SPEED)
+		return 0;
+
+	cached = sysfs_elide_slot(ctx, cpu, which);
+	if (cached && cached[0]) {
+		unchanged = (strlen(cached) == len && !memcmp(cached, value, len));
+		goto out;
+	}
+
+	/* published values may be older than the last write */
+	cur = sysfs_read_kernel(ctx, cpu, write_files[which], linebuf, sizeof(linebuf));
+	if (cur && linebuf[cur - 1] == '\n')
+		cur--;
+	if (!cur)
+		return 0;
+
+	sysfs_elide_remember(ctx, cpu, which, linebuf, cur);
+	unchanged = (cur == len && !memcmp(linebuf, value, len));
+
+ out:
+	if (unchanged)
+		__atomic_fetch_add(&ctx->write_elision.elided, 1, __ATOMIC_RELAXED);
+	return unchanged;
+}
+
+static int sysfs_write_noted(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+			     const char *value, size_t len)
+{
+	int ret = sysfs_write_one_value(ctx, cpu, which, value, len);
+	char *cached;
+
+	if (!ret)
+		sysfs_elide_remember(ctx, cpu, which, value, len);
+	else if ((cached = sysfs_elide_slot(ctx, cpu, which)))
+		cached[0] = '\0';
+
+	return ret;
+}
+
+static int sysfs_write_elided(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned int which,
+			      const char *value, size_t len)
+{
+	if (sysfs_write_unchanged(ctx, cpu, which, value, len))
+		return 0;
+
+	return sysfs_write_noted(ctx, cpu, which, value, len);
+}
+
+
+int sysfs_cpu_exists(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	char file[SYSFS_PATH_MAX];
+	struct stat statbuf;
+	int ret;
+
+	if (cpufreq_is_policy(cpu))
+		ret = snprintf(file, SYSFS_PATH_MAX, "%scpufreq/policy%u/",
+			       ctx->path_to_cpu, cpufreq_policy_nr(cpu));
+	else
+		ret = snprintf(file, SYSFS_PATH_MAX, "%scpu%u/", ctx->path_to_cpu, cpu);
+	if (ret >= SYSFS_PATH_MAX)
+		return -ENOSYS;
+
+	if ( stat(file, &statbuf) != 0 )
+		return -ENOSYS;
+
+	return S_ISDIR(statbuf.st_mode) ? 0 : -ENOSYS;
+}
+
+
+unsigned long sysfs_get_freq_kernel(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	return sysfs_get_one_value(ctx, cpu, SCALING_CUR_FREQ);
+}
+
+unsigned long sysfs_get_freq_hardware(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	return sysfs_get_one_value(ctx, cpu, CPUINFO_CUR_FREQ);
+}
+
+unsigned long sysfs_get_cur_freq(struct cpufreq_ctx *ctx, unsigned int cpu, int mode)
+{
+	unsigned long base;
+
+	switch (mode) {
+	case CPUFREQ_CUR_CACHED:
+		return sysfs_get_one_value(ctx, cpu, SCALING_CUR_FREQ);
+	case CPUFREQ_CUR_KERNEL:
+		return sysfs_get_value(ctx, cpu, SCALING_CUR_FREQ, 1);
+	case CPUFREQ_CUR_HARDWARE:
+		return sysfs_get_value(ctx, cpu, CPUINFO_CUR_FREQ, 1);
+	case CPUFREQ_CUR_APERF:
+		/* MPERF counts at the base frequency, which only
+		 * intel_pstate tells; elsewhere, as with acpi-cpufreq,
+		 * boost isn't counted in cpuinfo_max_freq */
+		base = sysfs_get_one_value(ctx, cpu, BASE_FREQUENCY);
+		if (!base)
+			base = sysfs_get_one_value(ctx, cpu, CPUINFO_MAX_FREQ);
+		return base ? sysfs_msr_get_freq(cpu, base, CPUFREQ_CUR_APERF_US) : 0;
+	}
+	return 0;
+}
+
+int sysfs_set_cur_freq_mode(struct cpufreq_ctx *ctx, int mode)
+{
+	if (mode < CPUFREQ_CUR_CACHED || mode > CPUFREQ_CUR_APERF)
+		return -EINVAL;
+
+	ctx->cur_freq_mode = mode;
+	return 0;
+}
+
+unsigned long sysfs_get_transition_latency(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	return sysfs_get_one_value(ctx, cpu, CPUINFO_LATENCY);
+}
+
+int sysfs_get_hardware_limits(struct cpufreq_ctx *ctx, unsigned int cpu,
+			      unsigned long *min,
+			      unsigned long *max)
+{
+	if ((!min) || (!max))
+		return -EINVAL;
+
+	*min = sysfs_get_one_value(ctx, cpu, CPUINFO_MIN_FREQ);
+	if (!*min)
+		return -ENODEV;
+
+	*max = sysfs_get_one_value(ctx, cpu, CPUINFO_MAX_FREQ);
+	if (!*max)
+		return -ENODEV;
+
+	return 0;
+}
+
+char * sysfs_get_driver(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena) {
+	return sysfs_get_one_string(ctx, cpu, SCALING_DRIVER, arena);
+}
+
+struct cpufreq_policy * sysfs_get_policy(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena) {
+	struct cpufreq_arena mark;
+	struct cpufreq_policy *policy;
+
+	sysfs_arena_mark(arena, &mark);
+	policy = sysfs_alloc(arena, sizeof(struct cpufreq_policy));
 	if (!policy)
 		return NULL;
 
-	policy->governor = sysfs_get_one_string(cpu, SCALING_GOVERNOR);
-	if (!policy->governor) {
-		free(policy);
+	policy->governor = sysfs_get_one_string(ctx, cpu, SCALING_GOVERNOR, arena);
+	if (!policy->governor) {
+		sysfs_free(arena, policy);
+		return NULL;
+	}
+	policy->min = sysfs_get_one_value(ctx, cpu, SCALING_MIN_FREQ);
+	policy->max = sysfs_get_one_value(ctx, cpu, SCALING_MAX_FREQ);
+	if ((!policy->min) || (!policy->max)) {
+		if (arena) {
+			/* sysfs_free() would only give back the governor */
+			sysfs_arena_rollback(arena, &mark);
+		} else {
+			free(policy->governor);
+			free(policy);
+		}
+		return NULL;
+	}
+
+	return policy;
+}
+
+/* list-type files are returned as one block of memory, which holds the
+ * header structure followed by the array(s) it points to */
+
+static int sysfs_compare_ulong(const void *a, const void *b)
+{
+	unsigned long x = *(const unsigned long *) a;
+	unsigned long y = *(const unsigned long *) b;
+
+	return (x > y) - (x < y);
+}
+
+struct cpufreq_governor_vector * sysfs_get_governor_vector(struct cpufreq_ctx *ctx, unsigned int cpu,
+							  struct cpufreq_arena *arena)
+{
+	struct cpufreq_governor_vector *vec;
+	char linebuf[MAX_LINE_LEN];
+	char *strings;
+	unsigned int pos, i;
+	unsigned int len, count;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, "scaling_available_governors", linebuf, sizeof(linebuf))) == 0 )
+		return NULL;
+
+	count = sysfs_parse_count_words(linebuf, len);
+	if (!count)
+		return NULL;
+
+	vec = sysfs_alloc(arena, sizeof(*vec) + count * sizeof(char *) + len + 1);
+	if (!vec)
+		return NULL;
+
+	vec->count = 0;
+	vec->governor = (char **) (vec + 1);
+	strings = (char *) (vec->governor + count);
+
+	pos = 0;
+	for ( i = 0; i <= len; i++ )
+	{
+		if ( i < len && linebuf[i] != ' ' && linebuf[i] != '\n' )
+			continue;
+		if ( i > pos ) {
+			memcpy(strings, linebuf + pos, i - pos);
+			strings[i - pos] = '\0';
+			vec->governor[vec->count++] = strings;
+			strings += i - pos + 1;
+		}
+		pos = i + 1;
+	}
+
+	return vec;
+}
+
+struct cpufreq_frequency_vector * sysfs_get_frequency_vector(struct cpufreq_ctx *ctx, unsigned int cpu,
+							  struct cpufreq_arena *arena)
+{
+	struct cpufreq_frequency_vector *vec;
+	char linebuf[MAX_LINE_LEN];
+	unsigned int len, count, i;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, "scaling_available_frequencies", linebuf, sizeof(linebuf))) == 0 )
+		return NULL;
+
+	count = sysfs_parse_count_words(linebuf, len);
+	if (!count)
+		return NULL;
+
+	vec = sysfs_alloc(arena, sizeof(*vec) + count * sizeof(unsigned long));
+	if (!vec)
+		return NULL;
+
+	vec->frequency = (unsigned long *) (vec + 1);
+	vec->count = sysfs_parse_ulongs(linebuf, len, vec->frequency, count);
+	if (vec->count != count) {
+		sysfs_free(arena, vec);
 		return NULL;
 	}
-	policy->min = sysfs_get_one_value(cpu, SCALING_MIN_FREQ);
-	policy->max = sysfs_get_one_value(cpu, SCALING_MAX_FREQ);
-	if ((!policy->min) || (!policy->max)) {
-		free(policy->governor);
-		free(policy);
+
+	/* drivers list their frequencies either ascending or descending;
+	 * anything else is sorted, so that lookups can use binary search */
+	vec->descending = (count > 1 && vec->frequency[0] > vec->frequency[1]);
+	for (i = 1; i < count; i++) {
+		if (vec->descending ?
+		    vec->frequency[i] > vec->frequency[i - 1] :
+		    vec->frequency[i] < vec->frequency[i - 1])
+			break;
+	}
+	if (i < count) {
+		qsort(vec->frequency, count, sizeof(unsigned long), sysfs_compare_ulong);
+		vec->descending = 0;
+	}
+
+	return vec;
+}
+
+static struct cpufreq_cpu_vector * sysfs_get_cpu_vector(struct cpufreq_ctx *ctx, unsigned int cpu,
+							const char *file,
+							struct cpufreq_arena *arena)
+{
+	struct cpufreq_cpu_vector *vec;
+	char linebuf[MAX_LINE_LEN];
+	unsigned int len, count;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, file, linebuf, sizeof(linebuf))) == 0 )
+		return NULL;
+
+	count = sysfs_parse_count_words(linebuf, len);
+	if (!count)
+		return NULL;
+
+	vec = sysfs_alloc(arena, sizeof(*vec) + count * sizeof(unsigned int));
+	if (!vec)
+		return NULL;
+
+	vec->cpu = (unsigned int *) (vec + 1);
+	vec->count = sysfs_parse_uints(linebuf, len, vec->cpu, count);
+	if (vec->count != count) {
+		sysfs_free(arena, vec);
+		return NULL;
+	}
+
+	return vec;
+}
+
+struct cpufreq_cpu_vector * sysfs_get_affected_cpu_vector(struct cpufreq_ctx *ctx, unsigned int cpu,
+							   struct cpufreq_arena *arena) {
+	return sysfs_get_cpu_vector(ctx, cpu, "affected_cpus", arena);
+}
+
+struct cpufreq_cpu_vector * sysfs_get_related_cpu_vector(struct cpufreq_ctx *ctx, unsigned int cpu,
+							  struct cpufreq_arena *arena) {
+	return sysfs_get_cpu_vector(ctx, cpu, "related_cpus", arena);
+}
+
+static int sysfs_get_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+			     const char *file, struct cpufreq_cpumask *mask)
+{
+	char linebuf[MAX_LINE_LEN];
+	unsigned int len;
+
+	int overflow;
+
+	memset(mask, 0, sizeof(*mask));
+	len = sysfs_read_file(ctx, cpu, file, linebuf, sizeof(linebuf));
+	if (!len || !sysfs_parse_cpulist(linebuf, len, mask->bits, CPUFREQ_MAX_CPUS, &overflow))
+		return -ENODEV;
+	if (overflow)
+		return -E2BIG;
+
+	return 0;
+}
+
+int sysfs_get_affected_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+			       struct cpufreq_cpumask *mask)
+{
+	return sysfs_get_cpumask(ctx, cpu, "affected_cpus", mask);
+}
+
+int sysfs_get_related_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu,
+			      struct cpufreq_cpumask *mask)
+{
+	return sysfs_get_cpumask(ctx, cpu, "related_cpus", mask);
+}
+
+/* room for more states than fit on the stack, see below */
+static int sysfs_stats_grow(unsigned long **frequency, unsigned long long **time,
+			    unsigned int *max, const unsigned long *stack_frequency)
+{
+	unsigned int n = *max * 2;
+	unsigned long *f = malloc(n * sizeof(*f));
+	unsigned long long *t = malloc(n * sizeof(*t));
+
+	if (!f || !t) {
+		free(f);
+		free(t);
+		return -ENOMEM;
+	}
+	memcpy(f, *frequency, *max * sizeof(*f));
+	memcpy(t, *time, *max * sizeof(*t));
+	if (*frequency != stack_frequency) {
+		free(*frequency);
+		free(*time);
+	}
+	*frequency = f;
+	*time = t;
+	*max = n;
+	return 0;
+}
+
+struct cpufreq_stats_table * sysfs_get_stats_table(struct cpufreq_ctx *ctx, unsigned int cpu,
+							  struct cpufreq_arena *arena)
+{
+	struct cpufreq_stats_table *table = NULL;
+	struct sysfs_stream stream;
+	unsigned long stack_frequency[CPUFREQ_MAX_STATES], *frequency = stack_frequency;
+	unsigned long long stack_time[CPUFREQ_MAX_STATES], *time = stack_time;
+	unsigned int len, count = 0, max = CPUFREQ_MAX_STATES, i;
+	const char *line;
+	int ret = 0;
+
+	/* two numbers per line; only parts with very many states need
+	 * more room than the stack gives */
+	if (sysfs_stream_open(&stream, ctx, cpu, "stats/time_in_state"))
+		return NULL;
+	while (!ret && (line = sysfs_stream_line(&stream, &len))) {
+		if (count == max)
+			ret = sysfs_stats_grow(&frequency, &time, &max, stack_frequency);
+		if (!ret)
+			count += sysfs_parse_pairs(line, len, frequency + count, time + count, 1);
+	}
+	if (sysfs_stream_close(&stream) || ret || !count)
+		goto out;
+
+	/* time_in_state first, as it is the type with the largest alignment */
+	table = sysfs_alloc(arena, sizeof(*table) + count * (sizeof(unsigned long long) +
+						 sizeof(unsigned long)));
+	if (!table)
+		goto out;
+
+	table->count = count;
+	table->time_in_state = (unsigned long long *) (table + 1);
+	table->frequency = (unsigned long *) (table->time_in_state + count);
+	memcpy(table->time_in_state, time, count * sizeof(*time));
+	memcpy(table->frequency, frequency, count * sizeof(*frequency));
+
+	table->total_time = 0;
+	for (i = 0; i < count; i++)
+		table->total_time += table->time_in_state[i];
+
+ out:
+	if (frequency != stack_frequency) {
+		free(frequency);
+		free(time);
+	}
+	return table;
+}
+
+unsigned long sysfs_get_transitions(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	return sysfs_get_one_value(ctx, cpu, STATS_NUM_TRANSITIONS);
+}
+
+/* snapshot of all values of one CPU
+ *
+ * The helpers below parse into the fixed-size arrays of struct
+ * cpufreq_snapshot, so that no memory needs to be allocated.
+ */
+
+static void sysfs_copy_word(char *dst, size_t dstlen, const char *src, size_t len)
+{
+	if (len >= dstlen)
+		len = dstlen - 1;
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
+
+static unsigned int sysfs_read_string(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname,
+				      char *dst, size_t dstlen)
+{
+	char linebuf[MAX_LINE_LEN];
+	unsigned int len;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, fname, linebuf, sizeof(linebuf))) == 0 )
+		return 0;
+
+	if (linebuf[len - 1] == '\n')
+		len--;
+
+	sysfs_copy_word(dst, dstlen, linebuf, len);
+	return len;
+}
+
+int sysfs_get_policy_value(struct cpufreq_ctx *ctx, unsigned int cpu,
+			   struct cpufreq_policy_value *policy)
+{
+	if (!sysfs_read_string(ctx, cpu, string_files[SCALING_GOVERNOR],
+			       policy->governor, sizeof(policy->governor)))
+		return -ENODEV;
+
+	policy->min = sysfs_get_one_value(ctx, cpu, SCALING_MIN_FREQ);
+	policy->max = sysfs_get_one_value(ctx, cpu, SCALING_MAX_FREQ);
+	if (!policy->min || !policy->max)
+		return -ENODEV;
+
+	return 0;
+}
+
+int sysfs_get_governor(struct cpufreq_ctx *ctx, unsigned int cpu, char *governor, size_t len)
+{
+	if (!sysfs_read_string(ctx, cpu, string_files[SCALING_GOVERNOR], governor, len))
+		return -ENODEV;
+
+	return 0;
+}
+
+int sysfs_get_snapshot(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_snapshot *snap)
+{
+	char linebuf[MAX_LINE_LEN];
+	struct sysfs_stream stream;
+	unsigned long frequency;
+	unsigned long long time;
+	unsigned int len, pos, i;
+	const char *line;
+	int mode;
+
+	memset(snap, 0, sizeof(*snap));
+	snap->cpu = cpu;
+
+	if (sysfs_read_string(ctx, cpu, string_files[SCALING_DRIVER],
+			      snap->driver, sizeof(snap->driver)))
+		snap->valid |= CPUFREQ_SNAP_DRIVER;
+
+	mode = ctx->cur_freq_mode == CPUFREQ_CUR_KERNEL ? CPUFREQ_CUR_KERNEL : CPUFREQ_CUR_CACHED;
+	if ((snap->cur_freq = sysfs_get_cur_freq(ctx, cpu, mode)))
+		snap->valid |= CPUFREQ_SNAP_CUR_FREQ;
+
+	/* only if asked for, as it may wake up the CPU */
+	if (ctx->cur_freq_mode >= CPUFREQ_CUR_HARDWARE &&
+	    (snap->hw_freq = sysfs_get_cur_freq(ctx, cpu, ctx->cur_freq_mode)))
+		snap->valid |= CPUFREQ_SNAP_HW_FREQ;
+
+	snap->hw_min = sysfs_get_one_value(ctx, cpu, CPUINFO_MIN_FREQ);
+	snap->hw_max = sysfs_get_one_value(ctx, cpu, CPUINFO_MAX_FREQ);
+	if (snap->hw_min && snap->hw_max)
+		snap->valid |= CPUFREQ_SNAP_HW_LIMITS;
+
+	if ((snap->latency = sysfs_get_one_value(ctx, cpu, CPUINFO_LATENCY)))
+		snap->valid |= CPUFREQ_SNAP_LATENCY;
+
+	snap->policy_min = sysfs_get_one_value(ctx, cpu, SCALING_MIN_FREQ);
+	snap->policy_max = sysfs_get_one_value(ctx, cpu, SCALING_MAX_FREQ);
+	if (snap->policy_min && snap->policy_max &&
+	    sysfs_read_string(ctx, cpu, string_files[SCALING_GOVERNOR],
+			      snap->governor, sizeof(snap->governor)))
+		snap->valid |= CPUFREQ_SNAP_POLICY;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, "scaling_available_governors", linebuf, sizeof(linebuf))) )
+	{
+		pos = 0;
+		for ( i = 0; i <= len && snap->nr_governors < CPUFREQ_MAX_GOVERNORS; i++ )
+		{
+			if ( i < len && linebuf[i] != ' ' && linebuf[i] != '\n' )
+				continue;
+			if ( i - pos >= 2 )
+				sysfs_copy_word(snap->governors[snap->nr_governors++],
+						CPUFREQ_NAME_LEN, linebuf + pos, i - pos);
+			pos = i + 1;
+		}
+		if (snap->nr_governors)
+			snap->valid |= CPUFREQ_SNAP_GOVERNORS;
+	}
+
+	if ( ( len = sysfs_read_file(ctx, cpu, "scaling_available_frequencies", linebuf, sizeof(linebuf))) ) {
+		snap->nr_frequencies = sysfs_parse_ulongs(linebuf, len, snap->frequencies,
+							  CPUFREQ_MAX_STATES);
+		if (snap->nr_frequencies)
+			snap->valid |= CPUFREQ_SNAP_FREQUENCIES;
+	}
+
+	if ( ( len = sysfs_read_file(ctx, cpu, "affected_cpus", linebuf, sizeof(linebuf))) &&
+	    cpufreq_cpumask_parse(linebuf, len, &snap->affected_cpus))
+		snap->valid |= CPUFREQ_SNAP_AFFECTED_CPUS;
+
+	if ( ( len = sysfs_read_file(ctx, cpu, "related_cpus", linebuf, sizeof(linebuf))) &&
+	    cpufreq_cpumask_parse(linebuf, len, &snap->related_cpus))
+		snap->valid |= CPUFREQ_SNAP_RELATED_CPUS;
+
+	/* streamed, as with many states it doesn't fit into linebuf */
+	if (!sysfs_stream_open(&stream, ctx, cpu, "stats/time_in_state")) {
+		while ((line = sysfs_stream_line(&stream, &len))) {
+			if (!sysfs_parse_pairs(line, len, &frequency, &time, 1))
+				continue;
+			if (snap->nr_stats < CPUFREQ_MAX_STATES) {
+				snap->stats_frequency[snap->nr_stats] = frequency;
+				snap->stats_time_in_state[snap->nr_stats++] = time;
+			} else
+				snap->valid |= CPUFREQ_SNAP_STATS_TRUNCATED;
+			snap->total_time += time;
+		}
+		if (sysfs_stream_close(&stream)) {
+			snap->nr_stats = 0;
+			snap->total_time = 0;
+			snap->valid &= ~CPUFREQ_SNAP_STATS_TRUNCATED;
+		}
+		if (snap->nr_stats)
+			snap->valid |= CPUFREQ_SNAP_STATS;
+	}
+
+	if ((snap->total_trans = sysfs_get_one_value(ctx, cpu, STATS_NUM_TRANSITIONS)))
+		snap->valid |= CPUFREQ_SNAP_TRANSITIONS;
+
+	return snap->valid ? 0 : -ENODEV;
+}
+
+/* system-wide snapshot
+ *
+ * The present CPUs and their policies are taken from the topology, so
+ * building a snapshot lists no directories once the topology is known.
+ * Each policy is read from cpufreq/policyN, or from the directory of
+ * its first CPU on kernels without those, and only once, both when
+ * building the snapshot and when refreshing it.
+ */
+
+/* sorted numbers N of the entries named prefixN in dir, which is
+ * relative to the cpu directory */
+static int sysfs_list_dir(struct cpufreq_ctx *ctx, const char *subdir, const char *prefix,
+			  unsigned int **numbers, unsigned int *nr_numbers)
+{
+	char path[SYSFS_PATH_MAX];
+	DIR *dir;
+	struct dirent *ent;
+	unsigned int *list = NULL, *tmp;
+	unsigned int count = 0, size = 0, nr, i, j;
+	size_t len = strlen(prefix);
+	char *endp;
+
+	if (snprintf(path, sizeof(path), "%s%s", ctx->path_to_cpu, subdir) >= (int) sizeof(path))
+		return -ENAMETOOLONG;
+
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+
+	while ((ent = readdir(dir))) {
+		if (strncmp(ent->d_name, prefix, len) ||
+		    ent->d_name[len] < '0' || ent->d_name[len] > '9')
+			continue;
+		nr = strtoul(ent->d_name + len, &endp, 10);
+		if (*endp || nr >= CPUFREQ_MAX_CPUS)
+			continue;
+		if (count == size) {
+			size = size ? size * 2 : 64;
+			tmp = realloc(list, size * sizeof(*list));
+			if (!tmp) {
+				free(list);
+				closedir(dir);
+				return -ENOMEM;
+			}
+			list = tmp;
+		}
+		list[count++] = nr;
+	}
+	closedir(dir);
+
+	/* readdir() order is arbitrary; insertion sort is fine as sysfs
+	 * mostly returns the entries in order anyway */
+	for (i = 1; i < count; i++) {
+		nr = list[i];
+		for (j = i; j > 0 && list[j - 1] > nr; j--)
+			list[j] = list[j - 1];
+		list[j] = nr;
+	}
+
+	*numbers = list;
+	*nr_numbers = count;
+	return 0;
+}
+
+struct cpufreq_cpu_vector * sysfs_get_policy_vector(struct cpufreq_ctx *ctx)
+{
+	struct cpufreq_cpu_vector *vec;
+	unsigned int *policies = NULL;
+	unsigned int nr_policies = 0;
+
+	if (sysfs_list_dir(ctx, "cpufreq/", "policy", &policies, &nr_policies) ||
+	    !nr_policies) {
+		free(policies);
+		return NULL;
+	}
+
+	vec = sysfs_alloc(NULL, sizeof(*vec) + nr_policies * sizeof(unsigned int));
+	if (vec) {
+		vec->count = nr_policies;
+		vec->cpu = (unsigned int *) (vec + 1);
+		memcpy(vec->cpu, policies, nr_policies * sizeof(unsigned int));
+	}
+	free(policies);
+
+	return vec;
+}
+
+void sysfs_put_system_snapshot(struct cpufreq_system_snapshot *sys)
+{
+	if (!sys)
+		return;
+
+	free(sys->policies);
+	free(sys->cpus);
+	free(sys);
+}
+
+struct cpufreq_system_snapshot * sysfs_get_system_snapshot(struct cpufreq_ctx *ctx)
+{
+	struct cpufreq_system_snapshot *sys;
+	struct cpufreq_topology *topo;
+	struct cpufreq_snapshot *snap;
+	unsigned int *index_of = NULL;
+	unsigned int i, cpu, first;
+
+	topo = sysfs_get_topology(ctx);
+	if (!topo)
 		return NULL;
+
+	sys = calloc(1, sizeof(*sys));
+	if (!sys)
+		goto error_out;
+	sys->ctx = ctx;
+
+	sys->cpus = calloc(topo->nr_present, sizeof(*sys->cpus));
+	sys->policies = calloc(topo->nr_policies ? topo->nr_policies : 1,
+			       sizeof(*sys->policies));
+	index_of = malloc(CPUFREQ_MAX_CPUS * sizeof(*index_of));
+	if (!sys->cpus || !sys->policies || !index_of)
+		goto error_out;
+
+	/* policy indices are stored off by one, 0 means "no snapshot" */
+	memset(index_of, 0, CPUFREQ_MAX_CPUS * sizeof(*index_of));
+
+	for (i = 0; i < topo->nr_policies; i++) {
+		first = topo->policies[i];
+		snap = &sys->policies[sys->nr_policies];
+		/* the policy directory, or the CPU's own on older kernels */
+		if (sysfs_get_snapshot(ctx, CPUFREQ_POLICY(first), snap) &&
+		    sysfs_get_snapshot(ctx, first, snap))
+			continue;
+		index_of[first] = ++sys->nr_policies;
+	}
+
+	cpufreq_cpumask_for_each(cpu, &topo->present) {
+		sys->cpus[sys->nr_cpus].cpu = cpu;
+		first = topo->cpu[cpu].policy;
+		if (first != CPUFREQ_TOPO_UNKNOWN && index_of[first])
+			sys->cpus[sys->nr_cpus].policy = &sys->policies[index_of[first] - 1];
+		sys->nr_cpus++;
+	}
+
+	free(index_of);
+	sysfs_put_topology(topo);
+	return sys;
+
+ error_out:
+	free(index_of);
+	sysfs_put_topology(topo);
+	sysfs_put_system_snapshot(sys);
+	return NULL;
+}
+
+int sysfs_refresh_system_snapshot(struct cpufreq_system_snapshot *sys)
+{
+	struct cpufreq_ctx *ctx = sys->ctx;
+	struct cpufreq_snapshot *policy;
+	struct cpufreq_cpumask related;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < sys->nr_policies; i++) {
+		policy = &sys->policies[i];
+		related = policy->related_cpus;
+		if (sysfs_get_snapshot(ctx, policy->cpu, policy) ||
+		    memcmp(&related, &policy->related_cpus, sizeof(related)))
+			ret = -EAGAIN;
+	}
+
+	return ret;
+}
+
+static int verify_gov(char *new_gov, char *passed_gov)
+{
+	unsigned int i, j=0;
+
+	if (!passed_gov || (strlen(passed_gov) > 19))
+		return -EINVAL;
+
+	strncpy(new_gov, passed_gov, 20);
+	for (i=0;i<20;i++) {
+		if (j) {
+			new_gov[i] = '\0';
+			continue;
+		}
+		if ((new_gov[i] >= 'a') && (new_gov[i] <= 'z')) {
+			continue;
+		}
+		if ((new_gov[i] >= 'A') && (new_gov[i] <= 'Z')) {
+			continue;
+		}
+		if (new_gov[i] == '-') {
+			continue;
+		}
+		if (new_gov[i] == '_') {
+			continue;
+		}
+		if (new_gov[i] == '\0') {
+			j = 1;
+			continue;
+		}
+		return -EINVAL;
 	}
+	new_gov[19] = '\0';
+	return 0;
+}
+
+/* policy locks
+ *
+ * Writes to a policy are serialized by the lock of the first CPU of the
+ * policy. Which policy a CPU belongs to is looked up in related_cpus
+ * once, and then read from ctx->policy_of without locking.
+ */
+
+static unsigned int sysfs_get_policy_cpus(struct cpufreq_ctx *ctx, unsigned int cpu,
+					  struct cpufreq_cpumask *mask)
+{
+	char linebuf[MAX_LINE_LEN];
+	unsigned int len;
+
+	len = sysfs_read_file(ctx, cpu, "related_cpus", linebuf, sizeof(linebuf));
+	if (!len)
+		len = sysfs_read_file(ctx, cpu, "affected_cpus", linebuf, sizeof(linebuf));
+	memset(mask, 0, sizeof(*mask));
+	if (len && sysfs_parse_cpulist(linebuf, len, mask->bits, CPUFREQ_MAX_CPUS, NULL))
+		return 1;
+
+	/* no policy information: the CPU stands on its own */
+	cpufreq_cpumask_zero(mask);
+	cpufreq_cpumask_set(mask, cpufreq_policy_nr(cpu));
+	return 0;
+}
+
+/* returns the first CPU of the policy of cpu, which is N for
+ * CPUFREQ_POLICY(N) */
+static unsigned int sysfs_policy_of(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	struct cpufreq_cpumask mask;
+	unsigned int first, i;
+
+	if (cpufreq_is_policy(cpu) || cpu >= CPUFREQ_MAX_CPUS)
+		return cpufreq_policy_nr(cpu) % CPUFREQ_MAX_CPUS;
+
+	first = __atomic_load_n(&ctx->policy_of[cpu], __ATOMIC_ACQUIRE);
+	if (first)
+		return first - 1;
+
+	sysfs_get_policy_cpus(ctx, cpu, &mask);
+	cpufreq_cpumask_set(&mask, cpu);
+	first = cpufreq_cpumask_next(&mask, 0);
+	cpufreq_cpumask_for_each(i, &mask)
+		__atomic_store_n(&ctx->policy_of[i], first + 1, __ATOMIC_RELEASE);
+
+	return first;
+}
+
+static pthread_mutex_t * sysfs_policy_lock(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	pthread_mutex_t *lock;
+
+	lock = &ctx->policy_lock[sysfs_policy_of(ctx, cpu) & (SYSFS_POLICY_LOCKS - 1)];
+	pthread_mutex_lock(lock);
+	return lock;
+}
+
+/* topology index
+ *
+ * Built from the range lists in present, online and possible, the
+ * policy directories, the topology directories of the CPUs and the NUMA
+ * nodes. The sibling lists are used to fill in all CPUs of a package or
+ * core at once, so that only one CPU of each is read. The index is
+ * reference counted, so that a rebuild doesn't pull it away from under
+ * its users, and remembers the contents of online it was built for:
+ * as long as they stay the same, getting the index costs one pread().
+ */
+
+struct sysfs_topology {
+	struct cpufreq_topology topo;	/* must be first */
+	unsigned int refs;
+	unsigned int freqs_size;
+	unsigned int online_len;
+	char online[MAX_LINE_LEN];
+};
+
+/* reads a file relative to the cpu directory */
+static unsigned int sysfs_read_cpu_dir_file(struct cpufreq_ctx *ctx, const char *fname,
+					    char *buf, size_t buflen)
+{
+	char path[SYSFS_PATH_MAX];
+	ssize_t numread;
+	int fd;
+
+	if (snprintf(path, sizeof(path), "%s%s", ctx->path_to_cpu, fname) >= (int) sizeof(path))
+		return 0;
+
+	if ( ( fd = open(path, O_RDONLY) ) == -1 )
+		return 0;
 
-	return policy;
+	numread = read(fd, buf, buflen - 1);
+	close(fd);
+	if (numread < 1)
+		return 0;
+
+	buf[numread] = '\0';
+	return numread;
 }
 
-struct cpufreq_available_governors * sysfs_get_available_governors(unsigned int cpu) {
-	struct cpufreq_available_governors *first = NULL;
-	struct cpufreq_available_governors *current = NULL;
+/* unlike cpufreq_cpumask_parse(), keeps the CPUs below CPUFREQ_MAX_CPUS
+ * of a list naming others, and tells in overflow if it did */
+static unsigned int sysfs_topology_mask(struct cpufreq_ctx *ctx, const char *fname,
+					struct cpufreq_cpumask *mask, int *overflow)
+{
 	char linebuf[MAX_LINE_LEN];
-	unsigned int pos, i;
 	unsigned int len;
 
-	if ( ( len = sysfs_read_file(cpu, "scaling_available_governors", linebuf, sizeof(linebuf))) == 0 )
-	{
-		return NULL;
-	}
+	memset(mask, 0, sizeof(*mask));
+	if (overflow)
+		*overflow = 0;
+	len = sysfs_read_cpu_dir_file(ctx, fname, linebuf, sizeof(linebuf));
+	if (!len)
+		return 0;
 
-	pos = 0;
-	for ( i = 0; i < len; i++ )
-	{
-		if ( linebuf[i] == ' ' || linebuf[i] == '\n' )
-		{
-			if ( i - pos < 2 )
-				continue;
-			if ( current ) {
-				current->next = malloc(sizeof *current );
-				if ( ! current->next )
-					goto error_out;
-				current = current->next;
-			} else {
-				first = malloc( sizeof *first );
-				if ( ! first )
-					goto error_out;
-				current = first;
-			}
-			current->first = first;
-			current->next = NULL;
+	return sysfs_parse_cpulist(linebuf, len, mask->bits, CPUFREQ_MAX_CPUS, overflow);
+}
 
-			current->governor = malloc(i - pos + 1);
-			if ( ! current->governor )
-				goto error_out;
+/* the number in cpuX/topology/id_file, and the CPUs sharing it in the
+ * first of the sibling lists which exists */
+static unsigned int sysfs_topology_id(struct cpufreq_ctx *ctx, unsigned int cpu,
+				      const char *id_file, const char * const *lists,
+				      struct cpufreq_cpumask *siblings)
+{
+	char fname[SYSFS_FNAME_MAX];
+	char linebuf[MAX_LINE_LEN];
+	unsigned long long id;
+	const char *pos = linebuf;
+	unsigned int len;
 
-			memcpy( current->governor, linebuf + pos, i - pos);
-			current->governor[i - pos] = '\0';
-			pos = i + 1;
-		}
-	}
+	memset(siblings, 0, sizeof(*siblings));
 
-	return first;
+	snprintf(fname, sizeof(fname), "cpu%u/topology/%s", cpu, id_file);
+	len = sysfs_read_cpu_dir_file(ctx, fname, linebuf, sizeof(linebuf));
+	if (!len || sysfs_parse_number(&pos, linebuf + len, &id) ||
+	    id >= CPUFREQ_TOPO_UNKNOWN)
+		return CPUFREQ_TOPO_UNKNOWN;
 
- error_out:
-	while ( first ) {
-		current = first->next;
-		if ( first->governor )
-			free( first->governor );
-		free( first );
-		first = current;
+	for (; *lists; lists++) {
+		snprintf(fname, sizeof(fname), "cpu%u/topology/%s", cpu, *lists);
+		if (sysfs_topology_mask(ctx, fname, siblings, NULL))
+			break;
 	}
-	return NULL;
+	cpufreq_cpumask_set(siblings, cpu);
+
+	return id;
 }
 
+static const char * const sysfs_package_lists[] = {
+	"package_cpus_list", "core_siblings_list", NULL
+};
 
-struct cpufreq_available_frequencies * sysfs_get_available_frequencies(unsigned int cpu) {
-	struct cpufreq_available_frequencies *first = NULL;
-	struct cpufreq_available_frequencies *current = NULL;
-	char one_value[SYSFS_PATH_MAX];
-	char linebuf[MAX_LINE_LEN];
-	unsigned int pos, i;
-	unsigned int len;
+static const char * const sysfs_core_lists[] = {
+	"core_cpus_list", "thread_siblings_list", NULL
+};
 
-	if ( ( len = sysfs_read_file(cpu, "scaling_available_frequencies", linebuf, sizeof(linebuf))) == 0 )
-	{
-		return NULL;
+/* index of the table in topo->freqs, adding it if it is new */
+static unsigned int sysfs_topology_intern(struct sysfs_topology *t,
+					  const unsigned long *frequency, unsigned int count)
+{
+	struct cpufreq_topology *topo = &t->topo;
+	struct cpufreq_topology_freqs *tmp;
+	unsigned int i;
+
+	if (!count)
+		return CPUFREQ_TOPO_UNKNOWN;
+
+	for (i = 0; i < topo->nr_freqs; i++) {
+		if (topo->freqs[i].count == count &&
+		    !memcmp(topo->freqs[i].frequency, frequency, count * sizeof(*frequency))) {
+			topo->freqs[i].nr_policies++;
+			return i;
+		}
 	}
 
-	pos = 0;
-	for ( i = 0; i < len; i++ )
-	{
-		if ( linebuf[i] == ' ' || linebuf[i] == '\n' )
-		{
-			if ( i - pos < 2 )
-				continue;
-			if ( i - pos >= SYSFS_PATH_MAX )
-				goto error_out;
-			if ( current ) {
-				current->next = malloc(sizeof *current );
-				if ( ! current->next )
-					goto error_out;
-				current = current->next;
-			} else {
-				first = malloc(sizeof *first );
-				if ( ! first )
-					goto error_out;
-				current = first;
-			}
-			current->first = first;
-			current->next = NULL;
-
-			memcpy(one_value, linebuf + pos, i - pos);
-			one_value[i - pos] = '\0';
-			if ( sscanf(one_value, "%lu", &current->frequency) != 1 )
-				goto error_out;
-
-			pos = i + 1;
-		}
+	if (topo->nr_freqs == t->freqs_size) {
+		tmp = realloc(topo->freqs, (t->freqs_size + 4) * sizeof(*tmp));
+		if (!tmp)
+			return CPUFREQ_TOPO_UNKNOWN;
+		topo->freqs = tmp;
+		t->freqs_size += 4;
 	}
 
-	return first;
+	topo->freqs[i].nr_policies = 1;
+	topo->freqs[i].count = count;
+	memcpy(topo->freqs[i].frequency, frequency, count * sizeof(*frequency));
+	topo->nr_freqs++;
 
- error_out:
-	while ( first ) {
-		current = first->next;
-		free(first);
-		first = current;
-	}
-	return NULL;
+	return i;
 }
 
-static struct cpufreq_affected_cpus * sysfs_get_cpu_list(unsigned int cpu,
-							 const char *file) {
-	struct cpufreq_affected_cpus *first = NULL;
-	struct cpufreq_affected_cpus *current = NULL;
-	char one_value[SYSFS_PATH_MAX];
+/* fills in the policy of all CPUs in mask, which is first */
+static void sysfs_topology_add_policy(struct cpufreq_ctx *ctx, struct sysfs_topology *t,
+				      unsigned int id, unsigned int first,
+				      const struct cpufreq_cpumask *mask)
+{
+	struct cpufreq_topology *topo = &t->topo;
+	unsigned long frequency[CPUFREQ_MAX_STATES];
 	char linebuf[MAX_LINE_LEN];
-	unsigned int pos, i;
-	unsigned int len;
-
-	if ( ( len = sysfs_read_file(cpu, file, linebuf, sizeof(linebuf))) == 0 )
-	{
-		return NULL;
+	unsigned int len, count = 0, freqs, cpu;
+
+	len = sysfs_read_file(ctx, id, "scaling_available_frequencies", linebuf, sizeof(linebuf));
+	if (len)
+		count = sysfs_parse_ulongs(linebuf, len, frequency, CPUFREQ_MAX_STATES);
+	freqs = sysfs_topology_intern(t, frequency, count);
+
+	topo->policies[topo->nr_policies++] = first;
+	cpufreq_cpumask_for_each(cpu, mask) {
+		topo->cpu[cpu].policy = first;
+		topo->cpu[cpu].freqs = freqs;
+		/* saves the policy locks looking it up again */
+		__atomic_store_n(&ctx->policy_of[cpu], first + 1, __ATOMIC_RELEASE);
 	}
+}
 
-	pos = 0;
-	for ( i = 0; i < len; i++ )
-	{
-		if ( i == len || linebuf[i] == ' ' || linebuf[i] == '\n' )
-		{
-			if ( i - pos  < 1 )
+static void sysfs_topology_policies(struct cpufreq_ctx *ctx, struct sysfs_topology *t)
+{
+	struct cpufreq_topology *topo = &t->topo;
+	struct cpufreq_cpumask mask;
+	char linebuf[MAX_LINE_LEN];
+	unsigned int *policies = NULL;
+	unsigned int nr_policies = 0, len, first, i, j, cpu;
+
+	if (!sysfs_list_dir(ctx, "cpufreq/", "policy", &policies, &nr_policies) &&
+	    nr_policies) {
+		for (i = 0; i < nr_policies; i++) {
+			first = policies[i];
+			len = sysfs_read_file(ctx, CPUFREQ_POLICY(first), "related_cpus",
+					      linebuf, sizeof(linebuf));
+			memset(&mask, 0, sizeof(mask));
+			if (!len || !sysfs_parse_cpulist(linebuf, len, mask.bits,
+							 CPUFREQ_MAX_CPUS, NULL))
 				continue;
-			if ( i - pos >= SYSFS_PATH_MAX )
-				goto error_out;
-			if ( current ) {
-				current->next = malloc(sizeof *current);
-				if ( ! current->next )
-					goto error_out;
-				current = current->next;
-			} else {
-				first = malloc(sizeof *first);
-				if ( ! first )
-					goto error_out;
-				current = first;
-			}
-			current->first = first;
-			current->next = NULL;
-
-			memcpy(one_value, linebuf + pos, i - pos);
-			one_value[i - pos] = '\0';
-
-			if ( sscanf(one_value, "%u", &current->cpu) != 1 )
-				goto error_out;
-
-			pos = i + 1;
+			sysfs_topology_add_policy(ctx, t, CPUFREQ_POLICY(first), first, &mask);
 		}
+		free(policies);
+		return;
 	}
+	free(policies);
 
-	return first;
-
- error_out:
-	while (first) {
-		current = first->next;
-		free(first);
-		first = current;
+	/* older kernels: ask the CPUs which are not known yet */
+	cpufreq_cpumask_for_each(cpu, &topo->present) {
+		if (topo->cpu[cpu].policy != CPUFREQ_TOPO_UNKNOWN)
+			continue;
+		if (!sysfs_get_policy_cpus(ctx, cpu, &mask))
+			continue;
+		sysfs_topology_add_policy(ctx, t, cpu, cpufreq_cpumask_next(&mask, 0), &mask);
 	}
-	return NULL;
-}
 
-struct cpufreq_affected_cpus * sysfs_get_affected_cpus(unsigned int cpu) {
-	return sysfs_get_cpu_list(cpu, "affected_cpus");
+	/* found in CPU order, which need not be the order of the first CPUs */
+	for (i = 1; i < topo->nr_policies; i++) {
+		first = topo->policies[i];
+		for (j = i; j > 0 && topo->policies[j - 1] > first; j--)
+			topo->policies[j] = topo->policies[j - 1];
+		topo->policies[j] = first;
+	}
 }
 
-struct cpufreq_affected_cpus * sysfs_get_related_cpus(unsigned int cpu) {
-	return sysfs_get_cpu_list(cpu, "related_cpus");
+static void sysfs_topology_nodes(struct cpufreq_ctx *ctx, struct cpufreq_topology *topo)
+{
+	struct cpufreq_cpumask mask;
+	char fname[SYSFS_FNAME_MAX];
+	unsigned int *nodes = NULL;
+	unsigned int nr_nodes = 0, i, cpu;
+
+	/* the node directory is next to the cpu directory */
+	if (sysfs_list_dir(ctx, "../node/", "node", &nodes, &nr_nodes))
+		return;
+
+	for (i = 0; i < nr_nodes; i++) {
+		snprintf(fname, sizeof(fname), "../node/node%u/cpulist", nodes[i]);
+		if (!sysfs_topology_mask(ctx, fname, &mask, NULL))
+			continue;
+		cpufreq_cpumask_for_each(cpu, &mask)
+			topo->cpu[cpu].node = nodes[i];
+	}
+	free(nodes);
 }
 
-struct cpufreq_stats * sysfs_get_stats(unsigned int cpu, unsigned long long *total_time) {
-	struct cpufreq_stats *first = NULL;
-	struct cpufreq_stats *current = NULL;
-	char one_value[SYSFS_PATH_MAX];
-	char linebuf[MAX_LINE_LEN];
-	unsigned int pos, i;
-	unsigned int len;
-
-	if ( ( len = sysfs_read_file(cpu, "stats/time_in_state", linebuf, sizeof(linebuf))) == 0 )
+static struct sysfs_topology * sysfs_build_topology(struct cpufreq_ctx *ctx,
+						    const char *online, unsigned int online_len)
+{
+	struct sysfs_topology *t;
+	struct cpufreq_topology *topo;
+	struct cpufreq_cpumask siblings;
+	unsigned int cpu, sibling, id;
+	int overflow;
+
+	t = calloc(1, sizeof(*t));
+	if (!t)
 		return NULL;
+	topo = &t->topo;
+	t->refs = 1;
+	memcpy(t->online, online, online_len);
+	t->online_len = online_len;
+
+	topo->nr_online = sysfs_parse_cpulist(online, online_len, topo->online.bits,
+					      CPUFREQ_MAX_CPUS, &overflow);
+	topo->truncated |= overflow;
+	sysfs_topology_mask(ctx, "present", &topo->present, &overflow);
+	topo->truncated |= overflow;
+	sysfs_topology_mask(ctx, "possible", &topo->possible, &overflow);
+	topo->truncated |= overflow;
+
+	/* the online CPUs have to be present, whatever the files said */
+	cpufreq_cpumask_or(&topo->present, &topo->present, &topo->online);
+	cpufreq_cpumask_or(&topo->possible, &topo->possible, &topo->present);
+	topo->nr_present = cpufreq_cpumask_weight(&topo->present);
+	if (!topo->nr_present) {
+		free(t);
+		return NULL;
+	}
+	cpufreq_cpumask_for_each(cpu, &topo->possible)
+		topo->nr_cpu_ids = cpu + 1;
+
+	for (cpu = 0; cpu < CPUFREQ_MAX_CPUS; cpu++) {
+		topo->cpu[cpu].policy = CPUFREQ_TOPO_UNKNOWN;
+		topo->cpu[cpu].package = CPUFREQ_TOPO_UNKNOWN;
+		topo->cpu[cpu].core = CPUFREQ_TOPO_UNKNOWN;
+		topo->cpu[cpu].node = CPUFREQ_TOPO_UNKNOWN;
+		topo->cpu[cpu].freqs = CPUFREQ_TOPO_UNKNOWN;
+	}
 
-	*total_time = 0;
-	pos = 0;
-	for ( i = 0; i < len; i++ )
-	{
-		if ( i == strlen(linebuf) || linebuf[i] == '\n' )
-		{
-			if ( i - pos < 2 )
-				continue;
-			if ( (i - pos) >= SYSFS_PATH_MAX )
-				goto error_out;
-			if ( current ) {
-				current->next = malloc(sizeof *current );
-				if ( ! current->next )
-					goto error_out;
-				current = current->next;
-			} else {
-				first = malloc(sizeof *first );
-				if ( ! first )
-					goto error_out;
-				current = first;
-			}
-			current->first = first;
-			current->next = NULL;
-
-			memcpy(one_value, linebuf + pos, i - pos);
-			one_value[i - pos] = '\0';
-			if ( sscanf(one_value, "%lu %llu", &current->frequency, &current->time_in_state) != 2 )
-				goto error_out;
-
-			*total_time = *total_time + current->time_in_state;
-			pos = i + 1;
+	/* offline CPUs have no topology directory */
+	cpufreq_cpumask_for_each(cpu, &topo->online) {
+		if (topo->cpu[cpu].package == CPUFREQ_TOPO_UNKNOWN) {
+			id = sysfs_topology_id(ctx, cpu, "physical_package_id",
+					       sysfs_package_lists, &siblings);
+			cpufreq_cpumask_for_each(sibling, &siblings)
+				topo->cpu[sibling].package = id;
+		}
+		if (topo->cpu[cpu].core == CPUFREQ_TOPO_UNKNOWN) {
+			id = sysfs_topology_id(ctx, cpu, "core_id",
+					       sysfs_core_lists, &siblings);
+			cpufreq_cpumask_for_each(sibling, &siblings)
+				topo->cpu[sibling].core = id;
 		}
 	}
 
-	return first;
+	sysfs_topology_nodes(ctx, topo);
+	sysfs_topology_policies(ctx, t);
 
- error_out:
-	while ( first ) {
-		current = first->next;
-		free(first);
-		first = current;
-	}
-	return NULL;
+	return t;
 }
 
-unsigned long sysfs_get_transitions(unsigned int cpu)
+static void sysfs_topology_unref(struct sysfs_topology *t)
 {
-	return sysfs_get_one_value(cpu, STATS_NUM_TRANSITIONS);
+	if (!t || __atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	free(t->topo.freqs);
+	free(t);
 }
 
-static int verify_gov(char *new_gov, char *passed_gov)
+static void sysfs_topology_flush(struct cpufreq_ctx *ctx)
 {
-	unsigned int i, j=0;
-
-	if (!passed_gov || (strlen(passed_gov) > 19))
-		return -EINVAL;
+	sysfs_topology_unref(ctx->topology.current);
+	ctx->topology.current = NULL;
+	if (ctx->topology.online_fd >= 0)
+		close(ctx->topology.online_fd);
+	ctx->topology.online_fd = -1;
+}
 
-	strncpy(new_gov, passed_gov, 20);
-	for (i=0;i<20;i++) {
-		if (j) {
-			new_gov[i] = '\0';
-			continue;
-		}
-		if ((new_gov[i] >= 'a') && (new_gov[i] <= 'z')) {
-			continue;
-		}
-		if ((new_gov[i] >= 'A') && (new_gov[i] <= 'Z')) {
-			continue;
-		}
-		if (new_gov[i] == '-') {
-			continue;
-		}
-		if (new_gov[i] == '_') {
-			continue;
-		}
-		if (new_gov[i] == '\0') {
-			j = 1;
-			continue;
+struct cpufreq_topology * sysfs_get_topology(struct cpufreq_ctx *ctx)
+{
+	char path[SYSFS_PATH_MAX];
+	char online[MAX_LINE_LEN];
+	struct sysfs_topology *t, *rebuilt;
+	ssize_t len = 0;
+
+	pthread_mutex_lock(&ctx->topology.lock);
+
+	if (ctx->topology.online_fd < 0 &&
+	    snprintf(path, sizeof(path), "%sonline", ctx->path_to_cpu) < (int) sizeof(path))
+		ctx->topology.online_fd = open(path, O_RDONLY);
+	if (ctx->topology.online_fd >= 0)
+		len = pread(ctx->topology.online_fd, online, sizeof(online) - 1, 0);
+	if (len < 0)
+		len = 0;
+
+	t = ctx->topology.current;
+	if (!t || t->online_len != len || memcmp(t->online, online, len)) {
+		rebuilt = sysfs_build_topology(ctx, online, len);
+		if (rebuilt) {
+			rebuilt->topo.generation = ++ctx->topology.generation;
+			sysfs_topology_unref(t);
+			ctx->topology.current = t = rebuilt;
 		}
-		return -EINVAL;
 	}
-	new_gov[19] = '\0';
-	return 0;
+	if (t)
+		__atomic_add_fetch(&t->refs, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_unlock(&ctx->topology.lock);
+
+	return t ? &t->topo : NULL;
+}
+
+void sysfs_put_topology(struct cpufreq_topology *topo)
+{
+	sysfs_topology_unref((struct sysfs_topology *) topo);
 }
 
-int sysfs_modify_policy_governor(unsigned int cpu, char *governor)
+static int sysfs_write_policy_governor(struct cpufreq_ctx *ctx, unsigned int cpu,
+				       char *governor)
 {
 	char new_gov[SYSFS_PATH_MAX];
 
@@ -549,34 +2282,83 @@ int sysfs_modify_policy_governor(unsigned int cpu, char *governor)
 	if (verify_gov(new_gov, governor))
 		return -EINVAL;
 
-	return sysfs_write_one_value(cpu, WRITE_SCALING_GOVERNOR, new_gov, strlen(new_gov));
+	return sysfs_write_elided(ctx, cpu, WRITE_SCALING_GOVERNOR, new_gov, strlen(new_gov));
+}
+
+int sysfs_modify_policy_governor(struct cpufreq_ctx *ctx, unsigned int cpu, char *governor)
+{
+	pthread_mutex_t *lock = sysfs_policy_lock(ctx, cpu);
+	int ret;
+
+	ret = sysfs_write_policy_governor(ctx, cpu, governor);
+	pthread_mutex_unlock(lock);
+
+	return ret;
 };
 
-int sysfs_modify_policy_max(unsigned int cpu, unsigned long max_freq)
+int sysfs_modify_policy_max(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long max_freq)
 {
 	char value[SYSFS_PATH_MAX];
+	pthread_mutex_t *lock;
+	int ret;
 
 	snprintf(value, SYSFS_PATH_MAX, "%lu", max_freq);
 
-	return sysfs_write_one_value(cpu, WRITE_SCALING_MAX_FREQ, value, strlen(value));
+	lock = sysfs_policy_lock(ctx, cpu);
+	ret = sysfs_write_elided(ctx, cpu, WRITE_SCALING_MAX_FREQ, value, strlen(value));
+	pthread_mutex_unlock(lock);
+
+	return ret;
 };
 
 
-int sysfs_modify_policy_min(unsigned int cpu, unsigned long min_freq)
+int sysfs_modify_policy_min(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long min_freq)
 {
 	char value[SYSFS_PATH_MAX];
+	pthread_mutex_t *lock;
+	int ret;
 
 	snprintf(value, SYSFS_PATH_MAX, "%lu", min_freq);
 
-	return sysfs_write_one_value(cpu, WRITE_SCALING_MIN_FREQ, value, strlen(value));
+	lock = sysfs_policy_lock(ctx, cpu);
+	ret = sysfs_write_elided(ctx, cpu, WRITE_SCALING_MIN_FREQ, value, strlen(value));
+	pthread_mutex_unlock(lock);
+
+	return ret;
 };
 
 
-int sysfs_set_policy(unsigned int cpu, struct cpufreq_policy *policy)
+static int sysfs_write_policy(struct cpufreq_ctx *ctx, unsigned int cpu,
+			      const char *min, const char *max, const char *gov,
+			      int write_max_first)
+{
+	int ret;
+
+	if (write_max_first) {
+		ret = sysfs_write_elided(ctx, cpu, WRITE_SCALING_MAX_FREQ, max, strlen(max));
+		if (ret)
+			return ret;
+	}
+
+	ret = sysfs_write_elided(ctx, cpu, WRITE_SCALING_MIN_FREQ, min, strlen(min));
+	if (ret)
+		return ret;
+
+	if (!write_max_first) {
+		ret = sysfs_write_elided(ctx, cpu, WRITE_SCALING_MAX_FREQ, max, strlen(max));
+		if (ret)
+			return ret;
+	}
+
+	return sysfs_write_elided(ctx, cpu, WRITE_SCALING_GOVERNOR, gov, strlen(gov));
+}
+
+int sysfs_set_policy(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_policy *policy)
 {
 	char min[SYSFS_PATH_MAX];
 	char max[SYSFS_PATH_MAX];
 	char gov[SYSFS_PATH_MAX];
+	pthread_mutex_t *lock;
 	int ret;
 	unsigned long old_min;
 	int write_max_first;
@@ -593,48 +2375,351 @@ int sysfs_set_policy(unsigned int cpu, struct cpufreq_policy *policy)
 	snprintf(min, SYSFS_PATH_MAX, "%lu", policy->min);
 	snprintf(max, SYSFS_PATH_MAX, "%lu", policy->max);
 
-	old_min = sysfs_get_one_value(cpu, SCALING_MIN_FREQ);
+	lock = sysfs_policy_lock(ctx, cpu);
+
+	old_min = sysfs_get_one_value(ctx, cpu, SCALING_MIN_FREQ);
 	write_max_first = (old_min && (policy->max < old_min) ? 0 : 1);
 
-	if (write_max_first) {
-		ret = sysfs_write_one_value(cpu, WRITE_SCALING_MAX_FREQ, max, strlen(max));
+	ret = sysfs_write_policy(ctx, cpu, min, max, gov, write_max_first);
+	pthread_mutex_unlock(lock);
+
+	return ret;
+}
+
+/* batched policy writes
+ *
+ * Requests are merged into one sysfs_policy_write per policy, keyed by
+ * the lowest of its related_cpus. Each worker holds the policy lock while
+ * it compares, reads the old limits which decide the order of the min
+ * and max writes, and writes.
+ */
+
+#define SYSFS_BATCH_THREADS 16
+
+struct sysfs_policy_write {
+	unsigned int cpu;		/* the CPU the writes go to */
+	unsigned int policy;		/* first CPU of the policy */
+	unsigned long min;
+	unsigned long max;
+	unsigned long old_min;
+	char governor[SYSFS_PATH_MAX];
+	int result;
+};
+
+struct sysfs_policy_batch {
+	struct cpufreq_ctx *ctx;
+	struct sysfs_policy_write *writes;
+	unsigned int nr_writes;
+	unsigned int next;
+};
+
+static int sysfs_apply_policy_write(struct cpufreq_ctx *ctx, struct sysfs_policy_write *w)
+{
+	char min[SYSFS_PATH_MAX];
+	char max[SYSFS_PATH_MAX];
+	int ret, write_max_first;
+
+	snprintf(min, SYSFS_PATH_MAX, "%lu", w->min);
+	snprintf(max, SYSFS_PATH_MAX, "%lu", w->max);
+	write_max_first = !(w->min && w->max && w->old_min && w->max < w->old_min);
+
+	if (w->max && write_max_first) {
+		ret = sysfs_write_noted(ctx, w->cpu, WRITE_SCALING_MAX_FREQ, max, strlen(max));
 		if (ret)
 			return ret;
 	}
 
-	ret = sysfs_write_one_value(cpu, WRITE_SCALING_MIN_FREQ, min, strlen(min));
-	if (ret)
-		return ret;
+	if (w->min) {
+		ret = sysfs_write_noted(ctx, w->cpu, WRITE_SCALING_MIN_FREQ, min, strlen(min));
+		if (ret)
+			return ret;
+	}
 
-	if (!write_max_first) {
-		ret = sysfs_write_one_value(cpu, WRITE_SCALING_MAX_FREQ, max, strlen(max));
+	if (w->max && !write_max_first) {
+		ret = sysfs_write_noted(ctx, w->cpu, WRITE_SCALING_MAX_FREQ, max, strlen(max));
 		if (ret)
 			return ret;
 	}
 
-	return sysfs_write_one_value(cpu, WRITE_SCALING_GOVERNOR, gov, strlen(gov));
+	if (w->governor[0])
+		return sysfs_write_noted(ctx, w->cpu, WRITE_SCALING_GOVERNOR,
+					 w->governor, strlen(w->governor));
+
+	return 0;
+}
+
+/* drop the values which are in place already */
+static void sysfs_elide_policy_write(struct cpufreq_ctx *ctx, struct sysfs_policy_write *w)
+{
+	char value[SYSFS_PATH_MAX];
+
+	snprintf(value, SYSFS_PATH_MAX, "%lu", w->min);
+	if (w->min &&
+	    sysfs_write_unchanged(ctx, w->cpu, WRITE_SCALING_MIN_FREQ, value, strlen(value)))
+		w->min = 0;
+
+	snprintf(value, SYSFS_PATH_MAX, "%lu", w->max);
+	if (w->max &&
+	    sysfs_write_unchanged(ctx, w->cpu, WRITE_SCALING_MAX_FREQ, value, strlen(value)))
+		w->max = 0;
+
+	if (w->governor[0] &&
+	    sysfs_write_unchanged(ctx, w->cpu, WRITE_SCALING_GOVERNOR,
+				  w->governor, strlen(w->governor)))
+		w->governor[0] = '\0';
+}
+
+static void * sysfs_policy_batch_worker(void *data)
+{
+	struct sysfs_policy_batch *batch = data;
+	struct cpufreq_ctx *ctx = batch->ctx;
+	struct sysfs_policy_write *w;
+	pthread_mutex_t *lock;
+	unsigned int i;
+
+	while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) <
+	       batch->nr_writes) {
+		w = &batch->writes[i];
+		if (w->result)
+			continue;
+
+		lock = sysfs_policy_lock(ctx, w->cpu);
+		sysfs_elide_policy_write(ctx, w);
+		if (w->min && w->max)
+			w->old_min = sysfs_get_one_value(ctx, w->cpu, SCALING_MIN_FREQ);
+		w->result = sysfs_apply_policy_write(ctx, w);
+		pthread_mutex_unlock(lock);
+	}
+
+	return NULL;
+}
+
+int sysfs_set_policy_batch(struct cpufreq_ctx *ctx, struct cpufreq_policy_request *reqs, unsigned int nr)
+{
+	struct sysfs_policy_batch batch;
+	struct sysfs_policy_write *w;
+	pthread_t threads[SYSFS_BATCH_THREADS];
+	unsigned int *index;	/* CPU -> writes[] + 1, 0 if not seen yet */
+	unsigned int i, cpu, policy, nr_threads, failed = 0;
+
+	if (!nr)
+		return 0;
+
+	batch.writes = calloc(nr, sizeof(*batch.writes));
+	index = calloc(CPUFREQ_MAX_CPUS, sizeof(*index));
+	if (!batch.writes || !index) {
+		free(batch.writes);
+		free(index);
+		return -ENOMEM;
+	}
+	batch.ctx = ctx;
+	batch.nr_writes = 0;
+	batch.next = 0;
+
+	/* merge the requests per policy */
+	for (i = 0; i < nr; i++) {
+		cpu = reqs[i].cpu;
+		if (cpufreq_policy_nr(cpu) >= CPUFREQ_MAX_CPUS) {
+			reqs[i].policy = cpu;
+			reqs[i].result = -EINVAL;
+			continue;
+		}
+
+		if (cpufreq_is_policy(cpu))
+			policy = cpufreq_policy_nr(cpu);
+		else if (index[cpu])
+			policy = batch.writes[index[cpu] - 1].policy;
+		else
+			policy = sysfs_policy_of(ctx, cpu);
+
+		if (!index[policy]) {
+			w = &batch.writes[batch.nr_writes++];
+			/* write through the policy directory where there
+			 * is one, bypassing the per-CPU symlink */
+			if (cpufreq_is_policy(cpu) ||
+			    !sysfs_cpu_exists(ctx, CPUFREQ_POLICY(policy)))
+				w->cpu = CPUFREQ_POLICY(policy);
+			else
+				w->cpu = cpu;
+			w->policy = policy;
+			index[policy] = batch.nr_writes;
+		}
+		if (!cpufreq_is_policy(cpu))
+			index[cpu] = index[policy];
+		w = &batch.writes[index[policy] - 1];
+
+		if (reqs[i].min)
+			w->min = reqs[i].min;
+		if (reqs[i].max)
+			w->max = reqs[i].max;
+		if (reqs[i].governor &&
+		    verify_gov(w->governor, (char *) reqs[i].governor))
+			w->result = -EINVAL;
+	}
+
+	for (i = 0; i < batch.nr_writes; i++) {
+		w = &batch.writes[i];
+		if (w->min && w->max && w->max < w->min)
+			w->result = -EINVAL;
+	}
+
+	/* the calling thread helps out, and does all the work if no
+	 * thread can be started */
+	nr_threads = batch.nr_writes - 1;
+	if (nr_threads > SYSFS_BATCH_THREADS)
+		nr_threads = SYSFS_BATCH_THREADS;
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_create(&threads[i], NULL, sysfs_policy_batch_worker, &batch))
+			break;
+	nr_threads = i;
+	sysfs_policy_batch_worker(&batch);
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i < nr; i++) {
+		cpu = reqs[i].cpu;
+		if (cpufreq_policy_nr(cpu) >= CPUFREQ_MAX_CPUS)
+			continue;
+		if (cpufreq_is_policy(cpu))
+			w = &batch.writes[index[cpufreq_policy_nr(cpu)] - 1];
+		else
+			w = &batch.writes[index[cpu] - 1];
+		reqs[i].policy = w->policy;
+		reqs[i].result = w->result;
+	}
+
+	for (i = 0; i < batch.nr_writes; i++)
+		if (batch.writes[i].result)
+			failed++;
+	for (i = 0; i < nr; i++)
+		if (cpufreq_policy_nr(reqs[i].cpu) >= CPUFREQ_MAX_CPUS)
+			failed++;
+
+	free(index);
+	free(batch.writes);
+
+	return failed;
 }
 
-int sysfs_set_frequency(unsigned int cpu, unsigned long target_frequency) {
-	struct cpufreq_policy *pol = sysfs_get_policy(cpu);
+int sysfs_set_frequency(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long target_frequency) {
 	char userspace_gov[] = "userspace";
+	char gov[CPUFREQ_NAME_LEN];
 	char freq[SYSFS_PATH_MAX];
+	pthread_mutex_t *lock;
 	int ret;
 
-	if (!pol)
-		return -ENODEV;
+	lock = sysfs_policy_lock(ctx, cpu);
 
-	if (strncmp(pol->governor, userspace_gov, 9) != 0) {
-		ret = sysfs_modify_policy_governor(cpu, userspace_gov);
-		if (ret) {
-			cpufreq_put_policy(pol);
-			return (ret);
-		}
+	if (!sysfs_read_string(ctx, cpu, string_files[SCALING_GOVERNOR], gov, sizeof(gov))) {
+		ret = -ENODEV;
+		goto out;
 	}
 
-	cpufreq_put_policy(pol);
+	if (strncmp(gov, userspace_gov, 9) != 0) {
+		ret = sysfs_write_policy_governor(ctx, cpu, userspace_gov);
+		if (ret)
+			goto out;
+	}
 
 	snprintf(freq, SYSFS_PATH_MAX, "%lu", target_frequency);
 
-	return sysfs_write_one_value(cpu, WRITE_SCALING_SET_SPEED, freq, strlen(freq));
+	ret = sysfs_write_one_value(ctx, cpu, WRITE_SCALING_SET_SPEED, freq, strlen(freq));
+
+ out:
+	pthread_mutex_unlock(lock);
+	return ret;
+}
+
+/* pinned-frequency sessions, see cpufreq_freq_session_begin() */
+
+struct cpufreq_freq_session {
+	struct cpufreq_ctx *ctx;
+	unsigned int cpu;
+	int fd;				/* scaling_setspeed */
+	struct cpufreq_policy_value saved;
+	unsigned long saved_speed;	/* if userspace was in use already */
+};
+
+struct cpufreq_freq_session * sysfs_freq_session_begin(struct cpufreq_ctx *ctx, unsigned int cpu)
+{
+	struct cpufreq_freq_session *session;
+	char userspace_gov[] = "userspace";
+	char path[SYSFS_PATH_MAX];
+	pthread_mutex_t *lock;
+	int ret;
+
+	session = calloc(1, sizeof(*session));
+	if (!session)
+		return NULL;
+	session->ctx = ctx;
+	session->cpu = cpu;
+	session->fd = -1;
+
+	if (sysfs_cpufreq_path(ctx, path, sizeof(path), cpu, write_files[WRITE_SCALING_SET_SPEED]))
+		goto err;
+
+	lock = sysfs_policy_lock(ctx, cpu);
+	ret = sysfs_get_policy_value(ctx, cpu, &session->saved);
+	if (!ret && !strcmp(session->saved.governor, userspace_gov))
+		session->saved_speed = sysfs_get_one_value(ctx, cpu, SCALING_SET_SPEED);
+	else if (!ret)
+		ret = sysfs_write_policy_governor(ctx, cpu, userspace_gov);
+	if (!ret)
+		session->fd = open(path, O_WRONLY);
+	pthread_mutex_unlock(lock);
+
+	if (session->fd < 0)
+		goto restore;
+
+	return session;
+
+ restore:
+	if (!ret && !session->saved_speed)
+		sysfs_modify_policy_governor(ctx, cpu, session->saved.governor);
+ err:
+	free(session);
+	return NULL;
+}
+
+int sysfs_freq_session_set(struct cpufreq_freq_session *session, unsigned long freq)
+{
+	struct cpufreq_ctx *ctx = session->ctx;
+	char buf[24], *pos = buf + sizeof(buf);
+	unsigned long long start = 0;
+	ssize_t len;
+
+	do
+		*--pos = '0' + freq % 10;
+	while (freq /= 10);
+
+	if (ctx->lib_stats)
+		start = sysfs_lib_stats_now();
+	len = pwrite(session->fd, pos, buf + sizeof(buf) - pos, 0);
+	if (ctx->lib_stats)
+		sysfs_lib_stats_account(ctx->lib_stats, write_files[WRITE_SCALING_SET_SPEED], 1,
+					sysfs_lib_stats_now() - start, len > 0 ? len : 0, 1);
+	if (ctx->shm)
+		sysfs_shm_written(ctx->shm);
+
+	if (len != buf + sizeof(buf) - pos)
+		return len < 0 ? -errno : -EIO;
+	return 0;
+}
+
+int sysfs_freq_session_end(struct cpufreq_freq_session *session)
+{
+	struct cpufreq_policy policy;
+	int ret;
+
+	close(session->fd);
+
+	policy.min = session->saved.min;
+	policy.max = session->saved.max;
+	policy.governor = session->saved.governor;
+	ret = sysfs_set_policy(session->ctx, session->cpu, &policy);
+	if (!ret && session->saved_speed)
+		ret = sysfs_set_frequency(session->ctx, session->cpu, session->saved_speed);
+
+	free(session);
+	return ret;
 }
@@ -1,18 +1,111 @@
-extern unsigned int sysfs_cpu_exists(unsigned int cpu);
-extern unsigned long sysfs_get_freq_kernel(unsigned int cpu);
-extern unsigned long sysfs_get_freq_hardware(unsigned int cpu);
-extern unsigned long sysfs_get_transition_latency(unsigned int cpu);
-extern int sysfs_get_hardware_limits(unsigned int cpu, unsigned long *min, unsigned long *max);
-extern char * sysfs_get_driver(unsigned int cpu);
-extern struct cpufreq_policy * sysfs_get_policy(unsigned int cpu);
-extern struct cpufreq_available_governors * sysfs_get_available_governors(unsigned int cpu);
-extern struct cpufreq_available_frequencies * sysfs_get_available_frequencies(unsigned int cpu);
-extern struct cpufreq_affected_cpus * sysfs_get_affected_cpus(unsigned int cpu);
-extern struct cpufreq_affected_cpus * sysfs_get_related_cpus(unsigned int cpu);
-extern struct cpufreq_stats * sysfs_get_stats(unsigned int cpu, unsigned long long *total_time);
-extern unsigned long sysfs_get_transitions(unsigned int cpu);
-extern int sysfs_set_policy(unsigned int cpu, struct cpufreq_policy *policy);
-extern int sysfs_modify_policy_min(unsigned int cpu, unsigned long min_freq);
-extern int sysfs_modify_policy_max(unsigned int cpu, unsigned long max_freq);
-extern int sysfs_modify_policy_governor(unsigned int cpu, char *governor);
-extern int sysfs_set_frequency(unsigned int cpu, unsigned long target_frequency);
+extern struct cpufreq_ctx * sysfs_default_ctx(void);
+extern struct cpufreq_ctx * sysfs_ctx_open(const char *root);
+extern void sysfs_ctx_close(struct cpufreq_ctx *ctx);
+extern int sysfs_set_root(struct cpufreq_ctx *ctx, const char *root);
+extern const char * sysfs_path_to_cpu(struct cpufreq_ctx *ctx);
+extern int sysfs_set_shm(struct cpufreq_ctx *ctx, const char *name);
+extern int sysfs_set_lib_stats(struct cpufreq_ctx *ctx, int enable);
+extern int sysfs_get_lib_stats(struct cpufreq_ctx *ctx, struct cpufreq_lib_stats *stats);
+extern struct cpufreq_publisher * sysfs_publisher_create(const char *name, const char *root, unsigned long interval_us);
+extern int sysfs_publisher_update(struct cpufreq_publisher *pub);
+extern void sysfs_publisher_destroy(struct cpufreq_publisher *pub);
+extern int sysfs_cpufreq_path(struct cpufreq_ctx *ctx, char *path, size_t len, unsigned int cpu, const char *fname);
+extern unsigned int sysfs_read_file(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname, char *buf, size_t buflen);
+
+/* see sysfs_stream_open() */
+
+#define SYSFS_STREAM_BUF	1024
+
+struct sysfs_fd_entry;
+
+struct sysfs_stream {
+	struct cpufreq_ctx *ctx;
+	unsigned int cpu;
+	const char *fname;
+	int fd;
+	struct sysfs_fd_entry *entry;	/* if fd is a cached one */
+	unsigned long long offset;
+	unsigned int start, end;	/* of what buf holds */
+	int eof;
+	int error;			/* negative errno */
+	unsigned int syscalls;
+	unsigned long long start_ns;
+	char buf[SYSFS_STREAM_BUF];
+};
+
+extern int sysfs_stream_open(struct sysfs_stream *stream, struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname);
+extern const char * sysfs_stream_line(struct sysfs_stream *stream, unsigned int *len);
+extern int sysfs_stream_close(struct sysfs_stream *stream);
+
+extern unsigned int sysfs_write_file(struct cpufreq_ctx *ctx, unsigned int cpu, const char *fname, const char *value, size_t len);
+extern int sysfs_cpu_exists(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern unsigned long sysfs_get_freq_kernel(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern unsigned long sysfs_get_freq_hardware(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern unsigned long sysfs_get_cur_freq(struct cpufreq_ctx *ctx, unsigned int cpu, int mode);
+extern int sysfs_set_cur_freq_mode(struct cpufreq_ctx *ctx, int mode);
+extern unsigned long sysfs_get_transition_latency(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern int sysfs_get_hardware_limits(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long *min, unsigned long *max);
+extern char * sysfs_get_driver(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern struct cpufreq_policy * sysfs_get_policy(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern int sysfs_get_policy_value(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_policy_value *policy);
+extern int sysfs_get_governor(struct cpufreq_ctx *ctx, unsigned int cpu, char *governor, size_t len);
+extern struct cpufreq_governor_vector * sysfs_get_governor_vector(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern struct cpufreq_frequency_vector * sysfs_get_frequency_vector(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern struct cpufreq_cpu_vector * sysfs_get_affected_cpu_vector(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern struct cpufreq_cpu_vector * sysfs_get_related_cpu_vector(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern int sysfs_get_affected_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_cpumask *mask);
+extern int sysfs_get_related_cpumask(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_cpumask *mask);
+extern struct cpufreq_stats_table * sysfs_get_stats_table(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_arena *arena);
+extern unsigned long sysfs_get_transitions(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern int sysfs_set_policy(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_policy *policy);
+extern int sysfs_set_policy_batch(struct cpufreq_ctx *ctx, struct cpufreq_policy_request *reqs, unsigned int nr);
+extern int sysfs_set_write_elision(struct cpufreq_ctx *ctx, int mode);
+extern unsigned long sysfs_get_elided_writes(struct cpufreq_ctx *ctx);
+extern int sysfs_modify_policy_min(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long min_freq);
+extern int sysfs_modify_policy_max(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long max_freq);
+extern int sysfs_modify_policy_governor(struct cpufreq_ctx *ctx, unsigned int cpu, char *governor);
+extern int sysfs_set_frequency(struct cpufreq_ctx *ctx, unsigned int cpu, unsigned long target_frequency);
+extern struct cpufreq_freq_session * sysfs_freq_session_begin(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern int sysfs_freq_session_set(struct cpufreq_freq_session *session, unsigned long freq);
+extern int sysfs_freq_session_end(struct cpufreq_freq_session *session);
+extern struct cpufreq_latency_report * sysfs_measure_latency(struct cpufreq_ctx *ctx, unsigned int cpu, int method, const unsigned long *freqs, unsigned int nr_freqs, unsigned int rounds, unsigned long timeout_us);
+extern int sysfs_fd_cache_enable(struct cpufreq_ctx *ctx, unsigned int max_fds);
+extern void sysfs_fd_cache_disable(struct cpufreq_ctx *ctx);
+extern void sysfs_fd_cache_invalidate(struct cpufreq_ctx *ctx, unsigned int cpu);
+extern int sysfs_get_snapshot(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_snapshot *snap);
+extern struct cpufreq_cpu_vector * sysfs_get_policy_vector(struct cpufreq_ctx *ctx);
+extern struct cpufreq_system_snapshot * sysfs_get_system_snapshot(struct cpufreq_ctx *ctx);
+extern int sysfs_refresh_system_snapshot(struct cpufreq_system_snapshot *sys);
+extern void sysfs_put_system_snapshot(struct cpufreq_system_snapshot *sys);
+extern struct cpufreq_stats_sample * sysfs_get_stats_sample(struct cpufreq_ctx *ctx, const unsigned int *cpus, unsigned int nr_cpus);
+extern int sysfs_refresh_stats_sample(struct cpufreq_stats_sample *sample);
+extern void sysfs_put_stats_sample(struct cpufreq_stats_sample *sample);
+extern struct cpufreq_stats_delta * sysfs_get_stats_delta(const struct cpufreq_stats_sample *before, const struct cpufreq_stats_sample *after);
+extern int sysfs_refresh_stats_delta(struct cpufreq_stats_delta *delta, const struct cpufreq_stats_sample *before, const struct cpufreq_stats_sample *after);
+extern void sysfs_put_stats_delta(struct cpufreq_stats_delta *delta);
+extern int sysfs_get_trans_matrix(struct cpufreq_ctx *ctx, unsigned int cpu, struct cpufreq_trans_matrix *matrix);
+extern int sysfs_get_trans_matrix_delta(const struct cpufreq_trans_matrix *before, const struct cpufreq_trans_matrix *after, struct cpufreq_trans_matrix *delta);
+extern unsigned int sysfs_get_trans_hottest(const struct cpufreq_trans_matrix *matrix, struct cpufreq_trans_pair *pairs, unsigned int max);
+extern struct cpufreq_topology * sysfs_get_topology(struct cpufreq_ctx *ctx);
+extern void sysfs_put_topology(struct cpufreq_topology *topo);
+extern struct cpufreq_async * sysfs_async_open(struct cpufreq_ctx *ctx, int backend, unsigned int depth);
+extern int sysfs_async_backend(const struct cpufreq_async *async);
+extern int sysfs_async_read(struct cpufreq_async *async, struct cpufreq_read_request *reqs, unsigned int nr, unsigned int timeout_ms);
+extern void sysfs_async_close(struct cpufreq_async *async);
+extern struct cpufreq_trace * sysfs_trace_open(struct cpufreq_ctx *ctx, const char *save);
+extern struct cpufreq_trace * sysfs_trace_replay(const char *path);
+extern int sysfs_trace_read(struct cpufreq_trace *trace, struct cpufreq_trace_event *events, unsigned int max, int timeout_ms);
+extern unsigned long sysfs_trace_lost(const struct cpufreq_trace *trace);
+extern void sysfs_trace_close(struct cpufreq_trace *trace);
+
+struct sysfs_lib_stats;
+extern unsigned long long sysfs_lib_stats_now(void);
+extern struct sysfs_lib_stats * sysfs_lib_stats_alloc(void);
+extern void sysfs_lib_stats_free(struct sysfs_lib_stats *stats);
+extern void sysfs_lib_stats_account(struct sysfs_lib_stats *stats, const char *fname, int write, unsigned long long ns, unsigned int bytes, unsigned int syscalls);
+extern void sysfs_lib_stats_shm(struct sysfs_lib_stats *stats, const char *fname);
+extern void sysfs_lib_stats_copy(struct sysfs_lib_stats *stats, struct cpufreq_lib_stats *out);
+
+extern int sysfs_msr_open(unsigned int cpu);
+extern int sysfs_msr_read_perf(int fd, unsigned long long *aperf, unsigned long long *mperf);
+extern unsigned long sysfs_msr_get_freq(unsigned int cpu, unsigned long base, unsigned long interval_us);
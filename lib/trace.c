@@ -0,0 +1,745 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * Frequency changes as the kernel reports them, from the
+ * power:cpu_frequency and power:cpu_frequency_limits tracepoints.
+ *
+ * The per-CPU ring buffers are read in their binary form from
+ * per_cpu/cpuN/trace_pipe_raw, one page per read(); the kernel hands a
+ * full page out by swapping it with a spare one. The files are polled,
+ * which only returns once a buffer is buffer_percent full, so an idle
+ * system costs one wakeup per timeout. Whatever the buffers hold then
+ * is read without blocking, decoded and sorted by time into one batch.
+ *
+ * The pages can be saved as read, together with what is needed to
+ * decode them, and replayed later in the same batches.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpufreq.h"
+#include "sysfs.h"
+
+#define TRACE_MAGIC		"CPUFTRC1"
+#define TRACE_PATH_MAX		255
+#define TRACE_TEXT_LEN		4096
+#define TRACE_PAGE_MAX		(1 << 20)
+
+/* the chunk which ends a batch */
+#define TRACE_BATCH_END		0xffffffffU
+
+/* ring buffer events, see include/linux/ring_buffer.h */
+#define RB_TYPE_PADDING		29
+#define RB_TYPE_TIME_EXTEND	30
+#define RB_TYPE_TIME_STAMP	31
+#define RB_TS_SHIFT		27
+#define RB_MISSED_EVENTS	(1U << 31)
+#define RB_MISSED_STORED	(1U << 30)
+
+/*
+ * File layout: the header, then chunks, each one a struct trace_chunk
+ * followed by size bytes read from trace_pipe_raw of the CPU. A chunk
+ * with cpu TRACE_BATCH_END and size 0 ends a batch. All of it is in the
+ * byte order of the recording machine.
+ *
+ * The header holds the layout of the pages and the events; offsets are
+ * in bytes, limits_id is 0 if the kernel lacks cpu_frequency_limits.
+ */
+struct trace_header {
+	char magic[8];
+	uint32_t header_size;
+	uint32_t page_size;
+	uint32_t commit_offset;
+	uint32_t commit_size;
+	uint32_t data_offset;
+	uint32_t freq_id;
+	uint32_t freq_state;
+	uint32_t freq_cpu;
+	uint32_t limits_id;
+	uint32_t limits_min;
+	uint32_t limits_max;
+	uint32_t limits_cpu;
+};
+
+struct trace_chunk {
+	uint32_t cpu;
+	uint32_t size;
+};
+
+/* the order read breaks ties of the timestamp */
+struct trace_item {
+	struct cpufreq_trace_event event;
+	unsigned int seq;
+};
+
+/* event enable files, and tracing_on */
+enum {
+	TRACE_SWITCH_FREQ,
+	TRACE_SWITCH_LIMITS,
+	TRACE_SWITCH_ON,
+	TRACE_SWITCHES
+};
+
+static const char *trace_switch_files[TRACE_SWITCHES] = {
+	[TRACE_SWITCH_FREQ] = "events/power/cpu_frequency/enable",
+	[TRACE_SWITCH_LIMITS] = "events/power/cpu_frequency_limits/enable",
+	[TRACE_SWITCH_ON] = "tracing_on",
+};
+
+struct cpufreq_trace {
+	struct trace_header fmt;
+	char dir[TRACE_PATH_MAX];
+	int was[TRACE_SWITCHES];		/* to restore, -1 if untouched */
+
+	unsigned int nr_cpus;
+	struct pollfd *pfd;			/* of trace_pipe_raw */
+	unsigned int *cpu;
+
+	int replay_fd;				/* -1 unless replaying */
+	int save_fd;				/* -1 unless saving */
+
+	unsigned char *page;
+	struct trace_item *queue;
+	unsigned int queued, head, size;
+	unsigned long lost;
+};
+
+static int trace_read_text(const char *dir, const char *fname, char *buf, size_t len)
+{
+	char path[TRACE_PATH_MAX];
+	ssize_t ret;
+	int fd;
+
+	if (snprintf(path, sizeof(path), "%s/%s", dir, fname) >= (int)sizeof(path))
+		return -ENAMETOOLONG;
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	ret = read(fd, buf, len - 1);
+	close(fd);
+	if (ret < 0)
+		return -errno;
+	buf[ret] = '\0';
+	return 0;
+}
+
+static int trace_write_text(const char *dir, const char *fname, const char *value)
+{
+	char path[TRACE_PATH_MAX];
+	int fd, ret = 0;
+
+	if (snprintf(path, sizeof(path), "%s/%s", dir, fname) >= (int)sizeof(path))
+		return -ENAMETOOLONG;
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	if (write(fd, value, strlen(value)) < 0)
+		ret = -errno;
+	close(fd);
+	return ret;
+}
+
+/* offset and size of a field in a format file, e.g.
+ * "\tfield:u32 state;\toffset:8;\tsize:4;\tsigned:0;" */
+static int trace_field(const char *text, const char *name, uint32_t *offset, uint32_t *size)
+{
+	char key[64];
+	const char *pos;
+
+	snprintf(key, sizeof(key), " %s;", name);
+	pos = strstr(text, key);
+	if (!pos || sscanf(pos + strlen(key), " offset:%u; size:%u;", offset, size) != 2)
+		return -EINVAL;
+	return 0;
+}
+
+static int trace_u32_field(const char *text, const char *name, uint32_t *offset)
+{
+	uint32_t size;
+
+	if (trace_field(text, name, offset, &size) || size != sizeof(uint32_t))
+		return -EINVAL;
+	return 0;
+}
+
+static int trace_event_id(const char *text, uint32_t *id)
+{
+	const char *pos = strstr(text, "ID:");
+
+	if (!pos || sscanf(pos + 3, "%u", id) != 1 || !*id)
+		return -EINVAL;
+	return 0;
+}
+
+static int trace_read_formats(const char *dir, struct trace_header *fmt)
+{
+	char text[TRACE_TEXT_LEN];
+	uint32_t size;
+
+	memset(fmt, 0, sizeof(*fmt));
+	memcpy(fmt->magic, TRACE_MAGIC, sizeof(fmt->magic));
+	fmt->header_size = sizeof(*fmt);
+
+	if (trace_read_text(dir, "events/header_page", text, sizeof(text)) ||
+	    trace_field(text, "commit", &fmt->commit_offset, &fmt->commit_size) ||
+	    trace_field(text, "data", &fmt->data_offset, &size))
+		return -EINVAL;
+	if (fmt->commit_size != 4 && fmt->commit_size != 8)
+		return -EINVAL;
+	fmt->page_size = fmt->data_offset + size;
+
+	if (trace_read_text(dir, "events/power/cpu_frequency/format", text, sizeof(text)) ||
+	    trace_event_id(text, &fmt->freq_id) ||
+	    trace_u32_field(text, "state", &fmt->freq_state) ||
+	    trace_u32_field(text, "cpu_id", &fmt->freq_cpu))
+		return -EINVAL;
+
+	/* older kernels only have the first one */
+	if (trace_read_text(dir, "events/power/cpu_frequency_limits/format", text, sizeof(text)) ||
+	    trace_event_id(text, &fmt->limits_id) ||
+	    trace_u32_field(text, "min_freq", &fmt->limits_min) ||
+	    trace_u32_field(text, "max_freq", &fmt->limits_max) ||
+	    trace_u32_field(text, "cpu_id", &fmt->limits_cpu))
+		fmt->limits_id = 0;
+
+	return 0;
+}
+
+static int trace_queue_grow(struct cpufreq_trace *trace)
+{
+	struct trace_item *tmp;
+	unsigned int size = trace->size ? trace->size * 2 : 256;
+
+	tmp = realloc(trace->queue, size * sizeof(*tmp));
+	if (!tmp)
+		return -ENOMEM;
+	trace->queue = tmp;
+	trace->size = size;
+	return 0;
+}
+
+static uint32_t trace_u32(const unsigned char *pos)
+{
+	uint32_t value;
+
+	memcpy(&value, pos, sizeof(value));
+	return value;
+}
+
+static unsigned long long trace_word(const unsigned char *pos, unsigned int size)
+{
+	uint64_t value;
+
+	if (size == sizeof(uint32_t))
+		return trace_u32(pos);
+	memcpy(&value, pos, sizeof(value));
+	return value;
+}
+
+static int trace_queue_event(struct cpufreq_trace *trace, unsigned long long timestamp,
+			     const unsigned char *data, unsigned int len)
+{
+	const struct trace_header *fmt = &trace->fmt;
+	struct cpufreq_trace_event *event;
+	uint16_t type;
+
+	/* common_type */
+	if (len < sizeof(type))
+		return 0;
+	memcpy(&type, data, sizeof(type));
+
+	/* written so that offsets from a replayed file can't overflow */
+	if (type == fmt->freq_id) {
+		if (len < 4 || fmt->freq_state > len - 4 || fmt->freq_cpu > len - 4)
+			return 0;
+	} else if (fmt->limits_id && type == fmt->limits_id) {
+		if (len < 4 || fmt->limits_min > len - 4 || fmt->limits_max > len - 4 ||
+		    fmt->limits_cpu > len - 4)
+			return 0;
+	} else
+		return 0;
+
+	if (trace->queued == trace->size && trace_queue_grow(trace))
+		return -ENOMEM;
+
+	trace->queue[trace->queued].seq = trace->queued;
+	event = &trace->queue[trace->queued++].event;
+	memset(event, 0, sizeof(*event));
+	event->timestamp = timestamp;
+	if (type == fmt->freq_id) {
+		event->type = CPUFREQ_TRACE_FREQUENCY;
+		event->cpu = trace_u32(data + fmt->freq_cpu);
+		event->freq = trace_u32(data + fmt->freq_state);
+	} else {
+		event->type = CPUFREQ_TRACE_LIMITS;
+		event->cpu = trace_u32(data + fmt->limits_cpu);
+		event->min = trace_u32(data + fmt->limits_min);
+		event->max = trace_u32(data + fmt->limits_max);
+	}
+	return 0;
+}
+
+/* decode one page as read from trace_pipe_raw */
+static int trace_parse_page(struct cpufreq_trace *trace, const unsigned char *page, unsigned int size)
+{
+	const struct trace_header *fmt = &trace->fmt;
+	const unsigned char *pos, *end;
+	unsigned long long timestamp, commit;
+	uint32_t header, type_len, delta, len;
+	int ret;
+
+	if (size < fmt->data_offset)
+		return 0;
+
+	memcpy(&timestamp, page, sizeof(timestamp));
+	commit = trace_word(page + fmt->commit_offset, fmt->commit_size);
+	len = commit & ~(RB_MISSED_EVENTS | RB_MISSED_STORED);
+	if (len > size - fmt->data_offset)
+		len = size - fmt->data_offset;
+
+	/* events were lost before this page, and maybe counted after it */
+	if (commit & RB_MISSED_EVENTS) {
+		if ((commit & RB_MISSED_STORED) &&
+		    fmt->data_offset + len + fmt->commit_size <= size)
+			trace->lost += trace_word(page + fmt->data_offset + len, fmt->commit_size);
+		else
+			trace->lost++;
+	}
+
+	pos = page + fmt->data_offset;
+	end = pos + len;
+	while (pos + sizeof(header) <= end) {
+		header = trace_u32(pos);
+		type_len = header & 0x1f;
+		delta = header >> 5;
+
+		switch (type_len) {
+		case RB_TYPE_PADDING:
+			/* no delta: nothing follows on this page */
+			if (!delta || pos + 8 > end)
+				return 0;
+			len = trace_u32(pos + 4);
+			if (len > end - pos - 4)
+				return 0;
+			timestamp += delta;
+			pos += 4 + len;
+			break;
+		case RB_TYPE_TIME_EXTEND:
+			if (pos + 8 > end)
+				return 0;
+			timestamp += ((unsigned long long) trace_u32(pos + 4) << RB_TS_SHIFT) + delta;
+			pos += 8;
+			break;
+		case RB_TYPE_TIME_STAMP:
+			if (pos + 8 > end)
+				return 0;
+			timestamp = (timestamp & ~((1ULL << (32 + RB_TS_SHIFT)) - 1)) |
+				    ((unsigned long long) trace_u32(pos + 4) << RB_TS_SHIFT) | delta;
+			pos += 8;
+			break;
+		case 0:
+			if (pos + 8 > end)
+				return 0;
+			len = trace_u32(pos + 4);
+			if (len < 4 || len > end - pos - 4)
+				return 0;
+			timestamp += delta;
+			ret = trace_queue_event(trace, timestamp, pos + 8, len - 4);
+			if (ret)
+				return ret;
+			pos += 4 + len;
+			break;
+		default:
+			if (pos + 4 + type_len * 4 > end)
+				return 0;
+			timestamp += delta;
+			ret = trace_queue_event(trace, timestamp, pos + 4, type_len * 4);
+			if (ret)
+				return ret;
+			pos += 4 + type_len * 4;
+			break;
+		}
+	}
+	return 0;
+}
+
+static int trace_write_all(int fd, const void *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return ret ? -errno : -EIO;
+		buf = (const char *) buf + ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/* returns 0 at the end of the file before anything was read */
+static ssize_t trace_read_all(int fd, void *buf, size_t len)
+{
+	size_t done = 0;
+	ssize_t ret;
+
+	while (done < len) {
+		ret = read(fd, (char *) buf + done, len - done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return -errno;
+		if (!ret)
+			return done ? -EIO : 0;
+		done += ret;
+	}
+	return done;
+}
+
+static int trace_save_chunk(struct cpufreq_trace *trace, unsigned int cpu,
+			    const unsigned char *page, unsigned int size)
+{
+	struct trace_chunk chunk = { .cpu = cpu, .size = size };
+	int ret;
+
+	ret = trace_write_all(trace->save_fd, &chunk, sizeof(chunk));
+	if (!ret && size)
+		ret = trace_write_all(trace->save_fd, page, size);
+	return ret;
+}
+
+static int trace_live_batch(struct cpufreq_trace *trace, int timeout_ms)
+{
+	unsigned int i, chunks = 0;
+	ssize_t len;
+	int ret;
+
+	if (poll(trace->pfd, trace->nr_cpus, timeout_ms) < 0)
+		return -errno;
+
+	for (i = 0; i < trace->nr_cpus; i++) {
+		while ((len = read(trace->pfd[i].fd, trace->page, trace->fmt.page_size)) > 0) {
+			chunks++;
+			if (trace->save_fd >= 0) {
+				ret = trace_save_chunk(trace, trace->cpu[i], trace->page, len);
+				if (ret)
+					return ret;
+			}
+			ret = trace_parse_page(trace, trace->page, len);
+			if (ret)
+				return ret;
+		}
+		if (len < 0 && errno != EAGAIN && errno != EINTR)
+			return -errno;
+	}
+
+	if (chunks && trace->save_fd >= 0)
+		return trace_save_chunk(trace, TRACE_BATCH_END, NULL, 0);
+	return 0;
+}
+
+static int trace_replay_batch(struct cpufreq_trace *trace)
+{
+	struct trace_chunk chunk;
+	unsigned int chunks = 0;
+	ssize_t len;
+	int ret;
+
+	for (;;) {
+		len = trace_read_all(trace->replay_fd, &chunk, sizeof(chunk));
+		if (len < 0)
+			return len;
+		if (!len)
+			return chunks ? 0 : -ENODATA;
+		if (chunk.cpu == TRACE_BATCH_END)
+			return 0;
+		if (chunk.size > trace->fmt.page_size)
+			return -EINVAL;
+
+		len = trace_read_all(trace->replay_fd, trace->page, chunk.size);
+		if (len != (ssize_t) chunk.size)
+			return len < 0 ? len : -EIO;
+		chunks++;
+		ret = trace_parse_page(trace, trace->page, chunk.size);
+		if (ret)
+			return ret;
+	}
+}
+
+static int trace_cmp_item(const void *a, const void *b)
+{
+	const struct trace_item *x = a, *y = b;
+
+	if (x->event.timestamp != y->event.timestamp)
+		return x->event.timestamp < y->event.timestamp ? -1 : 1;
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+int sysfs_trace_read(struct cpufreq_trace *trace, struct cpufreq_trace_event *events,
+		     unsigned int max, int timeout_ms)
+{
+	unsigned int i;
+	int ret;
+
+	if (trace->head == trace->queued) {
+		trace->head = trace->queued = 0;
+		if (trace->replay_fd >= 0)
+			ret = trace_replay_batch(trace);
+		else
+			ret = trace_live_batch(trace, timeout_ms);
+		if (ret)
+			return ret;
+		qsort(trace->queue, trace->queued, sizeof(*trace->queue), trace_cmp_item);
+	}
+
+	for (i = 0; i < max && trace->head < trace->queued; i++)
+		events[i] = trace->queue[trace->head++].event;
+	return i;
+}
+
+unsigned long sysfs_trace_lost(const struct cpufreq_trace *trace)
+{
+	return trace->lost;
+}
+
+void sysfs_trace_close(struct cpufreq_trace *trace)
+{
+	char value[16];
+	unsigned int i;
+
+	if (!trace)
+		return;
+
+	for (i = 0; i < TRACE_SWITCHES; i++) {
+		if (trace->was[i] < 0)
+			continue;
+		snprintf(value, sizeof(value), "%d\n", trace->was[i]);
+		trace_write_text(trace->dir, trace_switch_files[i], value);
+	}
+	for (i = 0; i < trace->nr_cpus; i++)
+		close(trace->pfd[i].fd);
+	if (trace->replay_fd >= 0)
+		close(trace->replay_fd);
+	if (trace->save_fd >= 0)
+		close(trace->save_fd);
+
+	free(trace->pfd);
+	free(trace->cpu);
+	free(trace->page);
+	free(trace->queue);
+	free(trace);
+}
+
+static struct cpufreq_trace * trace_alloc(void)
+{
+	struct cpufreq_trace *trace;
+	unsigned int i;
+
+	trace = calloc(1, sizeof(*trace));
+	if (!trace)
+		return NULL;
+	for (i = 0; i < TRACE_SWITCHES; i++)
+		trace->was[i] = -1;
+	trace->replay_fd = -1;
+	trace->save_fd = -1;
+	return trace;
+}
+
+/* tracefs below the sysfs root of the context, or where debugfs has it */
+static int trace_find_dir(struct cpufreq_ctx *ctx, char *dir, size_t len)
+{
+	static const char *subdirs[] = { "kernel/tracing", "kernel/debug/tracing" };
+	static const char cpu_subdir[] = "devices/system/cpu/";
+	const char *cpu_dir = sysfs_path_to_cpu(ctx);
+	char text[TRACE_TEXT_LEN];
+	size_t root_len = strlen(cpu_dir);
+	unsigned int i;
+
+	if (root_len < sizeof(cpu_subdir) - 1 ||
+	    strcmp(cpu_dir + root_len - (sizeof(cpu_subdir) - 1), cpu_subdir))
+		return -EINVAL;
+	root_len -= sizeof(cpu_subdir) - 1;
+
+	for (i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); i++) {
+		if (snprintf(dir, len, "%.*s%s", (int) root_len, cpu_dir, subdirs[i]) >= (int) len)
+			return -ENAMETOOLONG;
+		if (!trace_read_text(dir, "events/header_page", text, sizeof(text)))
+			return 0;
+	}
+	return -ENOENT;
+}
+
+static int trace_open_cpus(struct cpufreq_trace *trace)
+{
+	char path[TRACE_PATH_MAX];
+	struct dirent *entry;
+	unsigned int cpu, size = 0;
+	DIR *dir;
+	void *tmp;
+	int fd, ret = 0;
+
+	if (snprintf(path, sizeof(path), "%s/per_cpu", trace->dir) >= (int)sizeof(path))
+		return -ENAMETOOLONG;
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+
+	while ((entry = readdir(dir))) {
+		if (sscanf(entry->d_name, "cpu%u", &cpu) != 1)
+			continue;
+		if (trace->nr_cpus == size) {
+			size = size ? size * 2 : 16;
+			tmp = realloc(trace->pfd, size * sizeof(*trace->pfd));
+			if (!tmp) {
+				ret = -ENOMEM;
+				break;
+			}
+			trace->pfd = tmp;
+			tmp = realloc(trace->cpu, size * sizeof(*trace->cpu));
+			if (!tmp) {
+				ret = -ENOMEM;
+				break;
+			}
+			trace->cpu = tmp;
+		}
+		if (snprintf(path, sizeof(path), "%s/per_cpu/%s/trace_pipe_raw",
+			     trace->dir, entry->d_name) >= (int)sizeof(path)) {
+			ret = -ENAMETOOLONG;
+			break;
+		}
+		fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0) {
+			ret = -errno;
+			break;
+		}
+		trace->pfd[trace->nr_cpus].fd = fd;
+		trace->pfd[trace->nr_cpus].events = POLLIN;
+		trace->cpu[trace->nr_cpus++] = cpu;
+	}
+	closedir(dir);
+
+	return ret ? ret : (trace->nr_cpus ? 0 : -ENOENT);
+}
+
+static int trace_switch_on(struct cpufreq_trace *trace, unsigned int which)
+{
+	char text[16];
+	int was;
+
+	if (trace_read_text(trace->dir, trace_switch_files[which], text, sizeof(text)) ||
+	    sscanf(text, "%d", &was) != 1)
+		return -EINVAL;
+	if (was == 1)
+		return 0;
+	if (trace_write_text(trace->dir, trace_switch_files[which], "1\n"))
+		return -EPERM;
+	trace->was[which] = was;
+	return 0;
+}
+
+struct cpufreq_trace * sysfs_trace_open(struct cpufreq_ctx *ctx, const char *save)
+{
+	struct cpufreq_trace *trace;
+
+	trace = trace_alloc();
+	if (!trace)
+		return NULL;
+
+	if (trace_find_dir(ctx, trace->dir, sizeof(trace->dir)) ||
+	    trace_read_formats(trace->dir, &trace->fmt) ||
+	    trace->fmt.page_size > TRACE_PAGE_MAX)
+		goto error_out;
+
+	trace->page = malloc(trace->fmt.page_size);
+	if (!trace->page || trace_open_cpus(trace))
+		goto error_out;
+
+	if (save) {
+		trace->save_fd = open(save, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (trace->save_fd < 0 ||
+		    trace_write_all(trace->save_fd, &trace->fmt, sizeof(trace->fmt)))
+			goto error_out;
+	}
+
+	/* the buffers are open already, so nothing gets lost */
+	if (trace_switch_on(trace, TRACE_SWITCH_FREQ) ||
+	    (trace->fmt.limits_id && trace_switch_on(trace, TRACE_SWITCH_LIMITS)) ||
+	    trace_switch_on(trace, TRACE_SWITCH_ON))
+		goto error_out;
+
+	return trace;
+
+ error_out:
+	sysfs_trace_close(trace);
+	return NULL;
+}
+
+/* the header of a replayed file comes from anywhere, so check that
+ * every offset in it stays within a page */
+static int trace_header_valid(const struct trace_header *fmt)
+{
+	if (memcmp(fmt->magic, TRACE_MAGIC, sizeof(fmt->magic)) ||
+	    fmt->header_size < sizeof(*fmt) ||
+	    fmt->page_size < 4 || fmt->page_size > TRACE_PAGE_MAX ||
+	    fmt->data_offset > fmt->page_size ||
+	    (fmt->commit_size != 4 && fmt->commit_size != 8))
+		return 0;
+
+	/* the page timestamp comes first, then the commit word */
+	if (fmt->commit_offset < sizeof(unsigned long long) ||
+	    fmt->commit_offset > fmt->data_offset ||
+	    fmt->commit_size > fmt->data_offset - fmt->commit_offset)
+		return 0;
+
+	if (fmt->freq_state > fmt->page_size - 4 ||
+	    fmt->freq_cpu > fmt->page_size - 4 ||
+	    fmt->limits_min > fmt->page_size - 4 ||
+	    fmt->limits_max > fmt->page_size - 4 ||
+	    fmt->limits_cpu > fmt->page_size - 4)
+		return 0;
+
+	return 1;
+}
+
+struct cpufreq_trace * sysfs_trace_replay(const char *path)
+{
+	struct cpufreq_trace *trace;
+
+	trace = trace_alloc();
+	if (!trace)
+		return NULL;
+
+	trace->replay_fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (trace->replay_fd < 0 ||
+	    trace_read_all(trace->replay_fd, &trace->fmt, sizeof(trace->fmt)) != sizeof(trace->fmt) ||
+	    !trace_header_valid(&trace->fmt))
+		goto error_out;
+
+	/* a later version may have added to the header */
+	if (lseek(trace->replay_fd, trace->fmt.header_size, SEEK_SET) < 0)
+		goto error_out;
+
+	trace->page = malloc(trace->fmt.page_size);
+	if (!trace->page)
+		goto error_out;
+
+	return trace;
+
+ error_out:
+	sysfs_trace_close(trace);
+	return NULL;
+}
@@ -296,13 +296,27 @@ static int do_measure_all_cpus(int sleep_time, int once)
 	struct timeval start_time, current_time, diff_time, C0_time, CX_time;
 	uint64_t current_aperf, current_mperf, mperf_diff, aperf_diff;
 	struct avg_perf_cpu_info *cpu_list;
+	struct cpufreq_topology *topo;
 
-	cpus = sysconf(_SC_NPROCESSORS_CONF);
+	topo = cpufreq_get_topology();
+	if (!topo) {
+		fprintf(stderr, "Couldn't determine the CPUs of this system\n");
+		return -ENODEV;
+	}
+	cpus = topo->nr_cpu_ids;
+	if (topo->truncated)
+		fprintf(stderr, "Only the first %u CPUs are measured\n", CPUFREQ_MAX_CPUS);
 
 	cpu_list = (struct avg_perf_cpu_info*)
-		malloc(cpus * sizeof (struct avg_perf_cpu_info));
+		calloc(cpus, sizeof (struct avg_perf_cpu_info));
+	if (!cpu_list) {
+		cpufreq_put_topology(topo);
+		return -ENOMEM;
+	}
 
 	for (cpu = 0; cpu < cpus; cpu++) {
+		if (!cpufreq_cpumask_isset(&topo->online, cpu))
+			continue;
 		ret = get_measure_start_info(cpu, &cpu_list[cpu]);
 		if   (ret)
 		continue;
@@ -320,14 +334,36 @@ static int do_measure_all_cpus(int sleep_time, int once)
 		memcpy(&start_time, &current_time,
 		       sizeof(struct timeval));
 
+		/* only re-read if CPUs went on- or offline meanwhile */
+		cpufreq_put_topology(topo);
+		topo = cpufreq_get_topology();
+		if (!topo)
+			break;
+
 		for (cpu = 0; cpu < cpus; cpu++) {
+			if (!cpufreq_cpumask_isset(&topo->present, cpu))
+				continue;
+
+			/* came online meanwhile: nothing to compare with
+			 * before the next round */
+			if (!cpu_list[cpu].is_valid &&
+			    cpufreq_cpumask_isset(&topo->online, cpu) &&
+			    !get_measure_start_info(cpu, &cpu_list[cpu]))
+				continue;
 
 			printf("%.3u\t", cpu);
 
+			if (!cpufreq_cpumask_isset(&topo->online, cpu)) {
+				cpu_list[cpu].is_valid = 0;
+				printf("[offline]\n");
+				continue;
+			}
+
 			ret = get_aperf_mperf(cpu, &current_aperf,
 					      &current_mperf);
 
 			if ((ret < 0) || !cpu_list[cpu].is_valid) {
+				cpu_list[cpu].is_valid = 0;
 				printf("[offline]\n");
 				continue;
 			}
@@ -350,6 +386,9 @@ static int do_measure_all_cpus(int sleep_time, int once)
 			break;
 		printf("\n");
 	}
+
+	cpufreq_put_topology(topo);
+	free(cpu_list);
 	return 0;
 }
 
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <locale.h>
+#include <signal.h>
 
 #include <getopt.h>
 
@@ -30,68 +31,43 @@
 #define textdomain(String)
 #endif
 
-#define LINE_LEN 10
-
-static unsigned int count_cpus(void)
-{
-	FILE *fp;
-	char value[LINE_LEN];
-	unsigned int ret = 0;
-	unsigned int cpunr = 0;
-
-	fp = fopen("/proc/stat", "r");
-	if(!fp) {
-		printf(gettext("Couldn't count the number of CPUs (%s: %s), assuming 1\n"), "/proc/stat", strerror(errno));
-		return 1;
-	}
-
-	while (!feof(fp)) {
-		if (!fgets(value, LINE_LEN, fp))
-			continue;
-		value[LINE_LEN - 1] = '\0';
-		if (strlen(value) < (LINE_LEN - 2))
-			continue;
-		if (strstr(value, "cpu "))
-			continue;
-		if (sscanf(value, "cpu%d ", &cpunr) != 1)
-			continue;
-		if (cpunr > ret)
-			ret = cpunr;
-	}
-	fclose(fp);
-
-	/* cpu count starts from 0, on error return 1 (UP) */
-	return (ret+1);
-}
-
-
 static void proc_cpufreq_output(void)
 {
-	unsigned int cpu, nr_cpus;
-	struct cpufreq_policy *policy;
+	unsigned int cpu;
+	struct cpufreq_topology *topo;
+	struct cpufreq_policy_value policy;
 	unsigned int min_pctg = 0;
 	unsigned int max_pctg = 0;
 	unsigned long min, max;
 
 	printf(gettext("          minimum CPU frequency  -  maximum CPU frequency  -  governor\n"));
 
-	nr_cpus = count_cpus();
-	for (cpu=0; cpu < nr_cpus; cpu++) {
-		policy = cpufreq_get_policy(cpu);
-		if (!policy)
+	topo = cpufreq_get_topology();
+	if (!topo) {
+		printf(gettext("Couldn't determine the CPUs of this system\n"));
+		return;
+	}
+
+	for (cpu = 0; cpu < topo->nr_cpu_ids; cpu++) {
+		if (!cpufreq_cpumask_isset(&topo->online, cpu) ||
+		    topo->cpu[cpu].policy == CPUFREQ_TOPO_UNKNOWN)
+			continue;
+		if (cpufreq_get_policy_value(cpu, &policy))
 			continue;
 
 		if (cpufreq_get_hardware_limits(cpu, &min, &max)) {
 			max = 0;
 		} else {
-			min_pctg = (policy->min * 100) / max;
-			max_pctg = (policy->max * 100) / max;
+			min_pctg = (policy.min * 100) / max;
+			max_pctg = (policy.max * 100) / max;
 		}
 		printf("CPU%3d    %9lu kHz (%3d %%)  -  %9lu kHz (%3d %%)  -  %s\n",
-		       cpu , policy->min, max ? min_pctg : 0, policy->max, max ? max_pctg : 0, policy->governor);
-
-		cpufreq_put_policy(policy);
+		       cpu , policy.min, max ? min_pctg : 0, policy.max, max ? max_pctg : 0, policy.governor);
 	}
+	if (topo->truncated)
+		printf(gettext("(only the first %u CPUs are shown)\n"), CPUFREQ_MAX_CPUS);
+
+	cpufreq_put_topology(topo);
 }
 
 static void print_speed(unsigned long speed)
@@ -148,157 +124,182 @@ static void print_duration(unsigned long duration)
 	return;
 }
 
-static void debug_output_one(unsigned int cpu)
+static void print_cpumask(const struct cpufreq_cpumask *mask)
 {
-	char *driver;
-	struct cpufreq_affected_cpus *cpus;
-	struct cpufreq_available_frequencies *freqs;
-	unsigned long min, max, freq_kernel, freq_hardware;
-	unsigned long total_trans, latency;
-	unsigned long long total_time;
-	struct cpufreq_policy *policy;
-	struct cpufreq_available_governors * governors;
-	struct cpufreq_stats *stats;
+	unsigned int cpu;
+	const char *sep = "";
 
-	if (cpufreq_cpu_exists(cpu)) {
-		printf(gettext ("couldn't analyze CPU %d as it doesn't seem to be present\n"), cpu);
-		return;
+	cpufreq_cpumask_for_each(cpu, mask) {
+		printf("%s%u", sep, cpu);
+		sep = " ";
 	}
+	printf("\n");
+}
 
-	printf(gettext ("analyzing CPU %d:\n"), cpu);
+static void debug_output_snapshot(unsigned int cpu, const struct cpufreq_snapshot *snap,
+				  int freq_mode)
+{
+	unsigned int i;
 
-	freq_kernel = cpufreq_get_freq_kernel(cpu);
-	freq_hardware = cpufreq_get_freq_hardware(cpu);
+	printf(gettext ("analyzing CPU %d:\n"), cpu);
 
-	driver = cpufreq_get_driver(cpu);
-	if (!driver) {
+	if (!(snap->valid & CPUFREQ_SNAP_DRIVER)) {
 		printf(gettext ("  no or unknown cpufreq driver is active on this CPU\n"));
 	} else {
-		printf(gettext ("  driver: %s\n"), driver);
-		cpufreq_put_driver(driver);
+		printf(gettext ("  driver: %s\n"), snap->driver);
 	}
 
-	cpus = cpufreq_get_related_cpus(cpu);
-	if (cpus) {
+	if (snap->valid & CPUFREQ_SNAP_RELATED_CPUS) {
 		printf(gettext ("  CPUs which run at the same hardware frequency: "));
-		while (cpus->next) {
-			printf("%d ", cpus->cpu);
-			cpus = cpus->next;
-		}
-		printf("%d\n", cpus->cpu);
-		cpufreq_put_related_cpus(cpus);
+		print_cpumask(&snap->related_cpus);
 	}
 
-	cpus = cpufreq_get_affected_cpus(cpu);
-	if (cpus) {
+	if (snap->valid & CPUFREQ_SNAP_AFFECTED_CPUS) {
 		printf(gettext ("  CPUs which need to have their frequency coordinated by software: "));
-		while (cpus->next) {
-			printf("%d ", cpus->cpu);
-			cpus = cpus->next;
-		}
-		printf("%d\n", cpus->cpu);
-		cpufreq_put_affected_cpus(cpus);
+		print_cpumask(&snap->affected_cpus);
 	}
 
-	latency = cpufreq_get_transition_latency(cpu);
-	if (latency) {
+	if (snap->valid & CPUFREQ_SNAP_LATENCY) {
 		printf(gettext ("  maximum transition latency: "));
-		print_duration(latency);
+		print_duration(snap->latency);
 		printf(".\n");
 	}
 
-	if (!(cpufreq_get_hardware_limits(cpu, &min, &max))) {
+	if (snap->valid & CPUFREQ_SNAP_HW_LIMITS) {
 		printf(gettext ("  hardware limits: "));
-		print_speed(min);
+		print_speed(snap->hw_min);
 		printf(" - ");
-		print_speed(max);
+		print_speed(snap->hw_max);
 		printf("\n");
 	}
 
-	freqs = cpufreq_get_available_frequencies(cpu);
-	if (freqs) {
+	if (snap->valid & CPUFREQ_SNAP_FREQUENCIES) {
 		printf(gettext ("  available frequency steps: "));
-		while (freqs->next) {
-			print_speed(freqs->frequency);
-			printf(", ");
-			freqs = freqs->next;
+		for (i = 0; i < snap->nr_frequencies; i++) {
+			if (i)
+				printf(", ");
+			print_speed(snap->frequencies[i]);
 		}
-		print_speed(freqs->frequency);
 		printf("\n");
-		cpufreq_put_available_frequencies(freqs);
 	}
 
-	governors = cpufreq_get_available_governors(cpu);
-	if (governors) {
+	if (snap->valid & CPUFREQ_SNAP_GOVERNORS) {
 		printf(gettext ("  available cpufreq governors: "));
-		while (governors->next) {
-			printf("%s, ", governors->governor);
-			governors = governors->next;
-		}
-		printf("%s\n", governors->governor);
-		cpufreq_put_available_governors(governors);
+		for (i = 0; i < snap->nr_governors; i++)
+			printf(i ? ", %s" : "%s", snap->governors[i]);
+		printf("\n");
 	}
 
-	policy = cpufreq_get_policy(cpu);
-	if (policy) {
+	if (snap->valid & CPUFREQ_SNAP_POLICY) {
 		printf(gettext ("  current policy: frequency should be within "));
-		print_speed(policy->min);
+		print_speed(snap->policy_min);
 		printf(gettext (" and "));
-		print_speed(policy->max);
+		print_speed(snap->policy_max);
 
 		printf(".\n                  ");
 		printf(gettext ("The governor \"%s\" may"
 		       " decide which speed to use\n                  within this range.\n"),
-		       policy->governor);
-		cpufreq_put_policy(policy);
+		       snap->governor);
 	}
 
-	if (freq_kernel || freq_hardware) {
+	if (snap->cur_freq || snap->hw_freq) {
 		printf(gettext ("  current CPU frequency is "));
-		if (freq_hardware) {
-			print_speed(freq_hardware);
-			printf(gettext (" (asserted by call to hardware)"));
+		if (snap->hw_freq) {
+			print_speed(snap->hw_freq);
+			if (freq_mode == CPUFREQ_CUR_APERF)
+				printf(gettext (" (average measured by APERF/MPERF)"));
+			else
+				printf(gettext (" (asserted by call to hardware)"));
 		}
 		else
-			print_speed(freq_kernel);
+			print_speed(snap->cur_freq);
 		printf(".\n");
 	}
-	stats = cpufreq_get_stats(cpu, &total_time);
-	if (stats) {
+
+	if (snap->valid & CPUFREQ_SNAP_STATS) {
 		printf(gettext ("  cpufreq stats: "));
-		while (stats) {
-			print_speed(stats->frequency);
-			printf(":%.2f%%", (100.0 * stats->time_in_state) / total_time);
-			stats = stats->next;
-			if (stats)
+		for (i = 0; i < snap->nr_stats; i++) {
+			if (i)
 				printf(", ");
+			print_speed(snap->stats_frequency[i]);
+			printf(":%.2f%%", (100.0 * snap->stats_time_in_state[i]) / snap->total_time);
 		}
-		cpufreq_put_stats(stats);
-		total_trans = cpufreq_get_transitions(cpu);
-		if (total_trans)
-			printf("  (%lu)\n", total_trans);
+		if (snap->valid & CPUFREQ_SNAP_STATS_TRUNCATED)
+			printf(", ...");
+		if (snap->total_trans)
+			printf("  (%lu)\n", snap->total_trans);
 		else
 			printf("\n");
 	}
 }
 
-static void debug_output(unsigned int cpu, unsigned int all) {
-	if (all) {
-		unsigned int nr_cpus = count_cpus();
-		for (cpu=0; cpu < nr_cpus; cpu++) {
-			if (cpufreq_cpu_exists(cpu))
-				continue;
-			debug_output_one(cpu);
-		}
-	} else
-		debug_output_one(cpu);
+static void debug_output_one(unsigned int cpu, int freq_mode)
+{
+	static struct cpufreq_snapshot snap;
+	struct cpufreq_topology *topo;
+	int present;
+
+	/* the library keeps the topology, checking it only rereads cpu/online */
+	topo = cpufreq_get_topology();
+	if (topo)
+		present = cpufreq_cpumask_isset(&topo->present, cpu);
+	else
+		present = !cpufreq_cpu_exists(cpu);
+	cpufreq_put_topology(topo);
+
+	if (!present) {
+		printf(gettext ("couldn't analyze CPU %d as it doesn't seem to be present\n"), cpu);
+		return;
+	}
+
+	cpufreq_get_snapshot(cpu, &snap);
+	debug_output_snapshot(cpu, &snap, freq_mode);
+}
+
+static void debug_output(unsigned int cpu, unsigned int all, int freq_mode) {
+	static const struct cpufreq_snapshot none;
+	struct cpufreq_system_snapshot *sys;
+
+	if (!all) {
+		debug_output_one(cpu, freq_mode);
+		return;
+	}
+
+	sys = cpufreq_get_system_snapshot();
+	if (!sys) {
+		printf(gettext ("Couldn't determine the CPUs of this system\n"));
+		return;
+	}
+	for (cpu = 0; cpu < sys->nr_cpus; cpu++)
+		debug_output_snapshot(sys->cpus[cpu].cpu,
+				      sys->cpus[cpu].policy ? sys->cpus[cpu].policy : &none,
+				      freq_mode);
+	cpufreq_put_system_snapshot(sys);
+}
+
+
+/* --freq-mode / -q */
+
+static int parse_freq_mode(const char *name) {
+	static const char *modes[] = {
+		[CPUFREQ_CUR_CACHED] = "cached",
+		[CPUFREQ_CUR_KERNEL] = "kernel",
+		[CPUFREQ_CUR_HARDWARE] = "hardware",
+		[CPUFREQ_CUR_APERF] = "aperf",
+	};
+	unsigned int i;
+
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+		if (!strcmp(name, modes[i]))
+			return i;
+	return -1;
 }
 
 
 /* --freq / -f */
 
-static int get_freq_kernel(unsigned int cpu, unsigned int human) {
-	unsigned long freq = cpufreq_get_freq_kernel(cpu);
+static int get_freq(unsigned int cpu, int freq_mode, unsigned int human) {
+	unsigned long freq = cpufreq_get_cur_freq(cpu, freq_mode);
 	if (!freq)
 		return -EINVAL;
 	if (human) {
@@ -348,11 +349,10 @@ static int get_driver(unsigned int cpu) {
 /* --policy / -p */
 
 static int get_policy(unsigned int cpu) {
-	struct cpufreq_policy *policy = cpufreq_get_policy(cpu);
-	if (!policy)
+	struct cpufreq_policy_value policy;
+	if (cpufreq_get_policy_value(cpu, &policy))
 		return -EINVAL;
-	printf("%lu %lu %s\n", policy->min, policy->max, policy->governor);
-	cpufreq_put_policy(policy);
+	printf("%lu %lu %s\n", policy.min, policy.max, policy.governor);
 	return 0;
 }
 
@@ -376,32 +376,24 @@ static int get_available_governors(unsigned int cpu) {
 /* --affected-cpus  / -a */
 
 static int get_affected_cpus(unsigned int cpu) {
-	struct cpufreq_affected_cpus *cpus = cpufreq_get_affected_cpus(cpu);
-	if (!cpus)
+	struct cpufreq_cpumask cpus;
+
+	if (cpufreq_get_affected_cpumask(cpu, &cpus))
 		return -EINVAL;
 
-	while (cpus->next) {
-		printf("%d ", cpus->cpu);
-		cpus = cpus->next;
-	}
-	printf("%d\n", cpus->cpu);
-	cpufreq_put_affected_cpus(cpus);
+	print_cpumask(&cpus);
 	return 0;
 }
 
 /* --related-cpus  / -r */
 
 static int get_related_cpus(unsigned int cpu) {
-	struct cpufreq_affected_cpus *cpus = cpufreq_get_related_cpus(cpu);
-	if (!cpus)
+	struct cpufreq_cpumask cpus;
+
+	if (cpufreq_get_related_cpumask(cpu, &cpus))
 		return -EINVAL;
 
-	while (cpus->next) {
-		printf("%d ", cpus->cpu);
-		cpus = cpus->next;
-	}
-	printf("%d\n", cpus->cpu);
-	cpufreq_put_related_cpus(cpus);
+	print_cpumask(&cpus);
 	return 0;
 }
 
@@ -428,6 +420,59 @@ static int get_freq_stats(unsigned int cpu, unsigned int human) {
 	return 0;
 }
 
+/* --transitions / -x */
+
+#define HOTTEST_PAIRS 10
+
+static unsigned int trans_count(const struct cpufreq_trans_matrix *matrix,
+				unsigned long from, unsigned long to) {
+	unsigned int i, j, n = matrix->nr_states;
+
+	for (i = 0; i < n && matrix->frequency[i] != from; i++)
+		;
+	for (j = 0; j < n && matrix->frequency[j] != to; j++)
+		;
+	return i < n && j < n ? matrix->count[i * n + j] : 0;
+}
+
+static int get_transitions(unsigned int cpu, unsigned int interval, unsigned int human) {
+	static struct cpufreq_trans_matrix before, after;
+	struct cpufreq_trans_pair pairs[HOTTEST_PAIRS];
+	unsigned long long total = 0;
+	unsigned int i, nr;
+
+	if (cpufreq_get_trans_matrix(cpu, &after))
+		return -EINVAL;
+	if (interval) {
+		before = after;
+		sleep(interval);
+		if (cpufreq_get_trans_matrix(cpu, &after) ||
+		    cpufreq_get_trans_matrix_delta(&before, &after, &after))
+			return -EINVAL;
+	}
+
+	for (i = 0; i < after.nr_states * after.nr_states; i++)
+		total += after.count[i];
+	nr = cpufreq_get_trans_hottest(&after, pairs, HOTTEST_PAIRS);
+
+	for (i = 0; i < nr; i++) {
+		unsigned int back = trans_count(&after, pairs[i].to, pairs[i].from);
+
+		if (human) {
+			print_speed(pairs[i].from);
+			printf(" -> ");
+			print_speed(pairs[i].to);
+			printf(gettext (": %u (%.1f%%), back: %u\n"), pairs[i].count,
+			       100.0 * pairs[i].count / total, back);
+		} else
+			printf("%lu %lu %u %u\n", pairs[i].from, pairs[i].to,
+			       pairs[i].count, back);
+	}
+	if (human)
+		printf(gettext ("%llu transitions\n"), total);
+	return 0;
+}
+
 /* --latency / -y */
 
 static int get_latency(unsigned int cpu, unsigned int human) {
@@ -443,18 +488,154 @@ static int get_latency(unsigned int cpu, unsigned int human) {
 	return 0;
 }
 
+/* --follow / -u */
+
+#define FOLLOW_BATCH		64
+#define FOLLOW_TIMEOUT_MS	250
+
+static volatile sig_atomic_t follow_stop;
+
+static void follow_signal(int sig) {
+	follow_stop = sig;
+}
+
+static void print_trace_event(const struct cpufreq_trace_event *ev,
+			      unsigned long long start, unsigned int human) {
+	if (!human) {
+		if (ev->type == CPUFREQ_TRACE_FREQUENCY)
+			printf("%llu %u frequency %lu\n", ev->timestamp, ev->cpu, ev->freq);
+		else
+			printf("%llu %u limits %lu %lu\n", ev->timestamp, ev->cpu, ev->min, ev->max);
+		return;
+	}
+
+	printf("%12.6f  CPU %-4u ", (ev->timestamp - start) / 1e9, ev->cpu);
+	if (ev->type == CPUFREQ_TRACE_FREQUENCY) {
+		printf(gettext ("frequency "));
+		print_speed(ev->freq);
+	} else {
+		printf(gettext ("limits "));
+		print_speed(ev->min);
+		printf(" - ");
+		print_speed(ev->max);
+	}
+	printf("\n");
+}
+
+static int follow(unsigned int cpu, unsigned int cpu_defined, const char *save,
+		  const char *replay, unsigned int human) {
+	struct cpufreq_trace_event events[FOLLOW_BATCH];
+	struct sigaction sa = { .sa_handler = follow_signal };
+	struct cpufreq_trace *trace;
+	unsigned long long start = 0;
+	unsigned long lost;
+	int i, ret = 0;
+
+	trace = replay ? cpufreq_trace_replay(replay) : cpufreq_trace_open(save);
+	if (!trace) {
+		if (replay)
+			printf(gettext ("Couldn't read a saved trace from %s\n"), replay);
+		else
+			printf(gettext ("Couldn't trace frequency changes; are you root, and is "
+					"tracefs mounted?\n"));
+		return -EINVAL;
+	}
+
+	/* without SA_RESTART, so that the wait is cut short; the
+	 * tracepoints are to be turned off again in any case */
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGPIPE, &sa, NULL);
+
+	while (!follow_stop) {
+		ret = cpufreq_trace_read(trace, events, FOLLOW_BATCH, FOLLOW_TIMEOUT_MS);
+		if (ret < 0)
+			break;
+		for (i = 0; i < ret; i++) {
+			if (cpu_defined && events[i].cpu != cpu)
+				continue;
+			if (!start)
+				start = events[i].timestamp;
+			print_trace_event(&events[i], start, human);
+		}
+		fflush(stdout);
+	}
+	if (ret > 0 || ret == -ENODATA || ret == -EINTR)
+		ret = 0;
+	else if (ret < 0)
+		printf(gettext ("Couldn't read the trace: %s\n"), strerror(-ret));
+
+	lost = cpufreq_trace_lost(trace);
+	if (lost)
+		printf(gettext ("%lu events were lost\n"), lost);
+	cpufreq_trace_close(trace);
+	return ret;
+}
+
 static void print_header(void) {
 	printf(PACKAGE " " VERSION ": cpufreq-info (C) Dominik Brodowski 2004-2009\n");
 	printf(gettext ("Report errors and bugs to %s, please.\n"), PACKAGE_BUGREPORT);
 }
 
+/* --lib-stats */
+
+/* upper bound in ns of the bucket holding the given share of calls */
+static unsigned long long lib_stats_percentile(const struct cpufreq_lib_op_stats *op,
+					       unsigned int permille) {
+	unsigned long long seen = 0, want = (op->calls * permille + 999) / 1000;
+	unsigned int i;
+
+	for (i = 0; i < CPUFREQ_LIB_STATS_BUCKETS - 1; i++) {
+		seen += op->hist[i];
+		if (seen >= want)
+			break;
+	}
+	return 1ULL << i;
+}
+
+static void print_lib_op_stats(const char *name, const char *what,
+			       const struct cpufreq_lib_op_stats *op) {
+	if (!op->calls)
+		return;
+
+	printf("%-30s %-5s %8llu %9llu %6llu %8llu %8llu %8llu %8llu\n",
+	       name, what, op->calls, op->bytes, op->errors, op->syscalls,
+	       op->total_ns / op->calls,
+	       lib_stats_percentile(op, 500), lib_stats_percentile(op, 990));
+}
+
+static void print_lib_stats(void) {
+	struct cpufreq_lib_stats *stats;
+	unsigned int i;
+
+	stats = malloc(sizeof(*stats));
+	if (!stats || cpufreq_get_lib_stats(stats)) {
+		free(stats);
+		return;
+	}
+
+	printf(_("\nlibcpufreq accesses (times in ns, percentiles as bucket upper bounds):\n"));
+	printf("%-30s %-5s %8s %9s %6s %8s %8s %8s %8s\n", _("file"), _("op"), _("calls"),
+	       _("bytes"), _("errors"), _("syscalls"), _("avg"), _("p50"), _("p99"));
+	for (i = 0; i < stats->nr_attrs; i++) {
+		const struct cpufreq_lib_attr_stats *attr = &stats->attr[i];
+
+		print_lib_op_stats(attr->name, _("read"), &attr->read);
+		print_lib_op_stats(attr->name, _("write"), &attr->write);
+		if (attr->shm_reads)
+			printf("%-30s %-5s %8llu\n", attr->name, _("shm"), attr->shm_reads);
+	}
+	free(stats);
+}
+
 static void print_help(void) {
 	printf(gettext ("Usage: cpufreq-info [options]\n"));
 	printf(gettext ("Options:\n"));
 	printf(gettext ("  -c CPU, --cpu CPU    CPU number which information shall be determined about\n"));
 	printf(gettext ("  -e, --debug          Prints out debug information\n"));
 	printf(gettext ("  -f, --freq           Get frequency the CPU currently runs at, according\n"
-	       "                       to the cpufreq core *\n"));
+	       "                       to the cpufreq core, or as -q says *\n"));
 	printf(gettext ("  -w, --hwfreq         Get frequency the CPU currently runs at, by reading\n"
 	       "                       it from hardware (only available to root) *\n"));
 	printf(gettext ("  -l, --hwlimits       Determine the minimum and maximum CPU frequency allowed *\n"));
@@ -466,9 +647,21 @@ static void print_help(void) {
 			"                       coordinated by software *\n"));
 	printf(gettext ("  -s, --stats          Shows cpufreq statistics if available\n"));
 	printf(gettext ("  -y, --latency        Determines the maximum latency on CPU frequency changes *\n"));
+	printf(gettext ("  -x, --transitions    Shows the pairs of frequencies switched between most *\n"));
 	printf(gettext ("  -o, --proc           Prints out information like provided by the /proc/cpufreq\n"
 	       "                       interface in 2.4. and early 2.6. kernels\n"));
-	printf(gettext ("  -m, --human          human-readable output for the -f, -w, -s and -y parameters\n"));
+	printf(gettext ("  -m, --human          human-readable output for the -f, -w, -s, -x, -y and -u parameters\n"));
+	printf(gettext ("  -i SECS, --interval SECS  for -x, count the transitions made during SECS seconds\n"
+	       "                       instead of those since the statistics were reset\n"));
+	printf(gettext ("  -u, --follow         Prints frequency changes and limits as the kernel makes\n"
+	       "                       them, until interrupted (only available to root)\n"));
+	printf(gettext ("  -b FILE, --save FILE  for -u, also saves the raw trace to FILE\n"));
+	printf(gettext ("  -z FILE, --replay FILE  like -u, but from a trace saved with -b\n"));
+	printf(gettext ("  -q MODE, --freq-mode MODE  how -f and -e determine the current frequency:\n"
+	       "                       cached (default) or kernel, which leave the CPUs\n"
+	       "                       alone, or hardware or aperf, which interrupt them\n"
+	       "                       and are only available to root\n"));
+	printf(gettext ("  -t, --lib-stats      Afterwards, shows the sysfs reads and writes it took\n"));
 	printf(gettext ("  -h, --help           Prints out this screen\n"));
 
 	printf("\n");
@@ -491,8 +684,15 @@ static struct option info_opts[] = {
 	{ .name="affected-cpus",.has_arg=no_argument,		.flag=NULL,	.val='a'},
 	{ .name="stats",	.has_arg=no_argument,		.flag=NULL,	.val='s'},
 	{ .name="latency",	.has_arg=no_argument,		.flag=NULL,	.val='y'},
+	{ .name="transitions",	.has_arg=no_argument,		.flag=NULL,	.val='x'},
+	{ .name="interval",	.has_arg=required_argument,	.flag=NULL,	.val='i'},
 	{ .name="proc",		.has_arg=no_argument,		.flag=NULL,	.val='o'},
 	{ .name="human",	.has_arg=no_argument,		.flag=NULL,	.val='m'},
+	{ .name="lib-stats",	.has_arg=no_argument,		.flag=NULL,	.val='t'},
+	{ .name="freq-mode",	.has_arg=required_argument,	.flag=NULL,	.val='q'},
+	{ .name="follow",	.has_arg=no_argument,		.flag=NULL,	.val='u'},
+	{ .name="save",		.has_arg=required_argument,	.flag=NULL,	.val='b'},
+	{ .name="replay",	.has_arg=required_argument,	.flag=NULL,	.val='z'},
 	{ .name="help",		.has_arg=no_argument,		.flag=NULL,	.val='h'},
 };
 
@@ -503,13 +703,17 @@ int main(int argc, char **argv) {
 	unsigned int cpu = 0;
 	unsigned int cpu_defined = 0;
 	unsigned int human = 0;
+	unsigned int lib_stats = 0;
+	unsigned int interval = 0;
+	int freq_mode = -1;
+	const char *save = NULL, *replay = NULL;
 	int output_param = 0;
 
 	setlocale(LC_ALL, "");
 	textdomain (PACKAGE);
 
 	do {
-		ret = getopt_long(argc, argv, "c:hoefwldpgrasmy", info_opts, NULL);
+		ret = getopt_long(argc, argv, "c:hoefwldpgrasmytxi:q:ub:z:", info_opts, NULL);
 		switch (ret) {
 		case '?':
 			output_param = '?';
@@ -534,6 +738,8 @@ int main(int argc, char **argv) {
 		case 'e':
 		case 's':
 		case 'y':
+		case 'x':
+		case 'u':
 			if (output_param) {
 				output_param = -1;
 				cont = 0;
@@ -561,6 +767,38 @@ int main(int argc, char **argv) {
 			}
 			human = 1;
 			break;
+		case 't':
+			if (lib_stats) {
+				output_param = -1;
+				cont = 0;
+				break;
+			}
+			lib_stats = 1;
+			break;
+		case 'i':
+			if (interval || sscanf(optarg, "%u", &interval) != 1 || !interval) {
+				output_param = '?';
+				cont = 0;
+			}
+			break;
+		case 'b':
+		case 'z':
+			if (save || replay) {
+				output_param = -1;
+				cont = 0;
+				break;
+			}
+			if (ret == 'b')
+				save = optarg;
+			else
+				replay = optarg;
+			break;
+		case 'q':
+			if (freq_mode >= 0 || (freq_mode = parse_freq_mode(optarg)) < 0) {
+				output_param = '?';
+				cont = 0;
+			}
+			break;
 		}
 	} while(cont);
 
@@ -573,11 +811,19 @@ int main(int argc, char **argv) {
 		}
 		break;
 	case 0:
-		output_param = 'e';
+		output_param = (save || replay) ? 'u' : 'e';
 	}
 
 	ret = 0;
 
+	if (lib_stats)
+		cpufreq_set_lib_stats(1);
+
+	/* by default, don't wake up every idle CPU to ask it */
+	if (freq_mode < 0)
+		freq_mode = CPUFREQ_CUR_CACHED;
+	cpufreq_set_cur_freq_mode(freq_mode);
+
 	switch (output_param) {
 	case -1:
 		print_header();
@@ -600,7 +846,7 @@ int main(int argc, char **argv) {
 		break;
 	case 'e':
 		print_header();
-		debug_output(cpu, !(cpu_defined));
+		debug_output(cpu, !(cpu_defined), freq_mode);
 		break;
 	case 'a':
 		ret = get_affected_cpus(cpu);
@@ -624,7 +870,7 @@ int main(int argc, char **argv) {
 		ret = get_freq_hardware(cpu, human);
 		break;
 	case 'f':
-		ret = get_freq_kernel(cpu, human);
+		ret = get_freq(cpu, freq_mode, human);
 		break;
 	case 's':
 		ret = get_freq_stats(cpu, human);
@@ -632,6 +878,16 @@ int main(int argc, char **argv) {
 	case 'y':
 		ret = get_latency(cpu, human);
 		break;
+	case 'x':
+		ret = get_transitions(cpu, interval, human);
+		break;
+	case 'u':
+		ret = follow(cpu, cpu_defined, save, replay, human);
+		break;
 	}
+
+	if (lib_stats)
+		print_lib_stats();
+
 	return (ret);
 }
@@ -0,0 +1,213 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * cpufreq-latency measures how long switching a CPU between its
+ * frequencies really takes, and sets it against the transition latency
+ * the driver advertises; see cpufreq_measure_latency in cpufreq.h. It
+ * needs to write scaling_governor and scaling_setspeed, i.e. root.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <getopt.h>
+
+#include "cpufreq.h"
+
+#ifdef NLS
+#include <libintl.h>
+#define _(String) gettext(String)
+#define gettext_noop(String) String
+#define N_(String) gettext_noop(String)
+#else
+#define gettext_noop(String) String
+#define _(String) gettext_noop (String)
+#define gettext(String) gettext_noop (String)
+#define N_(String) gettext_noop (String)
+#define textdomain(String)
+#endif
+
+static void print_header(void)
+{
+	printf(PACKAGE " " VERSION ": cpufreq-latency (C) cpufrequtils contributors 2026\n");
+	printf(gettext("Report errors and bugs to %s, please.\n"), PACKAGE_BUGREPORT);
+}
+
+static void print_help(void)
+{
+	printf(gettext("Usage: cpufreq-latency [options]\n"));
+	printf(gettext("Options:\n"));
+	printf(gettext("  -c CPU, --cpu CPU          CPU to measure (default 0)\n"));
+	printf(gettext("  -f FREQS, --freqs FREQS    comma separated frequencies in kHz to switch\n"
+	       "                             between (default all available ones)\n"));
+	printf(gettext("  -n ROUNDS, --rounds ROUNDS switches per pair and direction (default 10)\n"));
+	printf(gettext("  -t MSECS, --timeout MSECS  time a switch may take at most (default 10)\n"));
+	printf(gettext("  -m METHOD, --method METHOD how to see the new speed: busyloop, aperf\n"
+	       "                             or auto (default), which uses APERF/MPERF\n"
+	       "                             if it can\n"));
+	printf(gettext("  -h, --help                 Prints out this screen\n"));
+	printf("\n");
+	printf(gettext("The CPU is switched with the userspace governor, which is replaced for\n"
+	       "the time of the measurement, and everything else on its policy is\n"
+	       "disturbed meanwhile.\n"));
+}
+
+static struct option latency_opts[] = {
+	{ .name="cpu",		.has_arg=required_argument,	.flag=NULL,	.val='c'},
+	{ .name="freqs",	.has_arg=required_argument,	.flag=NULL,	.val='f'},
+	{ .name="rounds",	.has_arg=required_argument,	.flag=NULL,	.val='n'},
+	{ .name="timeout",	.has_arg=required_argument,	.flag=NULL,	.val='t'},
+	{ .name="method",	.has_arg=required_argument,	.flag=NULL,	.val='m'},
+	{ .name="help",		.has_arg=no_argument,		.flag=NULL,	.val='h'},
+	{ },
+};
+
+static void print_unknown_arg(void)
+{
+	print_header();
+	printf(gettext("invalid or unknown argument\n"));
+	print_help();
+}
+
+static unsigned int parse_freqs(char *list, unsigned long *freqs)
+{
+	unsigned int nr = 0;
+	char *tok, *save = NULL;
+
+	for (tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		if (nr == CPUFREQ_MAX_STATES || sscanf(tok, "%lu", &freqs[nr]) != 1 || !freqs[nr])
+			return 0;
+		nr++;
+	}
+	return nr;
+}
+
+static void print_us(unsigned long long ns)
+{
+	printf(" %9.1f", ns / 1000.0);
+}
+
+static void print_report(const struct cpufreq_latency_report *report)
+{
+	const struct cpufreq_latency_pair *pair;
+	unsigned int i;
+
+	printf(_("CPU %u, %s, %u rounds, resolution %.1f us\n"), report->cpu,
+	       report->method == CPUFREQ_LATENCY_APERF ? "APERF/MPERF" : _("busy loop"),
+	       report->rounds, report->sample_ns / 1000.0);
+	printf(_("advertised transition latency: %.1f us\n\n"), report->advertised_ns / 1000.0);
+
+	printf(_("    from MHz      to MHz  done  lost    min us median us    p90 us    max us  write us  x advertised\n"));
+	for (i = 0; i < report->nr_pairs; i++) {
+		pair = &report->pair[i];
+		printf("%12lu%12lu", pair->from / 1000, pair->to / 1000);
+		if (pair->indistinct) {
+			printf(_("  speeds not distinguishable\n"));
+			continue;
+		}
+		printf("%6u%6u", pair->measured, pair->timeouts);
+		if (!pair->measured) {
+			printf("\n");
+			continue;
+		}
+		print_us(pair->min_ns);
+		print_us(pair->median_ns);
+		print_us(pair->p90_ns);
+		print_us(pair->max_ns);
+		print_us(pair->write_ns);
+		if (report->advertised_ns)
+			printf("  %12.1f", (double)pair->median_ns / report->advertised_ns);
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	extern char *optarg;
+	int ret = 0, cont = 1;
+	unsigned int cpu = 0, rounds = 10, timeout_ms = 10, nr_freqs = 0;
+	unsigned long freqs[CPUFREQ_MAX_STATES];
+	int method = CPUFREQ_LATENCY_AUTO;
+	struct cpufreq_latency_report *report;
+
+	setlocale(LC_ALL, "");
+	textdomain (PACKAGE);
+
+	/* the governor to restore must be the current one, not what a
+	 * publisher saw last */
+	cpufreq_set_shm(NULL);
+
+	/* parameter parsing */
+	do {
+		ret = getopt_long(argc, argv, "c:f:n:t:m:h", latency_opts, NULL);
+		switch (ret) {
+		case '?':
+			print_unknown_arg();
+			return -EINVAL;
+		case 'h':
+			print_header();
+			print_help();
+			return 0;
+		case -1:
+			cont = 0;
+			break;
+		case 'c':
+			if (sscanf(optarg, "%u", &cpu) != 1) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			break;
+		case 'f':
+			nr_freqs = parse_freqs(optarg, freqs);
+			if (nr_freqs < 2) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			break;
+		case 'n':
+			if (sscanf(optarg, "%u", &rounds) != 1 || !rounds) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			break;
+		case 't':
+			if (sscanf(optarg, "%u", &timeout_ms) != 1 || !timeout_ms) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			break;
+		case 'm':
+			if (!strcmp(optarg, "busyloop"))
+				method = CPUFREQ_LATENCY_BUSYLOOP;
+			else if (!strcmp(optarg, "aperf"))
+				method = CPUFREQ_LATENCY_APERF;
+			else if (!strcmp(optarg, "auto"))
+				method = CPUFREQ_LATENCY_AUTO;
+			else {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			break;
+		}
+	} while(cont);
+
+	report = cpufreq_measure_latency(cpu, method, nr_freqs ? freqs : NULL, nr_freqs,
+					 rounds, timeout_ms * 1000UL);
+	if (!report) {
+		fprintf(stderr, _("Couldn't measure CPU %u; are you root, and is the "
+				  "userspace governor available?\n"), cpu);
+		return -EINVAL;
+	}
+
+	print_report(report);
+	cpufreq_put_latency_report(report);
+	return 0;
+}
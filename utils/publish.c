@@ -0,0 +1,157 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * cpufreq-publish samples the cpufreq files of all online CPUs at a fixed
+ * interval into a shared memory segment, from which libcpufreq in all
+ * other processes reads them instead of sysfs; see
+ * cpufreq_publisher_create in cpufreq.h. It runs in the foreground
+ * until SIGINT or SIGTERM, and then removes the segment.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <locale.h>
+
+#include <getopt.h>
+
+#include "cpufreq.h"
+
+#ifdef NLS
+#include <libintl.h>
+#define _(String) gettext(String)
+#define gettext_noop(String) String
+#define N_(String) gettext_noop(String)
+#else
+#define gettext_noop(String) String
+#define _(String) gettext_noop (String)
+#define gettext(String) gettext_noop (String)
+#define N_(String) gettext_noop (String)
+#define textdomain(String)
+#endif
+
+static volatile sig_atomic_t stop;
+
+static void print_header(void)
+{
+	printf(PACKAGE " " VERSION ": cpufreq-publish (C) cpufrequtils contributors 2026\n");
+	printf(gettext("Report errors and bugs to %s, please.\n"), PACKAGE_BUGREPORT);
+}
+
+static void print_help(void)
+{
+	printf(gettext("Usage: cpufreq-publish [options]\n"));
+	printf(gettext("Options:\n"));
+	printf(gettext("  -i MSECS, --interval MSECS  sampling interval (default 100)\n"));
+	printf(gettext("  -n NAME, --name NAME        shared memory segment (default /cpufreq)\n"));
+	printf(gettext("  -h, --help                  Prints out this screen\n"));
+	printf("\n");
+	printf(gettext("Processes using libcpufreq read the published values instead of\n"
+	       "sysfs while this runs; set CPUFREQ_SHM to the name given by -n, or\n"
+	       "to an empty value to always read sysfs.\n"));
+}
+
+static struct option publish_opts[] = {
+	{ .name="interval",	.has_arg=required_argument,	.flag=NULL,	.val='i'},
+	{ .name="name",		.has_arg=required_argument,	.flag=NULL,	.val='n'},
+	{ .name="help",		.has_arg=no_argument,		.flag=NULL,	.val='h'},
+	{ },
+};
+
+static void print_unknown_arg(void)
+{
+	print_header();
+	printf(gettext("invalid or unknown argument\n"));
+	print_help();
+}
+
+static void on_signal(int sig)
+{
+	stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+	extern char *optarg;
+	int ret = 0, cont = 1;
+	const char *name = NULL;
+	unsigned int interval_ms = 100;
+	unsigned long long updates = 0;
+	struct cpufreq_publisher *pub;
+	struct sigaction sa;
+	struct timespec next, start, cpu;
+
+	setlocale(LC_ALL, "");
+	textdomain (PACKAGE);
+
+	/* parameter parsing */
+	do {
+		ret = getopt_long(argc, argv, "i:n:h", publish_opts, NULL);
+		switch (ret) {
+		case '?':
+			print_unknown_arg();
+			return -EINVAL;
+		case 'h':
+			print_header();
+			print_help();
+			return 0;
+		case -1:
+			cont = 0;
+			break;
+		case 'i':
+			if (sscanf(optarg, "%u", &interval_ms) != 1 || !interval_ms) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			break;
+		case 'n':
+			name = optarg;
+			break;
+		}
+	} while(cont);
+	ret = 0;
+
+	pub = cpufreq_publisher_create(name, NULL, interval_ms * 1000UL);
+	if (!pub) {
+		fprintf(stderr, _("Couldn't create the shared memory segment\n"));
+		return -ENODEV;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	next = start;
+	while (!stop) {
+		if (cpufreq_publisher_update(pub)) {
+			fprintf(stderr, _("Couldn't read the CPU topology\n"));
+			ret = -ENODEV;
+			break;
+		}
+		updates++;
+
+		next.tv_nsec += (interval_ms % 1000) * 1000000L;
+		next.tv_sec += interval_ms / 1000 + next.tv_nsec / 1000000000L;
+		next.tv_nsec %= 1000000000L;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR && !stop)
+			;
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+	if (updates)
+		fprintf(stderr, _("%llu updates, %.1f us CPU time each\n"), updates,
+			(cpu.tv_sec * 1e6 + cpu.tv_nsec / 1e3) / updates);
+
+	cpufreq_publisher_destroy(pub);
+	return ret;
+}
@@ -0,0 +1,522 @@
+/*
+ *  (C) 2026  cpufrequtils contributors
+ *
+ *  Licensed under the terms of the GNU GPL License version 2.
+ */
+
+/*
+ * cpufreq-record samples the current frequency, time in state and
+ * number of transitions of a set of CPUs at a fixed rate into a ring
+ * buffer in a memory mapped file. Records have a fixed size, so a
+ * reader maps the same file and finds record n at n % nr_records while
+ * it is being written; "cpufreq-record -p FILE" does that.
+ *
+ * The sampling loop doesn't allocate: the current frequencies come
+ * through the file descriptor cache, time in state and transitions
+ * through a refreshed cpufreq_stats_sample, whose state-major layout is
+ * the one of the records.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <locale.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <getopt.h>
+
+#include "cpufreq.h"
+
+#ifdef NLS
+#include <libintl.h>
+#define _(String) gettext(String)
+#define gettext_noop(String) String
+#define N_(String) gettext_noop(String)
+#else
+#define gettext_noop(String) String
+#define _(String) gettext_noop (String)
+#define gettext(String) gettext_noop (String)
+#define N_(String) gettext_noop (String)
+#define textdomain(String)
+#endif
+
+#define RECORD_MAGIC	"CPUFREC1"
+#define RECORD_ALIGN	64
+
+/* the record has fresh time_in_state and total_trans */
+#define RECORD_STATS	0x1
+
+/*
+ * File layout: the header, the CPUs and the states, then nr_records
+ * records of record_size bytes, starting at header_size. All of it is
+ * in the byte order of the recording machine.
+ */
+struct record_header {
+	char magic[8];
+	uint32_t header_size;
+	uint32_t record_size;
+	uint32_t nr_cpus;
+	uint32_t nr_states;
+	uint32_t nr_records;
+	uint32_t reserved;
+	uint64_t interval;		/* ns */
+	uint64_t written;		/* records completed so far */
+	uint64_t overruns;		/* sampling times missed */
+	/* uint32_t cpu[nr_cpus], uint32_t frequency[nr_states] */
+};
+
+/*
+ * seq is 0 while a record is being written, and its number + 1 after.
+ * The values follow the header:
+ *   uint32_t cur_freq[nr_cpus], padded to 8 bytes
+ *   uint64_t total_trans[nr_cpus]
+ *   uint64_t time_in_state[nr_states][nr_cpus]
+ */
+struct record {
+	uint64_t seq;
+	uint64_t timestamp;		/* ns since the first record */
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+struct recording {
+	struct record_header *header;
+	size_t size;
+	unsigned int *cpu;
+	unsigned int *frequency;
+	size_t freq_offset, trans_offset, tis_offset;
+};
+
+static volatile sig_atomic_t stop;
+
+static void print_header(void)
+{
+	printf(PACKAGE " " VERSION ": cpufreq-record (C) cpufrequtils contributors 2026\n");
+	printf(gettext("Report errors and bugs to %s, please.\n"), PACKAGE_BUGREPORT);
+}
+
+static void print_help(void)
+{
+	printf(gettext("Usage: cpufreq-record [options] -o FILE\n"
+		       "       cpufreq-record -p FILE\n"));
+	printf(gettext("Options:\n"));
+	printf(gettext("  -o FILE, --output FILE   record into FILE\n"));
+	printf(gettext("  -c CPUS, --cpus CPUS     list of CPUs to record, e.g. 0-3,8; default is\n"
+	       "                           the first CPU of every policy\n"));
+	printf(gettext("  -r HZ, --rate HZ         samples per second (default 10)\n"));
+	printf(gettext("  -n N, --records N        size of the ring buffer in records (default 1024)\n"));
+	printf(gettext("  -s N, --stats-every N    read time_in_state and total_trans every N\n"
+	       "                           samples only (default 1)\n"));
+	printf(gettext("  -d SECS, --duration SECS stop after SECS seconds (default: at SIGINT)\n"));
+	printf(gettext("  -p FILE, --print FILE    print the records in FILE, which may still be\n"
+	       "                           being recorded\n"));
+	printf(gettext("  -h, --help               Prints out this screen\n"));
+	printf("\n");
+	printf(gettext("At the end, the CPU time taken by the recorder is reported.\n"));
+}
+
+static struct option record_opts[] = {
+	{ .name="output",	.has_arg=required_argument,	.flag=NULL,	.val='o'},
+	{ .name="cpus",		.has_arg=required_argument,	.flag=NULL,	.val='c'},
+	{ .name="rate",		.has_arg=required_argument,	.flag=NULL,	.val='r'},
+	{ .name="records",	.has_arg=required_argument,	.flag=NULL,	.val='n'},
+	{ .name="stats-every",	.has_arg=required_argument,	.flag=NULL,	.val='s'},
+	{ .name="duration",	.has_arg=required_argument,	.flag=NULL,	.val='d'},
+	{ .name="print",	.has_arg=required_argument,	.flag=NULL,	.val='p'},
+	{ .name="help",		.has_arg=no_argument,		.flag=NULL,	.val='h'},
+	{ },
+};
+
+static void print_unknown_arg(void)
+{
+	print_header();
+	printf(gettext("invalid or unknown argument\n"));
+	print_help();
+}
+
+static size_t align(size_t size)
+{
+	return (size + RECORD_ALIGN - 1) & ~((size_t) RECORD_ALIGN - 1);
+}
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void on_signal(int sig)
+{
+	stop = 1;
+}
+
+
+/******* the file ********/
+
+/* sets the array pointers and offsets from a mapped header */
+static int recording_layout(struct recording *rec)
+{
+	const struct record_header *h = rec->header;
+	size_t min_record;
+
+	if (memcmp(h->magic, RECORD_MAGIC, sizeof(h->magic)) || !h->nr_records)
+		return -EINVAL;
+
+	rec->cpu = (unsigned int *) (h + 1);
+	rec->frequency = rec->cpu + h->nr_cpus;
+	rec->freq_offset = sizeof(struct record);
+	rec->trans_offset = rec->freq_offset + (h->nr_cpus * sizeof(uint32_t) + 7) / 8 * 8;
+	rec->tis_offset = rec->trans_offset + h->nr_cpus * sizeof(uint64_t);
+	min_record = rec->tis_offset + (size_t) h->nr_states * h->nr_cpus * sizeof(uint64_t);
+
+	if (h->record_size < min_record ||
+	    h->header_size < sizeof(*h) + (h->nr_cpus + h->nr_states) * sizeof(uint32_t) ||
+	    rec->size < h->header_size + (size_t) h->nr_records * h->record_size)
+		return -EINVAL;
+	return 0;
+}
+
+static struct record * recording_slot(const struct recording *rec, uint64_t n)
+{
+	const struct record_header *h = rec->header;
+
+	return (struct record *) ((char *) h + h->header_size +
+				  (n % h->nr_records) * h->record_size);
+}
+
+static int recording_create(struct recording *rec, const char *path,
+			    const struct cpufreq_stats_sample *sample,
+			    unsigned int nr_records, uint64_t interval)
+{
+	struct record_header *h;
+	size_t header_size, record_size;
+	unsigned int i;
+	int fd;
+
+	header_size = align(sizeof(*h) + (sample->nr_cpus + sample->nr_states) * sizeof(uint32_t));
+	record_size = align(sizeof(struct record) +
+			    (sample->nr_cpus * sizeof(uint32_t) + 7) / 8 * 8 +
+			    sample->nr_cpus * sizeof(uint64_t) +
+			    (size_t) sample->nr_states * sample->nr_cpus * sizeof(uint64_t));
+	rec->size = header_size + (size_t) nr_records * record_size;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -errno;
+	if (ftruncate(fd, rec->size)) {
+		close(fd);
+		return -errno;
+	}
+	h = mmap(NULL, rec->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (h == MAP_FAILED)
+		return -errno;
+
+	h->header_size = header_size;
+	h->record_size = record_size;
+	h->nr_cpus = sample->nr_cpus;
+	h->nr_states = sample->nr_states;
+	h->nr_records = nr_records;
+	h->interval = interval;
+	rec->header = h;
+	rec->cpu = (unsigned int *) (h + 1);
+	rec->frequency = rec->cpu + h->nr_cpus;
+	for (i = 0; i < sample->nr_cpus; i++)
+		rec->cpu[i] = sample->cpu[i];
+	for (i = 0; i < sample->nr_states; i++)
+		rec->frequency[i] = sample->frequency[i];
+
+	/* the magic goes last, so that readers don't see a half header */
+	memcpy(h->magic, RECORD_MAGIC, sizeof(h->magic));
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return recording_layout(rec);
+}
+
+static int recording_open(struct recording *rec, const char *path)
+{
+	struct stat st;
+	int fd, ret;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	if (fstat(fd, &st) || (size_t) st.st_size < sizeof(struct record_header)) {
+		close(fd);
+		return -EINVAL;
+	}
+	rec->size = st.st_size;
+	rec->header = mmap(NULL, rec->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (rec->header == MAP_FAILED)
+		return -errno;
+
+	ret = recording_layout(rec);
+	if (ret)
+		munmap(rec->header, rec->size);
+	return ret;
+}
+
+
+/******* recording ********/
+
+static void take_record(struct recording *rec, struct cpufreq_stats_sample *sample,
+			uint64_t n, uint64_t timestamp, int stats)
+{
+	struct record *r = recording_slot(rec, n);
+	uint32_t *cur_freq = (uint32_t *) ((char *) r + rec->freq_offset);
+	uint64_t *total_trans = (uint64_t *) ((char *) r + rec->trans_offset);
+	uint64_t *time_in_state = (uint64_t *) ((char *) r + rec->tis_offset);
+	unsigned int i;
+
+	__atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	r->timestamp = timestamp;
+	r->flags = 0;
+	for (i = 0; i < sample->nr_cpus; i++)
+		cur_freq[i] = cpufreq_get_freq_kernel(sample->cpu[i]);
+
+	/* a frequency not known at the start (-EAGAIN) isn't recorded; the
+	 * states are fixed in the header */
+	if (stats) {
+		cpufreq_refresh_stats_sample(sample);
+		r->flags |= RECORD_STATS;
+	}
+	for (i = 0; i < sample->nr_cpus; i++)
+		total_trans[i] = sample->total_trans[i];
+	memcpy(time_in_state, sample->time_in_state,
+	       (size_t) sample->nr_states * sample->nr_cpus * sizeof(*time_in_state));
+
+	__atomic_store_n(&r->seq, n + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&rec->header->written, n + 1, __ATOMIC_RELEASE);
+}
+
+static int do_record(const char *path, const unsigned int *cpus, unsigned int nr_cpus,
+		     unsigned int rate, unsigned int nr_records, unsigned int stats_every,
+		     unsigned int duration)
+{
+	struct cpufreq_stats_sample *sample;
+	struct recording rec;
+	struct sigaction sa;
+	struct rusage usage;
+	struct timespec ts;
+	uint64_t interval = 1000000000ULL / rate, start, next, now, n = 0, end, missed;
+	double cpu_time, elapsed;
+	int ret;
+
+	sample = cpufreq_get_stats_sample(cpus, nr_cpus);
+	if (!sample) {
+		fprintf(stderr, _("Couldn't read the CPUs to record\n"));
+		return -ENODEV;
+	}
+
+	/* three files per CPU: scaling_cur_freq, time_in_state, total_trans */
+	cpufreq_fd_cache_enable(sample->nr_cpus * 3 + 16);
+
+	ret = recording_create(&rec, path, sample, nr_records, interval);
+	if (ret) {
+		fprintf(stderr, _("Couldn't create %s: %s\n"), path, strerror(-ret));
+		goto out;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	start = next = monotonic_ns();
+	end = start + duration * 1000000000ULL;
+	while (!stop && (!duration || next < end)) {
+		take_record(&rec, sample, n, next - start, !(n % stats_every));
+		n++;
+
+		next += interval;
+		now = monotonic_ns();
+		if (now >= next + interval) {
+			/* too slow for this rate: skip what's been missed */
+			missed = (now - next) / interval;
+			next += missed * interval;
+			rec.header->overruns += missed;
+		}
+		ts.tv_sec = next / 1000000000ULL;
+		ts.tv_nsec = next % 1000000000ULL;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !stop)
+			;
+	}
+	elapsed = (monotonic_ns() - start) / 1e9;
+
+	getrusage(RUSAGE_SELF, &usage);
+	cpu_time = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+		usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+	fprintf(stderr, _("%llu records of %u CPUs in %.2f s, %llu missed\n"),
+		(unsigned long long) n, sample->nr_cpus, elapsed,
+		(unsigned long long) rec.header->overruns);
+	fprintf(stderr, _("recorder CPU time: %.3f s (%.2f%% of one CPU), %.1f us per record\n"),
+		cpu_time, elapsed ? cpu_time * 100 / elapsed : 0,
+		n ? cpu_time * 1e6 / n : 0);
+
+	msync(rec.header, rec.size, MS_ASYNC);
+	munmap(rec.header, rec.size);
+ out:
+	cpufreq_fd_cache_disable();
+	cpufreq_put_stats_sample(sample);
+	return ret;
+}
+
+
+/******* printing ********/
+
+static int do_print(const char *path)
+{
+	const struct record_header *h;
+	struct recording rec;
+	struct record *copy, *r;
+	const uint32_t *cur_freq;
+	const uint64_t *total_trans;
+	uint64_t written, n, seq, transitions;
+	unsigned int i;
+	int ret;
+
+	ret = recording_open(&rec, path);
+	if (ret) {
+		fprintf(stderr, _("Couldn't read %s: %s\n"), path, strerror(-ret));
+		return ret;
+	}
+	h = rec.header;
+	copy = malloc(h->record_size);
+	if (!copy) {
+		munmap(rec.header, rec.size);
+		return -ENOMEM;
+	}
+	cur_freq = (const uint32_t *) ((char *) copy + rec.freq_offset);
+	total_trans = (const uint64_t *) ((char *) copy + rec.trans_offset);
+
+	printf("# %u CPUs, %u states, %.3f ms interval, %llu missed\n# time",
+	       h->nr_cpus, h->nr_states, h->interval / 1e6,
+	       (unsigned long long) h->overruns);
+	for (i = 0; i < h->nr_cpus; i++)
+		printf(" cpu%u", rec.cpu[i]);
+	printf(" transitions (* from an earlier record)\n");
+
+	written = __atomic_load_n(&h->written, __ATOMIC_ACQUIRE);
+	n = written > h->nr_records ? written - h->nr_records : 0;
+	for (; n < written; n++) {
+		/* the recorder may be overwriting the record right now */
+		r = recording_slot(&rec, n);
+		seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+		memcpy(copy, r, h->record_size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (seq != n + 1 || __atomic_load_n(&r->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+
+		printf("%.6f", copy->timestamp / 1e9);
+		for (i = 0; i < h->nr_cpus; i++)
+			printf(" %u", cur_freq[i]);
+		transitions = 0;
+		for (i = 0; i < h->nr_cpus; i++)
+			transitions += total_trans[i];
+		printf(" %llu%s\n", (unsigned long long) transitions,
+		       copy->flags & RECORD_STATS ? "" : " *");
+	}
+
+	free(copy);
+	munmap(rec.header, rec.size);
+	return 0;
+}
+
+
+/******* Options parsing, main ********/
+
+int main(int argc, char **argv)
+{
+	extern char *optarg;
+	int ret = 0, cont = 1;
+	const char *output = NULL, *input = NULL;
+	unsigned int rate = 10, nr_records = 1024, stats_every = 1, duration = 0;
+	unsigned int *cpus = NULL, nr_cpus = 0, cpu;
+	struct cpufreq_cpumask mask;
+	int mask_defined = 0;
+
+	setlocale(LC_ALL, "");
+	textdomain (PACKAGE);
+
+	/* samples must be fresh, not what a publisher saw last */
+	cpufreq_set_shm(NULL);
+
+	/* parameter parsing */
+	do {
+		ret = getopt_long(argc, argv, "o:c:r:n:s:d:p:h", record_opts, NULL);
+		switch (ret) {
+		case '?':
+			print_unknown_arg();
+			return -EINVAL;
+		case 'h':
+			print_header();
+			print_help();
+			return 0;
+		case -1:
+			cont = 0;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'p':
+			input = optarg;
+			break;
+		case 'c':
+			if (!cpufreq_cpumask_parse(optarg, strlen(optarg), &mask)) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			mask_defined = 1;
+			break;
+		case 'r':
+		case 'n':
+		case 's':
+		case 'd':
+			if (sscanf(optarg, "%u", &cpu) != 1 || (!cpu && ret != 'd')) {
+				print_unknown_arg();
+				return -EINVAL;
+			}
+			if (ret == 'r')
+				rate = cpu;
+			else if (ret == 'n')
+				nr_records = cpu;
+			else if (ret == 's')
+				stats_every = cpu;
+			else
+				duration = cpu;
+			break;
+		}
+	} while(cont);
+
+	if (input)
+		return do_print(input);
+
+	if (!output || rate > 1000000) {
+		print_unknown_arg();
+		return -EINVAL;
+	}
+
+	if (mask_defined) {
+		cpus = malloc(cpufreq_cpumask_weight(&mask) * sizeof(*cpus));
+		if (!cpus)
+			return -ENOMEM;
+		cpufreq_cpumask_for_each(cpu, &mask)
+			cpus[nr_cpus++] = cpu;
+	}
+
+	ret = do_record(output, cpus, nr_cpus, rate, nr_records, stats_every, duration);
+	free(cpus);
+	return ret;
+}
@@ -184,28 +184,23 @@ static unsigned long string_to_frequency(const char *str)
 
 static int do_new_policy(unsigned int cpu, struct cpufreq_policy *new_pol)
 {
-	struct cpufreq_policy *cur_pol = cpufreq_get_policy(cpu);
-	int ret;
+	struct cpufreq_policy_value cur_pol;
 
-	if (!cur_pol) {
+	if (cpufreq_get_policy_value(cpu, &cur_pol)) {
 		printf(gettext("wrong, unknown or unhandled CPU?\n"));
 		return -EINVAL;
 	}
 
 	if (!new_pol->min)
-		new_pol->min = cur_pol->min;
+		new_pol->min = cur_pol.min;
 
 	if (!new_pol->max)
-		new_pol->max = cur_pol->max;
+		new_pol->max = cur_pol.max;
 
 	if (!new_pol->governor)
-		new_pol->governor = cur_pol->governor;
-
-	ret = cpufreq_set_policy(cpu, new_pol);
+		new_pol->governor = cur_pol.governor;
 
-	cpufreq_put_policy(cur_pol);
-
-	return ret;
+	return cpufreq_set_policy(cpu, new_pol);
 }
 
 	
@@ -234,6 +229,42 @@ static int do_one_cpu(unsigned int cpu, struct cpufreq_policy *new_pol,
 }
 
 
+/* all CPUs of a -r/--related change share policies, so that they are
+ * best written as one batch */
+static int do_cpu_batch(const struct cpufreq_cpumask *cpus,
+			struct cpufreq_policy *new_pol)
+{
+	struct cpufreq_policy_request *reqs;
+	unsigned int nr, cpu, i = 0;
+	int ret;
+
+	nr = cpufreq_cpumask_weight(cpus);
+	reqs = calloc(nr, sizeof(*reqs));
+	if (!reqs)
+		return -ENOMEM;
+
+	cpufreq_cpumask_for_each(cpu, cpus) {
+		reqs[i].cpu = cpu;
+		reqs[i].min = new_pol->min;
+		reqs[i].max = new_pol->max;
+		reqs[i].governor = new_pol->governor;
+		i++;
+	}
+
+	ret = cpufreq_set_policy_batch(reqs, nr);
+	for (i = 0; ret > 0 && i < nr; i++) {
+		if (reqs[i].result) {
+			ret = reqs[i].result;
+			break;
+		}
+	}
+
+	free(reqs);
+
+	return ret;
+}
+
+
 int main(int argc, char **argv)
 {
 	extern char *optarg;
@@ -249,16 +280,17 @@ int main(int argc, char **argv)
 		.max = 0,
 		.governor = NULL,
 	};
-	struct cpufreq_affected_cpus single_cpu = {
-		.cpu = 0,
-		.next = NULL,
-		.first = &single_cpu,
-	};
-	struct cpufreq_affected_cpus *cpus = NULL;
+	unsigned int cpu = 0;
+	int cpu_defined = 0;
+	struct cpufreq_cpumask cpus;
 
 	setlocale(LC_ALL, "");
 	textdomain (PACKAGE);
 
+	/* policies are changed based on what they are now, not on what a
+	 * publisher saw last */
+	cpufreq_set_shm(NULL);
+
 	/* parameter parsing */
 	do {
 		ret = getopt_long(argc, argv, "c:d:u:g:f:hr", set_opts, NULL);
@@ -279,10 +311,10 @@ int main(int argc, char **argv)
 			related++;
 			break;
 		case 'c':
-			if (cpus)
+			if (cpu_defined)
 				double_parm++;
-			cpus = &single_cpu;
-			if ((sscanf(optarg, "%d ", &single_cpu.cpu)) != 1) {
+			cpu_defined = 1;
+			if ((sscanf(optarg, "%u ", &cpu)) != 1) {
 				print_unknown_arg();
 				return -EINVAL;
                         }
@@ -354,28 +386,23 @@ int main(int argc, char **argv)
 
 
 	/* which CPUs shall we modify? */
-	if (!cpus)
-		cpus = &single_cpu;
-
-	if (related)
-		cpus = cpufreq_get_related_cpus(cpus->cpu);
-
-	/* loop over CPUs */
-	while (1) {
-		ret = do_one_cpu(cpus->cpu, &new_pol, freq, policychange);
-		if (ret)
-			break;
-
-		if (!cpus->next)
-			break;
-
-		cpus = cpus->next;
+	cpufreq_cpumask_zero(&cpus);
+	if (!related || cpufreq_get_related_cpumask(cpu, &cpus))
+		cpufreq_cpumask_set(&cpus, cpu);
+
+	if (cpu >= CPUFREQ_MAX_CPUS) {
+		ret = -EINVAL;
+	} else if (policychange && cpufreq_cpumask_weight(&cpus) > 1) {
+		ret = do_cpu_batch(&cpus, &new_pol);
+	} else {
+		/* loop over CPUs */
+		cpufreq_cpumask_for_each(cpu, &cpus) {
+			ret = do_one_cpu(cpu, &new_pol, freq, policychange);
+			if (ret)
+				break;
+		}
 	}
 
-	/* cleanup */
-	if (cpus->first != &single_cpu)
-		cpufreq_put_related_cpus(cpus->first);
-
 	if (ret)
 		print_error();
 